@@ -0,0 +1,629 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <praytimes.h>
+#include <praytimes_math.h>
+
+#define INPUTS 1024
+#define MIN_SECONDS 0.2
+#define REPEATS 7
+#define MAX_RESULTS 64
+#define THREADS 4
+
+/**
+ * Benchmark result struct data type.
+ **/
+typedef struct bench_result_t
+{
+  const char* name;
+  double nsPerOp;
+  double opsPerSec;
+  double allocsPerOp;
+  double relative; /* ns/op over those of the reference kernel of the run */
+  int gated;       /* compared against the baseline */
+} BenchResult;
+
+/**
+ * Benchmark function, runs n operations
+ *
+ * @param[in]  n  Number of operations
+ **/
+typedef void (*Bench_t)(long n);
+
+/**
+ * City struct data type.
+ **/
+typedef struct bench_city_t
+{
+  const char* name;
+  double lat;
+  double lng;
+  double elv;
+  int tmz;
+} BenchCity;
+
+static const BenchCity cities[] = {
+  { "Jakarta", -6.2088, 106.8456, 8, 7 },
+  { "Makkah", 21.3891, 39.8579, 277, 3 },
+  { "Cairo", 30.0444, 31.2357, 23, 2 },
+  { "Karachi", 24.8607, 67.0011, 10, 5 },
+  { "London", 51.5072, -0.1276, 11, 0 },
+  { "New York", 40.7128, -74.0060, 10, -5 },
+  { "Reykjavik", 64.1466, -21.9426, 15, 0 },
+  { "Sydney", -33.8688, 151.2093, 58, 10 },
+};
+
+static double inputs[INPUTS];
+static long referenceN;
+static double ratios[INPUTS];
+static volatile double sink;
+static long allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void*
+__wrap_malloc(size_t size)
+{
+  allocations++;
+  return __real_malloc(size);
+}
+
+void*
+__wrap_calloc(size_t nmemb, size_t size)
+{
+  allocations++;
+  return __real_calloc(nmemb, size);
+}
+
+void*
+__wrap_realloc(void* ptr, size_t size)
+{
+  allocations++;
+  return __real_realloc(ptr, size);
+}
+
+static PT pt;
+static const char* cli;
+
+/**
+ * Reference kernel, independent of the library: a polynomial of the inputs,
+ * the unit of the relative timings compared against the baseline
+ **/
+static void
+benchReference(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++) {
+    double x = inputs[i % INPUTS] / 360;
+    sum += ((((0.0083 * x - 0.1666) * x) + 1.0) * x - 0.5) * x + 1.0;
+  }
+  sink = sum;
+}
+
+static void
+benchSin(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__sin(inputs[i % INPUTS]);
+  sink = sum;
+}
+
+static void
+benchCos(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__cos(inputs[i % INPUTS]);
+  sink = sum;
+}
+
+static void
+benchArccos(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__arccos(ratios[i % INPUTS]);
+  sink = sum;
+}
+
+static void
+benchArctan2(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__arctan2(ratios[i % INPUTS], ratios[(i + 1) % INPUTS]);
+  sink = sum;
+}
+
+static void
+benchJulianDay(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__julianDay(2000 + i % 50, 1 + i % 12, 1 + i % 28);
+  sink = sum;
+}
+
+static void
+benchSunPosition(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__sunPosition(2451545.0 + inputs[i % INPUTS] * 30).declination;
+  sink = sum;
+}
+
+static void
+benchSunAngleTime(long n)
+{
+  double sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PTM__sunAngleTime(2451545.0 + i % 3650,
+                             18.0,
+                             5 / 24.0,
+                             PTM_SD_CCW,
+                             inputs[i % INPUTS] / 6);
+  sink = sum;
+}
+
+static void
+benchGetTimes(long n)
+{
+  PT_PrayerTimes_t results;
+  double sum = 0;
+  for (long i = 0; i < n; i++) {
+    const BenchCity* city = &cities[i % (sizeof(cities) / sizeof(*cities))];
+    PT__getTimes(pt,
+                 results,
+                 2022,
+                 1 + i % 12,
+                 1 + i % 28,
+                 city->lat,
+                 city->lng,
+                 city->elv,
+                 city->tmz,
+                 0);
+    sum += results[PT_TN_ISHA];
+  }
+  sink = sum;
+}
+
+static void
+benchGetMethod(long n)
+{
+  long sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += PT__getMethod(pt);
+  sink = sum;
+}
+
+/**
+ * Share of the operations of a threaded benchmark
+ **/
+typedef struct bench_share_t
+{
+  Bench_t bench;
+  long n;
+} BenchShare;
+
+static void*
+runShare(void* arg)
+{
+  BenchShare* share = arg;
+  share->bench(share->n);
+  return NULL;
+}
+
+/**
+ * Run a benchmark function on THREADS threads sharing the instance, each
+ * running its share of the operations
+ *
+ * @param[in]  bench  Benchmark function
+ * @param[in]  n      Number of operations
+ **/
+static void
+runThreads(Bench_t bench, long n)
+{
+  pthread_t threads[THREADS];
+  BenchShare shares[THREADS];
+  for (int t = 0; t < THREADS; t++) {
+    shares[t].bench = bench;
+    shares[t].n = n / THREADS + (t < n % THREADS);
+    pthread_create(&threads[t], NULL, runShare, &shares[t]);
+  }
+  for (int t = 0; t < THREADS; t++)
+    pthread_join(threads[t], NULL);
+}
+
+static void
+benchGetMethodThreads(long n)
+{
+  runThreads(benchGetMethod, n);
+}
+
+static void
+benchGetTimesThreads(long n)
+{
+  runThreads(benchGetTimes, n);
+}
+
+static void
+benchGetTimesMethods(long n)
+{
+  PT_PrayerTimes_t results[PT_M_INDONESIA + 1];
+  double sum = 0;
+  for (long i = 0; i < n; i++) {
+    const BenchCity* city = &cities[i % (sizeof(cities) / sizeof(*cities))];
+    PT__getTimesMethods(pt,
+                        results,
+                        2022,
+                        1 + i % 12,
+                        1 + i % 28,
+                        city->lat,
+                        city->lng,
+                        city->elv,
+                        city->tmz,
+                        0);
+    sum += results[PT_M_INDONESIA][PT_TN_ISHA];
+  }
+  sink = sum;
+}
+
+static void
+benchGetTimesRange(long n)
+{
+  static PT_PrayerTimes_t results[365];
+  double sum = 0;
+  for (long i = 0; i < n; i += 365) {
+    const BenchCity* city =
+      &cities[(i / 365) % (sizeof(cities) / sizeof(*cities))];
+    int days = n - i < 365 ? n - i : 365;
+    PT__getTimesRange(pt,
+                      results,
+                      2022,
+                      1,
+                      1,
+                      days,
+                      city->lat,
+                      city->lng,
+                      city->elv,
+                      city->tmz,
+                      0);
+    sum += results[days - 1][PT_TN_ISHA];
+  }
+  sink = sum;
+}
+
+static void
+benchFormatTime(long n)
+{
+  for (long i = 0; i < n; i++) {
+    char* formatted = PT__formatTime(pt, inputs[i % INPUTS] / 15, NULL);
+    sink = formatted[4];
+    free(formatted);
+  }
+}
+
+static void
+benchFormatTimeTo(long n)
+{
+  PT_TimeFormatSpec_t spec = PT__compileFormat(NULL);
+  char buffer[PT_TIME_SIZE];
+  for (long i = 0; i < n; i++) {
+    PT__formatTimeTo(&spec, inputs[i % INPUTS] / 15, buffer, sizeof(buffer));
+    sink = buffer[4];
+  }
+}
+
+static void
+benchCliYear(long n)
+{
+  char command[512], buffer[4096];
+  for (long i = 0; i < n; i++) {
+    const BenchCity* city = &cities[i % (sizeof(cities) / sizeof(*cities))];
+    snprintf(command,
+             sizeof(command),
+             "%s --year=2022 --month=1 --day=1 --n=365 --detailed "
+             "--lat=%f --long=%f --elevation=%f --timezone=%d",
+             cli,
+             city->lat,
+             city->lng,
+             city->elv,
+             city->tmz);
+    FILE* output = popen(command, "r");
+    if (output == NULL) {
+      fprintf(stderr, "Failed to run: %s\n", command);
+      exit(1);
+    }
+    while (fread(buffer, 1, sizeof(buffer), output) > 0)
+      ;
+    if (pclose(output) != 0) {
+      fprintf(stderr, "Failed to run: %s\n", command);
+      exit(1);
+    }
+  }
+}
+
+/**
+ * Get monotonic time
+ *
+ * @return  Time (in seconds)
+ **/
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Scale the number of operations of a benchmark until a run takes long
+ * enough
+ *
+ * @param[in]   bench    Benchmark function
+ * @param[out]  elapsed  Time of the last run (in seconds)
+ * @return               Number of operations
+ **/
+static long
+calibrate(Bench_t bench, double* elapsed)
+{
+  long n = 1;
+  for (;;) {
+    double start = now();
+    bench(n);
+    *elapsed = now() - start;
+    if (*elapsed >= MIN_SECONDS)
+      return n;
+    n *= *elapsed > 0 && MIN_SECONDS / *elapsed < 10 ? 2 : 10;
+  }
+}
+
+/**
+ * Run benchmark, scaling the number of operations until a run takes long
+ * enough, then keeping the fastest of few runs, each following a run of the
+ * reference kernel so that both see the same state of the host
+ *
+ * @param[in]  name   Benchmark name
+ * @param[in]  bench  Benchmark function
+ * @param[in]  allocs Whether allocations are counted (not for subprocesses)
+ * @param[in]  gated  Whether the timing is compared against the baseline
+ *                    (not for threads & subprocesses, which depend on the
+ *                    cores & the system of the host more than on its speed)
+ * @return            Benchmark result
+ **/
+static BenchResult
+run(const char* name, Bench_t bench, const int allocs, const int gated)
+{
+  double elapsed, reference = 0;
+  long n = calibrate(bench, &elapsed);
+  for (int i = 0; i < REPEATS; i++) {
+    double start = now();
+    benchReference(referenceN);
+    double e = now() - start;
+    if (i == 0 || e < reference)
+      reference = e;
+    start = now();
+    bench(n);
+    e = now() - start;
+    if (e < elapsed)
+      elapsed = e;
+  }
+  long allocated = 0;
+  if (allocs) {
+    long before = allocations;
+    bench(n);
+    allocated = allocations - before;
+  }
+
+  BenchResult result;
+  result.name = name;
+  result.nsPerOp = elapsed * 1e9 / n;
+  result.opsPerSec = n / elapsed;
+  result.allocsPerOp = allocs ? (double)allocated / n : -1;
+  result.relative = (elapsed / n) / (reference / referenceN);
+  result.gated = gated;
+  fprintf(stderr,
+          "%-24s %14.2f ns/op %16.1f ops/s %10.2f x reference\n",
+          name,
+          result.nsPerOp,
+          result.opsPerSec,
+          result.relative);
+  return result;
+}
+
+/**
+ * Write results as JSON
+ *
+ * @param[in]  path     Output file path
+ * @param[in]  results  Benchmark results
+ * @param[in]  n        Number of results
+ * @return              0 on success, -1 on failure
+ **/
+static int
+writeResults(const char* path, const BenchResult* results, const int n)
+{
+  FILE* file = fopen(path, "w");
+  if (file == NULL)
+    return -1;
+  fprintf(file, "{\n  \"benchmarks\": [\n");
+  for (int i = 0; i < n; i++) {
+    fprintf(file,
+            "    { \"name\": \"%s\", \"ns_per_op\": %.3f, "
+            "\"ops_per_sec\": %.1f, \"relative\": %.3f, ",
+            results[i].name,
+            results[i].nsPerOp,
+            results[i].opsPerSec,
+            results[i].relative);
+    if (results[i].allocsPerOp < 0)
+      fprintf(file, "\"allocs_per_op\": null }");
+    else
+      fprintf(file, "\"allocs_per_op\": %.3f }", results[i].allocsPerOp);
+    fprintf(file, i + 1 < n ? ",\n" : "\n");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+/**
+ * Find numeric field of the named benchmark in the baseline JSON
+ *
+ * @param[in]   json   Baseline JSON
+ * @param[in]   name   Benchmark name
+ * @param[in]   field  Field name
+ * @param[out]  value  Field value
+ * @return             1 if found, 0 otherwise
+ **/
+static int
+findBaseline(const char* json,
+             const char* name,
+             const char* field,
+             double* value)
+{
+  char key[128];
+  snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+  const char* entry = strstr(json, key);
+  if (entry == NULL)
+    return 0;
+  const char* end = strchr(entry, '}');
+  snprintf(key, sizeof(key), "\"%s\": ", field);
+  const char* found = strstr(entry, key);
+  if (found == NULL || (end && found > end))
+    return 0;
+  char* parsed;
+  *value = strtod(found + strlen(key), &parsed);
+  return parsed != found + strlen(key);
+}
+
+/**
+ * Compare results against baseline JSON: the timings relative to the
+ * reference kernel of each run, so that the baseline holds across hosts of
+ * different speeds, & the allocations. A benchmark missing from the baseline
+ * fails until the baseline is recorded again.
+ *
+ * @param[in]  path       Baseline file path
+ * @param[in]  results    Benchmark results
+ * @param[in]  n          Number of results
+ * @param[in]  threshold  Allowed slowdown ratio
+ * @return                Number of regressions, -1 if baseline is unreadable
+ **/
+static int
+compareBaseline(const char* path,
+                const BenchResult* results,
+                const int n,
+                const double threshold)
+{
+  FILE* file = fopen(path, "r");
+  if (file == NULL)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char* json = size >= 0 ? malloc(size + 1) : NULL;
+  if (json == NULL) {
+    fclose(file);
+    return -1;
+  }
+  json[fread(json, 1, size, file)] = '\0';
+  fclose(file);
+
+  int regressions = 0;
+  for (int i = 0; i < n; i++) {
+    double relative, allocs;
+    if (!findBaseline(json, results[i].name, "relative", &relative)) {
+      fprintf(stderr, "%-24s no baseline REGRESSION\n", results[i].name);
+      regressions++;
+      continue;
+    }
+    double change = results[i].relative / relative - 1;
+    int regressed = results[i].gated && change > threshold;
+    if (results[i].allocsPerOp >= 0 &&
+        findBaseline(json, results[i].name, "allocs_per_op", &allocs) &&
+        results[i].allocsPerOp > allocs)
+      regressed = 1;
+    const char* verdict = regressed           ? "REGRESSION"
+                          : results[i].gated ? "ok"
+                                             : "not gated";
+    fprintf(
+      stderr, "%-24s %+7.1f%% %s\n", results[i].name, change * 100, verdict);
+    regressions += regressed;
+  }
+  free(json);
+  return regressions;
+}
+
+int
+main(int argc, char* argv[])
+{
+  const char *output = NULL, *baseline = NULL;
+  double threshold = 0.25;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--cli=", 6) == 0)
+      cli = argv[i] + 6;
+    if (strncmp(argv[i], "--output=", 9) == 0)
+      output = argv[i] + 9;
+    if (strncmp(argv[i], "--baseline=", 11) == 0)
+      baseline = argv[i] + 11;
+    if (strncmp(argv[i], "--threshold=", 12) == 0)
+      threshold = strtod(argv[i] + 12, NULL);
+  }
+
+  srand(1);
+  for (int i = 0; i < INPUTS; i++) {
+    inputs[i] = rand() * 720.0 / RAND_MAX - 360.0;
+    ratios[i] = rand() * 2.0 / RAND_MAX - 1.0;
+  }
+  pt = PT__new();
+  PT__tune(pt, 0.0f);
+
+  BenchResult results[MAX_RESULTS];
+  int n = 0;
+  double elapsed;
+  referenceN = calibrate(benchReference, &elapsed);
+  results[n++] = run("reference", benchReference, 1, 0);
+  results[n++] = run("PTM__sin", benchSin, 1, 1);
+  results[n++] = run("PTM__cos", benchCos, 1, 1);
+  results[n++] = run("PTM__arccos", benchArccos, 1, 1);
+  results[n++] = run("PTM__arctan2", benchArctan2, 1, 1);
+  results[n++] = run("PTM__julianDay", benchJulianDay, 1, 1);
+  results[n++] = run("PTM__sunPosition", benchSunPosition, 1, 1);
+  results[n++] = run("PTM__sunAngleTime", benchSunAngleTime, 1, 1);
+  results[n++] = run("PT__getTimes", benchGetTimes, 1, 1);
+  results[n++] = run("PT__getTimes_threads", benchGetTimesThreads, 0, 0);
+  results[n++] = run("PT__getMethod", benchGetMethod, 1, 1);
+  results[n++] = run("PT__getMethod_threads", benchGetMethodThreads, 0, 0);
+  results[n++] = run("PT__getTimesRange", benchGetTimesRange, 1, 1);
+  results[n++] = run("PT__getTimesMethods", benchGetTimesMethods, 1, 1);
+  results[n++] = run("PT__formatTime", benchFormatTime, 1, 1);
+  results[n++] = run("PT__formatTimeTo", benchFormatTimeTo, 1, 1);
+  if (cli)
+    results[n++] = run("praytimes_cli_year", benchCliYear, 0, 0);
+
+  PT__free(&pt);
+
+  if (output && writeResults(output, results, n) != 0) {
+    fprintf(stderr, "Failed to write results: %s\n", output);
+    return 1;
+  }
+  if (baseline) {
+    int regressions = compareBaseline(baseline, results, n, threshold);
+    if (regressions < 0) {
+      fprintf(stderr, "Failed to read baseline: %s\n", baseline);
+      return 1;
+    }
+    if (regressions > 0) {
+      fprintf(stderr, "%d benchmark(s) regressed\n", regressions);
+      return 1;
+    }
+  }
+
+  return 0;
+}
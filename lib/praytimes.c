@@ -1,8 +1,14 @@
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "praytimes.h"
+#include "praytimes_ephemeris.h"
 #include "praytimes_math.h"
+#include "praytimes_simd.h"
+#include "praytimes_zone.h"
 
 /**
  * PrayTimes's settings struct data type.
@@ -19,26 +25,608 @@ typedef struct private_pt_settings_t
   PT_HighLatMethod_t highlats;
 } PT_Settings_t;
 
+/**
+ * Attribute of the helpers inlined into the specialised pipelines.
+ **/
+#define PT_SPECIALISE __attribute__((always_inline))
+
+/**
+ * Maximum number of result cache shards.
+ **/
+#define PT_CACHE_SHARDS 16
+
+#ifdef PT_STATS
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PT__ticks() __rdtsc()
+#elif defined(__GNUC__) && defined(__aarch64__)
+static inline unsigned long long
+PT__ticks(void)
+{
+  unsigned long long ticks;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+}
+#else
+#include <time.h>
+#define PT__ticks() ((unsigned long long)clock())
+#endif
+
+/**
+ * Instrumentation statistics of the process, updated atomically
+ **/
+static PT_Stats_t instrumentation;
+
+/**
+ * Record a call of a stage
+ *
+ * @param[in]  stage
+ * @param[in]  start  Ticks at the start of the call
+ **/
+static inline void
+PT__recordStage(const PT_Stage_t stage, const unsigned long long start)
+{
+  __atomic_fetch_add(&instrumentation.calls[stage], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(
+    &instrumentation.ticks[stage], PT__ticks() - start, __ATOMIC_RELAXED);
+}
+
+/**
+ * Count the times without hour angle
+ *
+ * @param[in]  times
+ * @param[in]  mask   Computed times
+ * @return
+ **/
+static inline unsigned long
+PT__countNaN(const PT_PrayerTimes_t times, const unsigned mask)
+{
+  unsigned long n = 0;
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+    n += (mask & PT_TN_MASK(i)) && isnan(times[i]);
+  return n;
+}
+
+#define PT_STATS_BEGIN(start) const unsigned long long start = PT__ticks()
+#define PT_STATS_END(stage, start) PT__recordStage(stage, start)
+#define PT_STATS_STAGE(stage, statement)                                      \
+  do {                                                                        \
+    PT_STATS_BEGIN(_start);                                                   \
+    statement;                                                                \
+    PT_STATS_END(stage, _start);                                              \
+  } while (0)
+#define PT_STATS_COUNT(counter, n)                                            \
+  __atomic_fetch_add(&instrumentation.counter, n, __ATOMIC_RELAXED)
+
+#else
+
+#define PT_STATS_BEGIN(start)
+#define PT_STATS_END(stage, start)
+#define PT_STATS_STAGE(stage, statement) statement
+#define PT_STATS_COUNT(counter, n)
+
+#endif
+
 typedef double PT_Offsets_t[PT_TN_MIDNIGHT + 1];
 
 typedef double PT_Times_t[PT_TN_MIDNIGHT + 1];
 
 /**
- * Real PrayTimes struct data type.
+ * Sun positions of a date, sampled at the default time of each prayer.
  **/
-typedef struct private_pt_t
+typedef struct private_pt_ephemeris_t
+{
+  double decl[PT_TN_MIDNIGHT];
+  double noon[PT_TN_MIDNIGHT];
+} PT_Ephemeris_t;
+
+static const PT_Times_t defaultTimes = { 5 / 24.0f,  /* Imsak */
+                                         5 / 24.0f,  /* Fajr */
+                                         6 / 24.0f,  /* Sunrise */
+                                         12 / 24.0f, /* Dhuhr */
+                                         13 / 24.0f, /* Asr */
+                                         18 / 24.0f, /* Sunset */
+                                         18 / 24.0f, /* Maghrib */
+                                         18 / 24.0f, /* Isha */
+                                         0 };        /* Midnight */
+
+/**
+ * Result cache key: a grid point & a date, without time adjustment, or an
+ * exact location & a date, with its UTC offset. Keys compare bitwise.
+ **/
+typedef struct private_pt_cache_key_t
+{
+  double lat; /* latitude index of a grid point, exact latitude otherwise */
+  double lng; /* 0 for a grid point */
+  double elv;
+  int jDate;
+  int zone; /* timezone + dst, 0 for a grid point */
+} PT_CacheKey_t;
+
+typedef char PT_CacheKeyPacked[sizeof(PT_CacheKey_t) == 4 * 8 ? 1 : -1];
+
+/**
+ * Result cache entry: the times of a key
+ **/
+typedef struct private_pt_cache_entry_t
+{
+  PT_CacheKey_t key;
+  double decl[2]; /* lowest & highest sun declination of the times */
+  PT_PrayerTimes_t times;
+  int prev;  /* more recently used entry, -1 for the head */
+  int next;  /* less recently used entry, -1 for the tail */
+  int chain; /* next entry of the same bucket, -1 for the last */
+} PT_CacheEntry_t;
+
+/**
+ * Result cache shard: a hash table of entries chained per bucket, with a
+ * least recently used list, behind its own lock.
+ **/
+typedef struct private_pt_cache_shard_t
+{
+  pthread_mutex_t lock;
+  PT_CacheEntry_t* entries;
+  int* buckets;
+  size_t capacity;
+  size_t size;
+  size_t mask;
+  int head;
+  int tail;
+  unsigned long hits;   /* atomic */
+  unsigned long misses; /* atomic */
+} PT_CacheShard_t;
+
+/**
+ * Result cache: the keys are spread over shards by hash, so that lookups
+ * from many threads seldom wait for the same lock.
+ **/
+typedef struct private_pt_cache_t
+{
+  size_t shards;     /* power of 2, at most PT_CACHE_SHARDS */
+  double latQuantum; /* 0 for exact keys */
+  double elvQuantum;
+  unsigned long config;     /* configuration hash of the cached entries */
+  unsigned long generation; /* configuration the entries are valid for,
+                               updated with every shard locked */
+  PT_CacheShard_t shard[PT_CACHE_SHARDS];
+} PT_Cache_t;
+
+typedef struct private_pt_pipeline_t PT_Pipeline_t;
+
+/**
+ * Configuration snapshot of a PrayTimes instance, which the computations read
+ * as their instance. Immutable once published, shared by reference counting.
+ **/
+typedef struct private_pt_config_t
 {
   PT_Method_t method;
   PT_Settings_t settings;
   PT_Offsets_t offsets;
+  PTE table;
+  int iterations;
+  double threshold;
+  PT_Precision_t precision;
+  const PT_Pipeline_t* pipeline; /* specialised to the configuration */
+  unsigned long generation;      /* configuration, unique to the process */
 
   double offset;
+
+  /* last, not copied (see PT__copyConfig) */
+  unsigned long references;
+  int embedded; /* the initial snapshot, in the storage of the instance */
 } * PrivatePT;
 
+/**
+ * Real PrayTimes struct data type.
+ *
+ * The configuration snapshot & the result cache are published RCU-style: the
+ * computations read them in lock-free read sections, which only write the
+ * state of their thread (see PT__readBegin), the updates replace them & wait
+ * for the sections entered before to reclaim the previous ones (see
+ * PT__synchronize).
+ **/
+typedef struct private_pt_t
+{
+  PrivatePT config;
+  PT_Cache_t* cache;
+  pthread_mutex_t update; /* serializes the updates */
+  struct private_pt_config_t initial;
+} PT_Instance_t;
+
+typedef char PT_StorageFits[sizeof(PT_Instance_t) <= sizeof(PT_Storage_t) ? 1
+                                                                          : -1];
+
+/**
+ * Stream of the prayers of many locations
+ **/
+typedef struct private_pt_events_t
+{
+  PT pt;
+  PT_Location_t* locations;
+  double end;
+  size_t count;       /* locations with an event before the end */
+  PT_Event_t heap[]; /* next event of each of them, earliest first */
+} PT_Events_t;
+
+/**
+ * Last configuration generation of the process
+ **/
+static unsigned long generations;
+
+/**
+ * Read section state of a thread, registered at its first read section &
+ * unregistered when it exits
+ **/
+typedef struct private_pt_reader_t
+{
+  unsigned long epoch;   /* entered by the outermost section, 0 outside */
+  unsigned long nesting; /* sections entered, written by the thread only */
+  struct private_pt_reader_t* next;
+} PT_Reader_t;
+
+/**
+ * Registered readers of the process, scanned by the grace periods
+ **/
+static PT_Reader_t* readers;
+
+/**
+ * Serializes the reader registrations & the grace periods
+ **/
+static pthread_mutex_t readersLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Last grace period started, never 0
+ **/
+static unsigned long epochs = 1;
+
+/**
+ * Read sections of the threads which failed to register, out of memory
+ **/
+static unsigned long anonymousReaders;
+
+/**
+ * Thread-specific key unregistering the readers of exiting threads
+ **/
+static pthread_key_t readerKey;
+static pthread_once_t readerOnce = PTHREAD_ONCE_INIT;
+static int readerKeyed;
+
+/**
+ * Reader of the calling thread, NULL until registered
+ **/
+static __thread PT_Reader_t* reader;
+static __thread int readerFailed;
+
+/**
+ * Prayer times pipeline, specialised at compile time to a method, a higher
+ * latitudes method & an asr juristic (see PT__selectPipeline).
+ **/
+struct private_pt_pipeline_t
+{
+  /* compute the times from the sun positions, then finish them */
+  void (*compute)(const PrivatePT pt,
+                  PT_PrayerTimes_t results,
+                  const double lat,
+                  const PT_Ephemeris_t* ephemeris,
+                  const double riseSetAngle,
+                  const double timeAdjust);
+  /* finish computed times: high latitudes, adjustments, midnight & tuning */
+  void (*finish)(const PrivatePT pt, PT_PrayerTimes_t results);
+};
+
+static void
+PT__selectPipeline(PrivatePT pt);
+
+/**
+ * Hash bytes (FNV-1a)
+ *
+ * @param[in]  hash
+ * @param[in]  data
+ * @param[in]  size
+ * @return
+ **/
+static inline unsigned long
+PT__hash(unsigned long hash, const void* data, const size_t size)
+{
+  const unsigned char* bytes = data;
+  for (size_t i = 0; i < size; i++)
+    hash = (hash ^ bytes[i]) * 0x100000001b3UL;
+  return hash;
+}
+
+/**
+ * Hash the configuration the times depend on
+ *
+ * The settings are hashed field by field, their padding is not initialized.
+ *
+ * @param[in]  pt
+ * @return
+ **/
+static unsigned long
+PT__configHash(const PrivatePT pt)
+{
+  unsigned long hash = 0xcbf29ce484222325UL;
+  hash = PT__hash(hash, &pt->method, sizeof(pt->method));
+  hash = PT__hash(hash, &pt->settings.imsak, sizeof(double));
+  hash = PT__hash(hash, &pt->settings.fajr, sizeof(double));
+  hash = PT__hash(hash, &pt->settings.dhuhr, sizeof(double));
+  hash = PT__hash(hash, &pt->settings.asr, sizeof(pt->settings.asr));
+  hash = PT__hash(hash, &pt->settings.maghrib, sizeof(double));
+  hash = PT__hash(hash, &pt->settings.isha, sizeof(double));
+  hash = PT__hash(hash, &pt->settings.midnight, sizeof(pt->settings.midnight));
+  hash = PT__hash(hash, &pt->settings.highlats, sizeof(pt->settings.highlats));
+  hash = PT__hash(hash, pt->offsets, sizeof(pt->offsets));
+  hash = PT__hash(hash, &pt->table, sizeof(pt->table));
+  hash = PT__hash(hash, &pt->iterations, sizeof(pt->iterations));
+  hash = PT__hash(hash, &pt->threshold, sizeof(pt->threshold));
+  hash = PT__hash(hash, &pt->precision, sizeof(pt->precision));
+  return hash;
+}
+
+/**
+ * Empty a result cache shard
+ *
+ * @param[out]  shard
+ **/
+static void
+PT__clearCache(PT_CacheShard_t* shard)
+{
+  for (size_t i = 0; i <= shard->mask; i++)
+    shard->buckets[i] = -1;
+  shard->size = 0;
+  shard->head = -1;
+  shard->tail = -1;
+}
+
+/**
+ * Select the pipeline & start a new generation of a modified configuration
+ *
+ * @param[out]  config
+ **/
+static void
+PT__configChanged(PrivatePT config)
+{
+  PT__selectPipeline(config);
+  config->generation = __atomic_add_fetch(&generations, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Unregister the reader of an exiting thread
+ *
+ * @param[in]  arg  Reader
+ **/
+static void
+PT__readerExit(void* arg)
+{
+  pthread_mutex_lock(&readersLock);
+  PT_Reader_t** link = &readers;
+  while (*link != arg)
+    link = &(*link)->next;
+  *link = ((PT_Reader_t*)arg)->next;
+  pthread_mutex_unlock(&readersLock);
+  free(arg);
+}
+
+static void
+PT__readerKey(void)
+{
+  readerKeyed = pthread_key_create(&readerKey, PT__readerExit) == 0;
+}
+
+/**
+ * Register the reader of the calling thread, once
+ *
+ * @return  Reader, NULL when out of memory (the sections of the thread then
+ *          count in anonymousReaders)
+ **/
+static PT_Reader_t*
+PT__readerRegister(void)
+{
+  pthread_once(&readerOnce, PT__readerKey);
+  PT_Reader_t* self = readerKeyed ? calloc(1, sizeof(PT_Reader_t)) : NULL;
+  if (self && pthread_setspecific(readerKey, self) != 0) {
+    free(self);
+    self = NULL;
+  }
+  if (self == NULL) {
+    readerFailed = 1;
+    return NULL;
+  }
+  pthread_mutex_lock(&readersLock);
+  self->next = readers;
+  readers = self;
+  pthread_mutex_unlock(&readersLock);
+  reader = self;
+  return self;
+}
+
+/**
+ * Enter a read section of an instance: the configuration snapshot & the
+ * result cache published when entering stay valid until leaving it. Read
+ * sections take no lock and only write the reader of their thread; they may
+ * nest, but may not update an instance.
+ *
+ * @param[in]  pt
+ * @return         Configuration snapshot
+ **/
+static inline PrivatePT
+PT__readBegin(const PT pt)
+{
+  PT_Reader_t* self = reader;
+  if (self == NULL && !readerFailed)
+    self = PT__readerRegister();
+  if (self == NULL)
+    __atomic_add_fetch(&anonymousReaders, 1, __ATOMIC_SEQ_CST);
+  else if (self->nesting++ == 0)
+    __atomic_store_n(&self->epoch,
+                     __atomic_load_n(&epochs, __ATOMIC_ACQUIRE),
+                     __ATOMIC_SEQ_CST);
+  return __atomic_load_n(&((PT_Instance_t*)pt)->config, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Leave the read section last entered by the calling thread
+ **/
+static inline void
+PT__readEnd(void)
+{
+  PT_Reader_t* self = reader;
+  if (self == NULL)
+    __atomic_sub_fetch(&anonymousReaders, 1, __ATOMIC_RELEASE);
+  else if (--self->nesting == 0)
+    __atomic_store_n(&self->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Wait for the read sections entered before, after which the data replaced
+ * meanwhile is no longer read: a new epoch starts, then the readers still in
+ * a section of an earlier one are waited for. The sections of the calling
+ * thread are not waited for.
+ **/
+static void
+PT__synchronize(void)
+{
+  pthread_mutex_lock(&readersLock);
+  unsigned long epoch = __atomic_add_fetch(&epochs, 1, __ATOMIC_SEQ_CST);
+  if (epoch == 0)
+    epoch = __atomic_add_fetch(&epochs, 1, __ATOMIC_SEQ_CST);
+  for (PT_Reader_t* other = readers; other; other = other->next) {
+    unsigned long entered;
+    while (other != reader &&
+           (entered = __atomic_load_n(&other->epoch, __ATOMIC_SEQ_CST)) &&
+           entered != epoch)
+      sched_yield();
+  }
+  while (__atomic_load_n(&anonymousReaders, __ATOMIC_SEQ_CST))
+    sched_yield();
+  pthread_mutex_unlock(&readersLock);
+}
+
+/**
+ * Drop a reference to a configuration snapshot, freed with the last one
+ *
+ * @param[in]  config
+ **/
+static void
+PT__dropConfig(PrivatePT config)
+{
+  if (__atomic_sub_fetch(&config->references, 1, __ATOMIC_ACQ_REL) == 0 &&
+      !config->embedded)
+    free(config);
+}
+
+/**
+ * Copy a configuration snapshot, the count of its references read by no one
+ *
+ * @param[in]  config
+ * @return             Private copy, NULL when out of memory
+ **/
+static PrivatePT
+PT__copyConfig(const PrivatePT config)
+{
+  PrivatePT copy = malloc(sizeof(struct private_pt_config_t));
+  if (copy == NULL)
+    return NULL;
+  memcpy(copy, config, offsetof(struct private_pt_config_t, references));
+  copy->references = 1;
+  copy->embedded = 0;
+  return copy;
+}
+
+/**
+ * Free a result cache
+ *
+ * @param[in]  cache
+ **/
+static void
+PT__freeCache(PT_Cache_t* cache)
+{
+  if (cache == NULL)
+    return;
+  for (size_t s = 0; s < cache->shards; s++) {
+    pthread_mutex_destroy(&cache->shard[s].lock);
+    free(cache->shard[s].entries);
+    free(cache->shard[s].buckets);
+  }
+  free(cache);
+}
+
+/**
+ * Publish a configuration snapshot & reclaim the previous one once no longer
+ * read, invalidating the result cache when the configuration changed; the
+ * caller holds the update lock
+ *
+ * @param[in,out]  instance
+ * @param[in]      config    Snapshot, whose reference the instance takes
+ **/
+static void
+PT__publish(PT_Instance_t* instance, PrivatePT config)
+{
+  PT_Cache_t* cache = instance->cache;
+  if (cache) {
+    unsigned long hash = PT__configHash(config);
+    for (size_t s = 0; s < cache->shards; s++)
+      pthread_mutex_lock(&cache->shard[s].lock);
+    for (size_t s = 0; s < cache->shards && cache->config != hash; s++)
+      PT__clearCache(&cache->shard[s]);
+    cache->config = hash;
+    __atomic_store_n(&cache->generation, config->generation, __ATOMIC_RELEASE);
+    for (size_t s = 0; s < cache->shards; s++)
+      pthread_mutex_unlock(&cache->shard[s].lock);
+  }
+
+  PrivatePT previous = instance->config;
+  __atomic_store_n(&instance->config, config, __ATOMIC_SEQ_CST);
+  PT__synchronize();
+  PT__dropConfig(previous);
+}
+
+/**
+ * Start an update of the configuration: lock out the other updates & copy
+ * the published snapshot to modify it
+ *
+ * @param[in,out]  pt
+ * @return             Private copy, NULL when out of memory
+ **/
+static PrivatePT
+PT__updateBegin(PT pt)
+{
+  PT_Instance_t* instance = (PT_Instance_t*)pt;
+  pthread_mutex_lock(&instance->update);
+  PrivatePT config = PT__copyConfig(instance->config);
+  if (config == NULL)
+    pthread_mutex_unlock(&instance->update);
+  return config;
+}
+
+/**
+ * Publish the modified copy of an update
+ *
+ * @param[in,out]  pt
+ * @param[in]      config  Copy returned by PT__updateBegin
+ **/
+static void
+PT__updateEnd(PT pt, PrivatePT config)
+{
+  PT_Instance_t* instance = (PT_Instance_t*)pt;
+  PT__configChanged(config);
+  PT__publish(instance, config);
+  pthread_mutex_unlock(&instance->update);
+}
+
+size_t
+PT__sizeof(void)
+{
+  return sizeof(PT_Instance_t);
+}
+
 PT
-PT__new(void)
+PT__init(void* storage)
 {
-  PrivatePT pt = malloc(sizeof(struct private_pt_t));
+  PT_Instance_t* instance = storage;
+  memset(instance, 0, sizeof(PT_Instance_t));
+  PrivatePT pt = &instance->initial;
   pt->method = PT_M_MWL;
   pt->settings.imsak = 10.0f;
   pt->settings.fajr = 18.0f;
@@ -48,21 +636,92 @@ PT__new(void)
   pt->settings.isha = 17.0f;
   pt->settings.midnight = PT_MM_STANDARD;
   pt->settings.highlats = PT_HL_NIGHT_MIDDLE;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    pt->offsets[i] = 0.0f;
+  pt->table = NULL;
+  pt->iterations = 1;
+  pt->threshold = 0.0f;
+  pt->precision = PT_P_EXACT;
+  pt->references = 1;
+  pt->embedded = 1;
+  pt->offset = 0.0f;
+  PT__configChanged(pt);
+
+  instance->config = pt;
+  instance->cache = NULL;
+  pthread_mutex_init(&instance->update, NULL);
+
+  return (PT)instance;
+}
+
+void
+PT__deinit(PT pt)
+{
+  PT_Instance_t* instance = (PT_Instance_t*)pt;
+  PT__dropConfig(instance->config);
+  PT__freeCache(instance->cache);
+  pthread_mutex_destroy(&instance->update);
+}
 
-  return (PT)pt;
+PT
+PT__new(void)
+{
+  void* storage = malloc(sizeof(PT_Instance_t));
+  if (storage == NULL)
+    return NULL;
+  return PT__init(storage);
 }
 
 void
 PT__free(PT* pt)
 {
+  PT__deinit(*pt);
   free(*pt);
   *pt = NULL;
 }
 
+PT_Config
+PT__getConfig(const PT pt)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  if (_pt->embedded) /* a copy outlives the storage of the instance */
+    _pt = PT__copyConfig(_pt);
+  else
+    __atomic_add_fetch(&_pt->references, 1, __ATOMIC_RELAXED);
+  PT__readEnd();
+  return (PT_Config)_pt;
+}
+
 void
-PT__setMethod(PT pt, const PT_Method_t method)
+PT__setConfig(PT pt, const PT_Config config)
+{
+  PT_Instance_t* instance = (PT_Instance_t*)pt;
+  PrivatePT _config = (PrivatePT)config;
+  if (_config == NULL)
+    return;
+  __atomic_add_fetch(&_config->references, 1, __ATOMIC_RELAXED);
+  pthread_mutex_lock(&instance->update);
+  PT__publish(instance, _config);
+  pthread_mutex_unlock(&instance->update);
+}
+
+void
+PT__releaseConfig(PT_Config* config)
+{
+  if (*config)
+    PT__dropConfig((PrivatePT)*config);
+  *config = NULL;
+}
+
+/**
+ * Set the calculation method of a configuration, with its parameters
+ *
+ * @param[out]  _pt
+ * @param[in]   method
+ **/
+static void
+PT__applyMethod(PrivatePT _pt, const PT_Method_t method)
 {
-  PrivatePT _pt = (PrivatePT)pt;
   _pt->method = method;
   switch (method) {
     default:
@@ -105,6 +764,16 @@ PT__setMethod(PT pt, const PT_Method_t method)
   }
 }
 
+void
+PT__setMethod(PT pt, const PT_Method_t method)
+{
+  PrivatePT _pt = PT__updateBegin(pt);
+  if (_pt == NULL)
+    return;
+  PT__applyMethod(_pt, method);
+  PT__updateEnd(pt, _pt);
+}
+
 void
 PT__adjust(PT pt,
            const double imsak,
@@ -116,7 +785,9 @@ PT__adjust(PT pt,
            const PT_MidnightMethod_t midnight,
            const PT_HighLatMethod_t highlats)
 {
-  PrivatePT _pt = (PrivatePT)pt;
+  PrivatePT _pt = PT__updateBegin(pt);
+  if (_pt == NULL)
+    return;
   _pt->settings.imsak = imsak;
   _pt->settings.fajr = fajr;
   _pt->settings.dhuhr = dhuhr;
@@ -125,12 +796,15 @@ PT__adjust(PT pt,
   _pt->settings.isha = isha;
   _pt->settings.midnight = midnight;
   _pt->settings.highlats = highlats;
+  PT__updateEnd(pt, _pt);
 }
 
 void
 PT__tune(PT pt, const double offsets)
 {
-  PrivatePT _pt = (PrivatePT)pt;
+  PrivatePT _pt = PT__updateBegin(pt);
+  if (_pt == NULL)
+    return;
   _pt->offsets[PT_TN_IMSAK] = offsets;
   _pt->offsets[PT_TN_FAJR] = offsets;
   /* _pt->offsets[PT_TN_SUNRISE] = offsets; */
@@ -140,81 +814,316 @@ PT__tune(PT pt, const double offsets)
   _pt->offsets[PT_TN_MAGHRIB] = offsets;
   _pt->offsets[PT_TN_ISHA] = offsets;
   /* _pt->offsets[PT_TN_MIDNIGHT] = offsets; */
+  PT__updateEnd(pt, _pt);
 }
 
-PT_Method_t
-PT__getMethod(const PT pt)
+void
+PT__refine(PT pt, const int iterations, const double threshold)
 {
-  PrivatePT _pt = (PrivatePT)pt;
-  return _pt->method;
+  PrivatePT _pt = PT__updateBegin(pt);
+  if (_pt == NULL)
+    return;
+  _pt->iterations = iterations > 1 ? iterations : 1;
+  _pt->threshold = threshold;
+  PT__updateEnd(pt, _pt);
 }
 
-double
-PT__getOffset(const PT pt)
+void
+PT__setPrecision(PT pt, const PT_Precision_t precision)
 {
-  PrivatePT _pt = (PrivatePT)pt;
-  return _pt->offset;
+  PrivatePT _pt = PT__updateBegin(pt);
+  if (_pt == NULL)
+    return;
+  _pt->precision = precision;
+  PT__updateEnd(pt, _pt);
 }
 
-/**
- * Calculate asr time
- *
- * @param[in]  jDate
- * @param[in]  asrJuristic
- * @param[in]  time
- * @param[in]  lat
- * @return
- **/
-static inline double
-PT__asrTime(const double jDate,
-            const PT_AsrJuristic_t asrJuristic,
-            const double time,
-            const double lat)
+void
+PT__setEphemeris(PT pt, const PTE pte)
 {
-  double asrFactor = asrJuristic == PT_AJ_STANDARD ? 1.0f : 2.0f;
-  double decl = PTM__sunPositionDeclination(jDate + time);
-  double angle = -PTM__arccot(asrFactor + PTM__tan(fabs(lat - decl)));
-  return PTM__sunAngleTime(jDate, angle, time, PTM_SD_CW, lat);
+  PrivatePT _pt = PT__updateBegin(pt);
+  if (_pt == NULL)
+    return;
+  _pt->table = pte;
+  PT__updateEnd(pt, _pt);
 }
 
-/**
- * Adjust time for higher lattitude
- *
- * @param[in]  method
- * @param[in]  time
- * @param[in]  base
+void
+PT__setCache(PT pt,
+             const size_t capacity,
+             const double latQuantum,
+             const double elvQuantum)
+{
+  PT_Instance_t* instance = (PT_Instance_t*)pt;
+  PT_Cache_t* cache = NULL;
+  pthread_mutex_lock(&instance->update);
+  if (capacity > 0 && latQuantum >= 0 && capacity <= 1 << 30 &&
+      (cache = malloc(sizeof(PT_Cache_t))) != NULL) {
+    /* the capacity split over the shards, each holding at least an entry */
+    cache->shards = 1;
+    while (cache->shards < PT_CACHE_SHARDS && cache->shards * 2 <= capacity)
+      cache->shards *= 2;
+    size_t s = 0;
+    for (; s < cache->shards; s++) {
+      PT_CacheShard_t* shard = &cache->shard[s];
+      size_t buckets = 1;
+      shard->capacity =
+        capacity / cache->shards + (s < capacity % cache->shards);
+      while (buckets < shard->capacity * 2)
+        buckets *= 2;
+      shard->entries = malloc(shard->capacity * sizeof(PT_CacheEntry_t));
+      shard->buckets = malloc(buckets * sizeof(int));
+      if (shard->entries == NULL || shard->buckets == NULL) {
+        free(shard->entries);
+        free(shard->buckets);
+        break;
+      }
+      pthread_mutex_init(&shard->lock, NULL);
+      shard->mask = buckets - 1;
+      shard->hits = 0;
+      shard->misses = 0;
+      PT__clearCache(shard);
+    }
+    if (s < cache->shards) {
+      cache->shards = s;
+      PT__freeCache(cache);
+      cache = NULL;
+    } else {
+      cache->latQuantum = latQuantum;
+      cache->elvQuantum = elvQuantum > 0 ? elvQuantum : 0;
+      cache->config = PT__configHash(instance->config);
+      cache->generation = instance->config->generation;
+    }
+  }
+
+  PT_Cache_t* previous = instance->cache;
+  __atomic_store_n(&instance->cache, cache, __ATOMIC_SEQ_CST);
+  PT__synchronize();
+  PT__freeCache(previous);
+  pthread_mutex_unlock(&instance->update);
+}
+
+PT_CacheStats_t
+PT__getCacheStats(const PT pt)
+{
+  PT_CacheStats_t stats = { 0, 0, 0 };
+  PT__readBegin(pt);
+  PT_Cache_t* cache =
+    __atomic_load_n(&((PT_Instance_t*)pt)->cache, __ATOMIC_SEQ_CST);
+  for (size_t s = 0; cache && s < cache->shards; s++) {
+    PT_CacheShard_t* shard = &cache->shard[s];
+    stats.hits += __atomic_load_n(&shard->hits, __ATOMIC_RELAXED);
+    stats.misses += __atomic_load_n(&shard->misses, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&shard->lock);
+    stats.entries += shard->size;
+    pthread_mutex_unlock(&shard->lock);
+  }
+  PT__readEnd();
+  return stats;
+}
+
+int
+PT__getStats(PT_Stats_t* stats)
+{
+#ifdef PT_STATS
+  for (int i = 0; i < PT_STAGE_COUNT; i++) {
+    stats->calls[i] =
+      __atomic_load_n(&instrumentation.calls[i], __ATOMIC_RELAXED);
+    stats->ticks[i] =
+      __atomic_load_n(&instrumentation.ticks[i], __ATOMIC_RELAXED);
+  }
+  stats->highLatFallbacks =
+    __atomic_load_n(&instrumentation.highLatFallbacks, __ATOMIC_RELAXED);
+  stats->nanHourAngles =
+    __atomic_load_n(&instrumentation.nanHourAngles, __ATOMIC_RELAXED);
+  return 0;
+#else
+  memset(stats, 0, sizeof(PT_Stats_t));
+  return -1;
+#endif
+}
+
+void
+PT__resetStats(void)
+{
+#ifdef PT_STATS
+  for (int i = 0; i < PT_STAGE_COUNT; i++) {
+    __atomic_store_n(&instrumentation.calls[i], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&instrumentation.ticks[i], 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&instrumentation.highLatFallbacks, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&instrumentation.nanHourAngles, 0, __ATOMIC_RELAXED);
+#endif
+}
+
+PT_Method_t
+PT__getMethod(const PT pt)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  PT_Method_t method = _pt->method;
+  PT__readEnd();
+  return method;
+}
+
+double
+PT__getOffset(const PT pt)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  double offset = _pt->offset;
+  PT__readEnd();
+  return offset;
+}
+
+PT_Parameters_t
+PT__getParameters(const PT pt)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  PT_Parameters_t parameters;
+  parameters.method = _pt->method;
+  parameters.imsak = _pt->settings.imsak;
+  parameters.fajr = _pt->settings.fajr;
+  parameters.dhuhr = _pt->settings.dhuhr;
+  parameters.asr = _pt->settings.asr;
+  parameters.maghrib = _pt->settings.maghrib;
+  parameters.isha = _pt->settings.isha;
+  parameters.midnight = _pt->settings.midnight;
+  parameters.highlats = _pt->settings.highlats;
+  memcpy(parameters.offsets, _pt->offsets, sizeof(parameters.offsets));
+  PT__readEnd();
+  return parameters;
+}
+
+/**
+ * Compute the time of given angle of sun from a known sun position, in the
+ * precision of the instance
+ *
+ * @param[in]  pt
+ * @param[in]  decl
+ * @param[in]  noon
  * @param[in]  angle
- * @param[in]  night
  * @param[in]  direction
+ * @param[in]  lat
  * @return
  **/
 static inline double
-PT__adjustHLTime(const PT_HighLatMethod_t method,
-                 const double time,
-                 const double base,
-                 const double angle,
-                 const double night,
-                 const PTM_SunDirection_t direction)
+PT__sunAngleTimeAt(const PrivatePT pt,
+                   const double decl,
+                   const double noon,
+                   const double angle,
+                   const PTM_SunDirection_t direction,
+                   const double lat)
+{
+  switch (pt->precision) {
+    default:
+    case PT_P_EXACT:
+      return PTM__sunAngleTimeAt(decl, noon, angle, direction, lat);
+    case PT_P_FAST:
+      return PTV__sunAngleTimeAtFast(decl, noon, angle, direction, lat);
+    case PT_P_FLOAT:
+      return PTM__sunAngleTimeAtF(decl, noon, angle, direction, lat);
+  }
+}
+
+/**
+ * Calculate angle of sun at asr time
+ *
+ * @param[in]  pt
+ * @param[in]  asr
+ * @param[in]  decl
+ * @param[in]  lat
+ * @return
+ **/
+static inline PT_SPECIALISE double
+PT__asrAngle(const PrivatePT pt,
+             const PT_AsrJuristic_t asr,
+             const double decl,
+             const double lat)
+{
+  double asrFactor = asr == PT_AJ_STANDARD ? 1.0f : 2.0f;
+  switch (pt->precision) {
+    default:
+    case PT_P_EXACT:
+      return -PTM__arccot(asrFactor + PTM__tan(fabs(lat - decl)));
+    case PT_P_FAST:
+      return -PTV__arccotFast(asrFactor + PTV__tanFast(fabs(lat - decl)));
+    case PT_P_FLOAT:
+      return -PTM__arccotF(asrFactor +
+                           PTM__tanF(fabsf((float)lat - (float)decl)));
+  }
+}
+
+/**
+ * Calculate asr time
+ *
+ * @param[in]  pt
+ * @param[in]  asr
+ * @param[in]  decl
+ * @param[in]  noon
+ * @param[in]  lat
+ * @return
+ **/
+static inline PT_SPECIALISE double
+PT__asrTime(const PrivatePT pt,
+            const PT_AsrJuristic_t asr,
+            const double decl,
+            const double noon,
+            const double lat)
+{
+  return PT__sunAngleTimeAt(
+    pt, decl, noon, PT__asrAngle(pt, asr, decl, lat), PTM_SD_CW, lat);
+}
+
+/**
+ * Portion of the night bounding a time for higher lattitude
+ *
+ * @param[in]  method
+ * @param[in]  angle
+ * @param[in]  night
+ * @return
+ **/
+static inline PT_SPECIALISE double
+PT__highLatPortion(const PT_HighLatMethod_t method,
+                   const double angle,
+                   const double night)
 {
-  double portion;
   switch (method) {
     default:
     case PT_HL_NONE:
-      portion = (1 / 2.0f) * night;
-      break;
+      return (1 / 2.0f) * night;
     case PT_HL_ANGLE_BASED:
-      portion = (1 / 60.0f) * angle * night;
-      break;
+      return (1 / 60.0f) * angle * night;
     case PT_HL_ONE_SEVENTH:
-      portion = (1 / 7.0f) * night;
-      break;
+      return (1 / 7.0f) * night;
   }
+}
 
+/**
+ * Adjust time for higher lattitude
+ *
+ * @param[in]  method
+ * @param[in]  time
+ * @param[in]  base
+ * @param[in]  angle
+ * @param[in]  night
+ * @param[in]  direction
+ * @return
+ **/
+static inline PT_SPECIALISE double
+PT__adjustHLTime(const PT_HighLatMethod_t method,
+                 const double time,
+                 const double base,
+                 const double angle,
+                 const double night,
+                 const PTM_SunDirection_t direction)
+{
+  double portion = PT__highLatPortion(method, angle, night);
   double timeDiff = direction == PTM_SD_CCW ? PTM__fixHour(base - time)
                                             : PTM__fixHour(time - base);
   double _time = time;
-  if (isnan(time) || timeDiff > portion)
+  if (isnan(time) || timeDiff > portion) {
     _time = base + (direction == PTM_SD_CCW ? -portion : portion);
+    PT_STATS_COUNT(highLatFallbacks, 1);
+  }
   return _time;
 }
 
@@ -222,114 +1131,391 @@ PT__adjustHLTime(const PT_HighLatMethod_t method,
  * Adjust for higher latitude
  *
  * @param[in]  pt
+ * @param[in]  highlats
+ * @param[in]  mask      Times to adjust
  * @param[out]  times
  **/
-static inline void
-PT__adjustHighLats(const PrivatePT pt, PT_PrayerTimes_t times)
+static inline PT_SPECIALISE void
+PT__adjustHighLats(const PrivatePT pt,
+                   const PT_HighLatMethod_t highlats,
+                   const unsigned mask,
+                   PT_PrayerTimes_t times)
 {
   double nightTime = PTM__fixHour(times[PT_TN_SUNRISE] - times[PT_TN_SUNSET]);
-  times[PT_TN_IMSAK] = PT__adjustHLTime(pt->settings.highlats,
-                                        times[PT_TN_IMSAK],
-                                        times[PT_TN_SUNRISE],
-                                        pt->settings.imsak,
-                                        nightTime,
-                                        PTM_SD_CCW);
-  times[PT_TN_FAJR] = PT__adjustHLTime(pt->settings.highlats,
-                                       times[PT_TN_FAJR],
-                                       times[PT_TN_SUNRISE],
-                                       pt->settings.fajr,
-                                       nightTime,
-                                       PTM_SD_CCW);
-  times[PT_TN_ISHA] = PT__adjustHLTime(pt->settings.highlats,
-                                       times[PT_TN_ISHA],
-                                       times[PT_TN_SUNSET],
-                                       pt->settings.isha,
-                                       nightTime,
-                                       PTM_SD_CW);
-  times[PT_TN_MAGHRIB] = PT__adjustHLTime(pt->settings.highlats,
-                                          times[PT_TN_MAGHRIB],
-                                          times[PT_TN_SUNSET],
-                                          pt->settings.maghrib,
+  if (mask & PT_TN_MASK(PT_TN_IMSAK))
+    times[PT_TN_IMSAK] = PT__adjustHLTime(highlats,
+                                          times[PT_TN_IMSAK],
+                                          times[PT_TN_SUNRISE],
+                                          pt->settings.imsak,
                                           nightTime,
-                                          PTM_SD_CW);
+                                          PTM_SD_CCW);
+  if (mask & PT_TN_MASK(PT_TN_FAJR))
+    times[PT_TN_FAJR] = PT__adjustHLTime(highlats,
+                                         times[PT_TN_FAJR],
+                                         times[PT_TN_SUNRISE],
+                                         pt->settings.fajr,
+                                         nightTime,
+                                         PTM_SD_CCW);
+  if (mask & PT_TN_MASK(PT_TN_ISHA))
+    times[PT_TN_ISHA] = PT__adjustHLTime(highlats,
+                                         times[PT_TN_ISHA],
+                                         times[PT_TN_SUNSET],
+                                         pt->settings.isha,
+                                         nightTime,
+                                         PTM_SD_CW);
+  if (mask & PT_TN_MASK(PT_TN_MAGHRIB))
+    times[PT_TN_MAGHRIB] = PT__adjustHLTime(highlats,
+                                            times[PT_TN_MAGHRIB],
+                                            times[PT_TN_SUNSET],
+                                            pt->settings.maghrib,
+                                            nightTime,
+                                            PTM_SD_CW);
+}
+
+/**
+ * Compute sun position, from the ephemeris table when it covers the date
+ *
+ * @param[in]  pt
+ * @param[in]  jd
+ * @return
+ **/
+static inline PTM_SunPosition_t
+PT__sunPosition(const PrivatePT pt, const double jd)
+{
+  PTM_SunPosition_t position;
+  if (pt->table != NULL && PTE__sunPosition(pt->table, jd, &position))
+    return position;
+  switch (pt->precision) {
+    default:
+    case PT_P_EXACT:
+      return PTM__sunPosition(jd);
+    case PT_P_FAST:
+      return PTV__sunPositionFast(jd);
+    case PT_P_FLOAT:
+      return PTM__sunPositionF(jd);
+  }
+}
+
+/**
+ * Compute sun positions of a date
+ *
+ * Times sharing the same default time share one sun position evaluation,
+ * except in PT_P_FAST precision where they are all evaluated by one vector
+ * call.
+ *
+ * @param[in]   pt
+ * @param[in]   jDate
+ * @param[in]   mask       Times to compute the sun positions of, the others
+ *                         being NaN (but in PT_P_FAST precision)
+ * @param[out]  ephemeris
+ **/
+static inline void
+PT__computeEphemerisMask(const PrivatePT pt,
+                         const double jDate,
+                         const unsigned mask,
+                         PT_Ephemeris_t* ephemeris)
+{
+  if (pt->precision == PT_P_FAST && pt->table == NULL) {
+    double jd[PT_TN_MIDNIGHT], equation[PT_TN_MIDNIGHT];
+    for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+      jd[i] = jDate + defaultTimes[i];
+    PTV__sunPosition(ephemeris->decl, equation, jd, PT_TN_MIDNIGHT);
+    for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+      ephemeris->noon[i] = PTM__midDayAt(equation[i]);
+    return;
+  }
+
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+    if (!(mask & PT_TN_MASK(i))) {
+      ephemeris->decl[i] = NAN;
+      ephemeris->noon[i] = NAN;
+      continue;
+    }
+    if (i > PT_TN_IMSAK && defaultTimes[i] == defaultTimes[i - 1] &&
+        (mask & PT_TN_MASK(i - 1))) {
+      ephemeris->decl[i] = ephemeris->decl[i - 1];
+      ephemeris->noon[i] = ephemeris->noon[i - 1];
+      continue;
+    }
+    PTM_SunPosition_t position = PT__sunPosition(pt, jDate + defaultTimes[i]);
+    ephemeris->decl[i] = position.declination;
+    ephemeris->noon[i] = PTM__midDayAt(position.equation);
+  }
+}
+
+/**
+ * Compute the sun positions of all the times of a date
+ *
+ * @param[in]   pt
+ * @param[in]   jDate
+ * @param[out]  ephemeris
+ **/
+static inline void
+PT__computeEphemeris(const PrivatePT pt,
+                     const double jDate,
+                     PT_Ephemeris_t* ephemeris)
+{
+  PT__computeEphemerisMask(pt, jDate, PT_TN_MASK_ALL, ephemeris);
+}
+
+/**
+ * Compute a prayer time, without time adjustment
+ *
+ * @param[in]  pt
+ * @param[in]  asr
+ * @param[in]  name
+ * @param[in]  decl
+ * @param[in]  noon
+ * @param[in]  lat
+ * @param[in]  riseSetAngle
+ * @return
+ **/
+static inline PT_SPECIALISE double
+PT__computeTime(const PrivatePT pt,
+                const PT_AsrJuristic_t asr,
+                const PT_TimeName_t name,
+                const double decl,
+                const double noon,
+                const double lat,
+                const double riseSetAngle)
+{
+  switch (name) {
+    case PT_TN_IMSAK:
+      return PT__sunAngleTimeAt(
+        pt, decl, noon, pt->settings.imsak, PTM_SD_CCW, lat);
+    case PT_TN_FAJR:
+      return PT__sunAngleTimeAt(
+        pt, decl, noon, pt->settings.fajr, PTM_SD_CCW, lat);
+    case PT_TN_SUNRISE:
+      return PT__sunAngleTimeAt(
+        pt, decl, noon, riseSetAngle, PTM_SD_CCW, lat);
+    case PT_TN_DHUHR:
+      return noon;
+    case PT_TN_ASR:
+      return PT__asrTime(pt, asr, decl, noon, lat);
+    case PT_TN_SUNSET:
+      return PT__sunAngleTimeAt(
+        pt, decl, noon, riseSetAngle, PTM_SD_CW, lat);
+    case PT_TN_MAGHRIB:
+      return PT__sunAngleTimeAt(
+        pt, decl, noon, pt->settings.maghrib, PTM_SD_CW, lat);
+    case PT_TN_ISHA:
+      return PT__sunAngleTimeAt(
+        pt, decl, noon, pt->settings.isha, PTM_SD_CW, lat);
+    default:
+      return NAN;
+  }
+}
+
+/**
+ * Compute prayer times with one vector call for all the sun angle times
+ *
+ * @param[in]   pt
+ * @param[in]   asr
+ * @param[out]  results
+ * @param[in]   lat
+ * @param[in]   ephemeris
+ * @param[in]   riseSetAngle
+ * @param[in]   timeAdjust
+ **/
+static inline PT_SPECIALISE void
+PT__computeTimesFast(const PrivatePT pt,
+                     const PT_AsrJuristic_t asr,
+                     PT_PrayerTimes_t results,
+                     const double lat,
+                     const PT_Ephemeris_t* ephemeris,
+                     const double riseSetAngle,
+                     const double timeAdjust)
+{
+  double angle[PT_TN_MIDNIGHT], lats[PT_TN_MIDNIGHT], t[PT_TN_MIDNIGHT];
+  angle[PT_TN_IMSAK] = pt->settings.imsak;
+  angle[PT_TN_FAJR] = pt->settings.fajr;
+  angle[PT_TN_SUNRISE] = riseSetAngle;
+  angle[PT_TN_DHUHR] = 0;
+  angle[PT_TN_ASR] = PT__asrAngle(pt, asr, ephemeris->decl[PT_TN_ASR], lat);
+  angle[PT_TN_SUNSET] = riseSetAngle;
+  angle[PT_TN_MAGHRIB] = pt->settings.maghrib;
+  angle[PT_TN_ISHA] = pt->settings.isha;
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+    lats[i] = lat;
+
+  /* the times before dhuhr are before mid-day, the others after */
+  PTV__sunHourAngle(t, ephemeris->decl, angle, lats, PT_TN_MIDNIGHT);
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+    results[i] = ephemeris->noon[i] +
+                 (i < PT_TN_DHUHR ? -t[i] : i > PT_TN_DHUHR ? t[i] : 0) +
+                 timeAdjust;
 }
 
 /**
  * Compute prayer times
  *
  * @param[in]  pt
+ * @param[in]   asr
+ * @param[in]   mask          Times to compute, the others being NaN (but in
+ *                            PT_P_FAST precision)
  * @param[out]  results
  * @param[in]   lat
- * @param[in]   jDate
+ * @param[in]   ephemeris
  * @param[in]   riseSetAngle
  * @param[in]   timeAdjust
  **/
-static inline void
+static inline PT_SPECIALISE void
 PT__computeTimes(const PrivatePT pt,
+                 const PT_AsrJuristic_t asr,
+                 const unsigned mask,
                  PT_PrayerTimes_t results,
                  const double lat,
-                 const double jDate,
+                 const PT_Ephemeris_t* ephemeris,
                  const double riseSetAngle,
                  const double timeAdjust)
 {
-  PT_Times_t defaultTimes = { 5 / 24.0f,    /* Imsak */
-                              5 / 24.0f,    /* Fajr */
-                              6 / 24.0f,    /* Sunrise */
-                              12 / 24.0f,   /* Dhuhr */
-                              13 / 24.0f,   /* Asr */
-                              18 / 24.0f,   /* Sunset */
-                              18 / 24.0f,   /* Maghrib */
-                              18 / 24.0f }; /* Isha */
-
-  results[PT_TN_IMSAK] =
-    PTM__sunAngleTime(
-      jDate, pt->settings.imsak, defaultTimes[PT_TN_IMSAK], PTM_SD_CCW, lat) +
-    timeAdjust;
-  results[PT_TN_FAJR] =
-    PTM__sunAngleTime(
-      jDate, pt->settings.fajr, defaultTimes[PT_TN_FAJR], PTM_SD_CCW, lat) +
-    timeAdjust;
-  results[PT_TN_SUNRISE] =
-    PTM__sunAngleTime(
-      jDate, riseSetAngle, defaultTimes[PT_TN_SUNRISE], PTM_SD_CCW, lat) +
-    timeAdjust;
-  results[PT_TN_DHUHR] =
-    PTM__midDay(jDate, defaultTimes[PT_TN_DHUHR]) + timeAdjust;
-  results[PT_TN_ASR] =
-    PT__asrTime(jDate, pt->settings.asr, defaultTimes[PT_TN_ASR], lat) +
-    timeAdjust;
-  results[PT_TN_SUNSET] =
-    PTM__sunAngleTime(
-      jDate, riseSetAngle, defaultTimes[PT_TN_SUNSET], PTM_SD_CW, lat) +
-    timeAdjust;
-  results[PT_TN_MAGHRIB] = PTM__sunAngleTime(jDate,
-                                             pt->settings.maghrib,
-                                             defaultTimes[PT_TN_MAGHRIB],
-                                             PTM_SD_CW,
-                                             lat) +
-                           timeAdjust;
-  results[PT_TN_ISHA] =
-    PTM__sunAngleTime(
-      jDate, pt->settings.isha, defaultTimes[PT_TN_ISHA], PTM_SD_CW, lat) +
-    timeAdjust;
+  PT_STATS_BEGIN(start);
+  if (pt->precision == PT_P_FAST)
+    PT__computeTimesFast(
+      pt, asr, results, lat, ephemeris, riseSetAngle, timeAdjust);
+  else
+    for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+      if (!(mask & PT_TN_MASK(i))) {
+        results[i] = NAN;
+        continue;
+      }
+      results[i] = PT__computeTime(pt,
+                                   asr,
+                                   i,
+                                   ephemeris->decl[i],
+                                   ephemeris->noon[i],
+                                   lat,
+                                   riseSetAngle) +
+                   timeAdjust;
+    }
+  PT_STATS_END(PT_ST_COMPUTE, start);
+  PT_STATS_COUNT(nanHourAngles, PT__countNaN(results, mask));
 }
 
 /**
- * Adjust prayer times
+ * Compute prayer times iteratively, each iteration using the previous result
+ * as the time of the sun position, until it moves less than the threshold
+ *
+ * The first iteration uses the sun positions at the default times, or at the
+ * seeds when given (e.g. the times of the previous day).
  *
  * @param[in]   pt
+ * @param[in]   mask          Times to compute, the others being NaN
  * @param[out]  results
+ * @param[out]  iterations
+ * @param[in,out] seeds       First guesses, NaN for none, updated with the
+ *                            converged times (without time adjustment), may
+ *                            be NULL
+ * @param[in]   lat
+ * @param[in]   jDate
+ * @param[in]   ephemeris     Sun positions of the first iteration
+ * @param[in]   riseSetAngle
+ * @param[in]   timeAdjust
  **/
 static inline void
-PT__adjustTimes(const PrivatePT pt, PT_PrayerTimes_t results)
+PT__refineTimes(const PrivatePT pt,
+                const unsigned mask,
+                PT_PrayerTimes_t results,
+                PT_Iterations_t iterations,
+                PT_PrayerTimes_t seeds,
+                const double lat,
+                const double jDate,
+                const PT_Ephemeris_t* ephemeris,
+                const double riseSetAngle,
+                const double timeAdjust)
+{
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+    if (!(mask & PT_TN_MASK(i))) {
+      results[i] = NAN;
+      if (iterations)
+        iterations[i] = 0;
+      continue;
+    }
+    double guess = defaultTimes[i] * 24.0f;
+    double time;
+    if (seeds && !isnan(seeds[i])) {
+      guess = seeds[i];
+      PTM_SunPosition_t position = PT__sunPosition(pt, jDate + guess / 24.0f);
+      time = PT__computeTime(pt,
+                             pt->settings.asr,
+                             i,
+                             position.declination,
+                             PTM__midDayAt(position.equation),
+                             lat,
+                             riseSetAngle);
+    } else
+      time = PT__computeTime(pt,
+                             pt->settings.asr,
+                             i,
+                             ephemeris->decl[i],
+                             ephemeris->noon[i],
+                             lat,
+                             riseSetAngle);
+    int k = 1;
+    for (; k < pt->iterations && !isnan(time) &&
+           fabs(time - guess) * 60.0f >= pt->threshold;
+         k++) {
+      guess = time;
+      PTM_SunPosition_t position = PT__sunPosition(pt, jDate + guess / 24.0f);
+      time = PT__computeTime(pt,
+                             pt->settings.asr,
+                             i,
+                             position.declination,
+                             PTM__midDayAt(position.equation),
+                             lat,
+                             riseSetAngle);
+    }
+    results[i] = time + timeAdjust;
+    if (iterations)
+      iterations[i] = k;
+    if (seeds)
+      seeds[i] = time;
+  }
+}
+
+/**
+ * Times computed from a sun angle, the others deriving from them
+ *
+ * @param[in]  method
+ * @param[in]  mask    Times, with the ones they depend on
+ * @return             Times of the mask computed from a sun angle
+ **/
+static inline PT_SPECIALISE unsigned
+PT__angleTimes(const PT_Method_t method, const unsigned mask)
+{
+  unsigned derived = PT_TN_MASK(PT_TN_IMSAK) | PT_TN_MASK(PT_TN_MIDNIGHT);
+  if (method != PT_M_TEHRAN && method != PT_M_JAFARI)
+    derived |= PT_TN_MASK(PT_TN_MAGHRIB);
+  if (method == PT_M_MAKKAH)
+    derived |= PT_TN_MASK(PT_TN_ISHA);
+  return mask & ~derived;
+}
+
+/**
+ * Adjust prayer times
+ *
+ * @param[in]   pt
+ * @param[in]   method
+ * @param[in]   mask     Times to adjust
+ * @param[out]  results
+ **/
+static inline PT_SPECIALISE void
+PT__adjustTimes(const PrivatePT pt,
+                const PT_Method_t method,
+                const unsigned mask,
+                PT_PrayerTimes_t results)
 {
-  results[PT_TN_IMSAK] = results[PT_TN_FAJR] - (pt->settings.imsak / 60.0f);
-  if (pt->method != PT_M_TEHRAN && pt->method != PT_M_JAFARI)
+  if (mask & PT_TN_MASK(PT_TN_IMSAK))
+    results[PT_TN_IMSAK] = results[PT_TN_FAJR] - (pt->settings.imsak / 60.0f);
+  if (method != PT_M_TEHRAN && method != PT_M_JAFARI &&
+      (mask & PT_TN_MASK(PT_TN_MAGHRIB)))
     results[PT_TN_MAGHRIB] =
       results[PT_TN_SUNSET] + (pt->settings.maghrib / 60.0f);
-  if (pt->method == PT_M_MAKKAH)
+  if (method == PT_M_MAKKAH && (mask & PT_TN_MASK(PT_TN_ISHA)))
     results[PT_TN_ISHA] = results[PT_TN_MAGHRIB] + (pt->settings.isha / 60.0f);
-  results[PT_TN_DHUHR] += (pt->settings.dhuhr / 60.0f);
+  if (mask & PT_TN_MASK(PT_TN_DHUHR))
+    results[PT_TN_DHUHR] += (pt->settings.dhuhr / 60.0f);
 }
 
 /**
@@ -338,79 +1524,1879 @@ PT__adjustTimes(const PrivatePT pt, PT_PrayerTimes_t results)
  * @param[in]   pt
  * @param[out]  results
  **/
-static inline void
+static inline PT_SPECIALISE void
 PT__computeMidnight(const PrivatePT pt, PT_PrayerTimes_t results)
 {
+  /* a selected index rather than two branches */
+  const double base = results[pt->settings.midnight == PT_MM_JAFARI
+                                ? PT_TN_FAJR
+                                : PT_TN_SUNRISE];
   results[PT_TN_MIDNIGHT] =
-    pt->settings.midnight == PT_MM_JAFARI
-      ? results[PT_TN_SUNSET] +
-          (PTM__fixHour(results[PT_TN_FAJR] - results[PT_TN_SUNSET]) / 2.0f)
-      : results[PT_TN_SUNSET] +
-          (PTM__fixHour(results[PT_TN_SUNRISE] - results[PT_TN_SUNSET]) / 2.0f);
+    results[PT_TN_SUNSET] +
+    (PTM__fixHour(base - results[PT_TN_SUNSET]) / 2.0f);
 }
 
 /**
  * Tune prayer times
  *
  * @param[in]   pt
+ * @param[in]   mask     Times to tune
  * @param[out]  results
  **/
-static inline void
-PT__tuneTimes(const PrivatePT pt, PT_PrayerTimes_t results)
+static inline PT_SPECIALISE void
+PT__tuneTimes(const PrivatePT pt, const unsigned mask, PT_PrayerTimes_t results)
 {
-  results[PT_TN_IMSAK] += (pt->offsets[PT_TN_IMSAK] / 60.0f);
-  results[PT_TN_FAJR] += (pt->offsets[PT_TN_FAJR] / 60.0f);
-  results[PT_TN_SUNRISE] += (pt->offsets[PT_TN_SUNRISE] / 60.0f);
-  results[PT_TN_DHUHR] += (pt->offsets[PT_TN_DHUHR] / 60.0f);
-  results[PT_TN_ASR] += (pt->offsets[PT_TN_ASR] / 60.0f);
-  results[PT_TN_SUNSET] += (pt->offsets[PT_TN_SUNSET] / 60.0f);
-  results[PT_TN_MAGHRIB] += (pt->offsets[PT_TN_MAGHRIB] / 60.0f);
-  results[PT_TN_ISHA] += (pt->offsets[PT_TN_ISHA] / 60.0f);
-  results[PT_TN_MIDNIGHT] += (pt->offsets[PT_TN_MIDNIGHT] / 60.0f);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    if (mask & PT_TN_MASK(i))
+      results[i] += (pt->offsets[i] / 60.0f);
 }
 
-void
-PT__getTimes(const PT pt,
-             PT_PrayerTimes_t results,
-             const int year,
-             const int month,
-             const int day,
-             const double lat,
-             const double lng,
-             const double elv,
-             const int timezone,
-             const int dst)
+/**
+ * Finish prayer times: high latitudes, method adjustments, midnight & tuning
+ *
+ * The times computed from a sun angle then overridden by the method
+ * adjustments are not adjusted for higher latitudes.
+ *
+ * @param[in]   pt
+ * @param[in]   method
+ * @param[in]   highlats
+ * @param[in]   mask      Times to finish, with the ones they depend on
+ * @param[out]  results
+ **/
+static inline PT_SPECIALISE void
+PT__finishTimes(const PrivatePT pt,
+                const PT_Method_t method,
+                const PT_HighLatMethod_t highlats,
+                const unsigned mask,
+                PT_PrayerTimes_t results)
+{
+  const unsigned angleTimes = PT__angleTimes(method, mask);
+  const unsigned nightTimes = PT_TN_MASK(PT_TN_FAJR) |
+                              PT_TN_MASK(PT_TN_MAGHRIB) |
+                              PT_TN_MASK(PT_TN_ISHA);
+  if (highlats != PT_HL_NONE && (angleTimes & nightTimes))
+    PT_STATS_STAGE(PT_ST_HIGHLATS,
+                   PT__adjustHighLats(pt, highlats, angleTimes, results));
+
+  PT_STATS_STAGE(PT_ST_ADJUST, PT__adjustTimes(pt, method, mask, results));
+
+  if (mask & PT_TN_MASK(PT_TN_MIDNIGHT))
+    PT_STATS_STAGE(PT_ST_MIDNIGHT, PT__computeMidnight(pt, results));
+
+  PT_STATS_STAGE(PT_ST_TUNE, PT__tuneTimes(pt, mask, results));
+}
+
+/*
+ * Specialised pipelines: one per method, higher latitudes method & asr
+ * juristic, with the helpers above inlined so that their branches on these
+ * constants fold away. The generic pipeline reads them from the instance, for
+ * values out of the enumerations.
+ */
+
+static void
+PT__computeGeneric(const PrivatePT pt,
+                   PT_PrayerTimes_t results,
+                   const double lat,
+                   const PT_Ephemeris_t* ephemeris,
+                   const double riseSetAngle,
+                   const double timeAdjust)
+{
+  PT__computeTimes(pt,
+                   pt->settings.asr,
+                   PT_TN_MASK_ALL,
+                   results,
+                   lat,
+                   ephemeris,
+                   riseSetAngle,
+                   timeAdjust);
+  PT__finishTimes(
+    pt, pt->method, pt->settings.highlats, PT_TN_MASK_ALL, results);
+}
+
+static void
+PT__finishGeneric(const PrivatePT pt, PT_PrayerTimes_t results)
+{
+  PT__finishTimes(
+    pt, pt->method, pt->settings.highlats, PT_TN_MASK_ALL, results);
+}
+
+static const PT_Pipeline_t genericPipeline = { PT__computeGeneric,
+                                               PT__finishGeneric };
+
+#define PT_PIPELINE_NAME(name, m, h, a) name##_##m##_##h##_##a
+
+#define PT_PIPELINE_DEFINE(m, h, a)                                          \
+  static void PT_PIPELINE_NAME(PT__compute, m, h, a)(                        \
+    const PrivatePT pt,                                                      \
+    PT_PrayerTimes_t results,                                                \
+    const double lat,                                                        \
+    const PT_Ephemeris_t* ephemeris,                                         \
+    const double riseSetAngle,                                               \
+    const double timeAdjust)                                                 \
+  {                                                                          \
+    PT__computeTimes(pt,                                                     \
+                     a,                                                      \
+                     PT_TN_MASK_ALL,                                         \
+                     results,                                                \
+                     lat,                                                    \
+                     ephemeris,                                              \
+                     riseSetAngle,                                           \
+                     timeAdjust);                                            \
+    PT__finishTimes(pt, m, h, PT_TN_MASK_ALL, results);                      \
+  }                                                                          \
+  static void PT_PIPELINE_NAME(PT__finish, m, h, a)(const PrivatePT pt,      \
+                                                    PT_PrayerTimes_t results) \
+  {                                                                          \
+    PT__finishTimes(pt, m, h, PT_TN_MASK_ALL, results);                      \
+  }
+
+#define PT_PIPELINE_ENTRY(m, h, a)                                           \
+  [m][h][a] = { PT_PIPELINE_NAME(PT__compute, m, h, a),                      \
+                PT_PIPELINE_NAME(PT__finish, m, h, a) },
+
+#define PT_PIPELINES_ASR(F, m, h) F(m, h, PT_AJ_STANDARD) F(m, h, PT_AJ_HANAFI)
+
+#define PT_PIPELINES_HL(F, m)                                                \
+  PT_PIPELINES_ASR(F, m, PT_HL_NONE)                                         \
+  PT_PIPELINES_ASR(F, m, PT_HL_NIGHT_MIDDLE)                                 \
+  PT_PIPELINES_ASR(F, m, PT_HL_ANGLE_BASED)                                  \
+  PT_PIPELINES_ASR(F, m, PT_HL_ONE_SEVENTH)
+
+#define PT_PIPELINES(F)                                                      \
+  PT_PIPELINES_HL(F, PT_M_MWL)                                               \
+  PT_PIPELINES_HL(F, PT_M_ISNA)                                              \
+  PT_PIPELINES_HL(F, PT_M_EGYPT)                                             \
+  PT_PIPELINES_HL(F, PT_M_MAKKAH)                                            \
+  PT_PIPELINES_HL(F, PT_M_KARACHI)                                           \
+  PT_PIPELINES_HL(F, PT_M_TEHRAN)                                            \
+  PT_PIPELINES_HL(F, PT_M_JAFARI)                                            \
+  PT_PIPELINES_HL(F, PT_M_INDONESIA)
+
+PT_PIPELINES(PT_PIPELINE_DEFINE)
+
+static const PT_Pipeline_t pipelines[PT_M_INDONESIA + 1][PT_HL_ONE_SEVENTH + 1]
+                                    [PT_AJ_HANAFI + 1] = {
+                                      PT_PIPELINES(PT_PIPELINE_ENTRY)
+                                    };
+
+/**
+ * Select the pipeline of the configuration
+ *
+ * @param[out]  pt
+ **/
+static void
+PT__selectPipeline(PrivatePT pt)
+{
+  const unsigned method = pt->method;
+  const unsigned highlats = pt->settings.highlats;
+  const unsigned asr = pt->settings.asr;
+  pt->pipeline = method <= PT_M_INDONESIA && highlats <= PT_HL_ONE_SEVENTH &&
+                     asr <= PT_AJ_HANAFI
+                   ? &pipelines[method][highlats][asr]
+                   : &genericPipeline;
+}
+
+/**
+ * Compute prayer times of a location from the sun positions of its date
+ *
+ * @param[in]   pt
+ * @param[out]  results
+ * @param[out]  iterations
+ * @param[in,out] seeds     Refinement seeds (see PT__refineTimes), may be NULL
+ * @param[in]   jDate
+ * @param[in]   ephemeris
+ * @param[in]   lat
+ * @param[in]   lng
+ * @param[in]   elv
+ * @param[in]   timezone
+ * @param[in]   dst
+ **/
+static inline void
+PT__computeLocation(const PrivatePT pt,
+                    PT_PrayerTimes_t results,
+                    PT_Iterations_t iterations,
+                    PT_PrayerTimes_t seeds,
+                    const double jDate,
+                    const PT_Ephemeris_t* ephemeris,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst)
 {
-  PrivatePT _pt = (PrivatePT)pt;
-  int jDate = PTM__julianDay(year, month, day);
   double riseSetAngle = 0.833f + (0.0347f * sqrt(elv));
   double timeAdjust = (double)(timezone + dst) - (lng / 15.0f);
 
-  PT__computeTimes(_pt, results, lat, jDate, riseSetAngle, timeAdjust);
+  if (pt->iterations > 1) {
+    PT_STATS_STAGE(PT_ST_COMPUTE,
+                   PT__refineTimes(pt,
+                                   PT_TN_MASK_ALL,
+                                   results,
+                                   iterations,
+                                   seeds,
+                                   lat,
+                                   jDate,
+                                   ephemeris,
+                                   riseSetAngle,
+                                   timeAdjust));
+    PT_STATS_COUNT(nanHourAngles, PT__countNaN(results, PT_TN_MASK_ALL));
+    pt->pipeline->finish(pt, results);
+  } else {
+    pt->pipeline->compute(
+      pt, results, lat, ephemeris, riseSetAngle, timeAdjust);
+    for (int i = PT_TN_IMSAK; iterations && i < PT_TN_MIDNIGHT; i++)
+      iterations[i] = 1;
+  }
+  if (iterations)
+    iterations[PT_TN_MIDNIGHT] = 0;
+}
 
-  if (_pt->settings.highlats != PT_HL_NONE)
-    PT__adjustHighLats(_pt, results);
+/**
+ * Sine & cosine pair of an angle, advanced by rotations.
+ **/
+typedef struct private_pt_rotation_t
+{
+  double sin;
+  double cos;
+} PT_Rotation_t;
 
-  PT__adjustTimes(_pt, results);
+/**
+ * Sun position state of one default time across consecutive days.
+ **/
+typedef struct private_pt_range_sun_t
+{
+  double g;
+  double q;
+  PT_Rotation_t sinG;
+  PT_Rotation_t sinQ;
+  PT_Rotation_t sinE;
+} PT_RangeSun_t;
 
-  PT__computeMidnight(_pt, results);
+/**
+ * Days between direct evaluations of the recurrences, bounding their drift
+ **/
+#define PT_RANGE_ANCHOR 32
 
-  PT__tuneTimes(_pt, results);
+/**
+ * Get sine & cosine of a degree-based angle
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PT_Rotation_t
+PT__rotation(const double a)
+{
+  PT_Rotation_t r = { PTM__sin(a), PTM__cos(a) };
+  return r;
+}
+
+/**
+ * Rotate a sine & cosine pair
+ *
+ * @param[in]  a
+ * @param[in]  by
+ * @return
+ **/
+static inline PT_Rotation_t
+PT__rotate(const PT_Rotation_t a, const PT_Rotation_t by)
+{
+  PT_Rotation_t r = { a.sin * by.cos + a.cos * by.sin,
+                      a.cos * by.cos - a.sin * by.sin };
+  return r;
+}
+
+/**
+ * Get sine & cosine of a small radians angle (below 0.04) by Taylor series
+ *
+ * @param[in]  x
+ * @return
+ **/
+static inline PT_Rotation_t
+PT__smallRotation(const double x)
+{
+  double x2 = x * x;
+  PT_Rotation_t r = {
+    x * (1 - x2 / 6 * (1 - x2 / 20 * (1 - x2 / 42))),
+    1 - x2 / 2 * (1 - x2 / 12 * (1 - x2 / 30 * (1 - x2 / 56)))
+  };
+  return r;
+}
+
+/**
+ * Rotations of the angles of the sun position from one day to the next.
+ *
+ * The degree-based functions convert with a single precision pi, so turning
+ * a reduced angle back by 360 degrees is not a whole turn: wrapped rotations
+ * include the difference.
+ **/
+typedef struct private_pt_range_steps_t
+{
+  PT_Rotation_t g;
+  PT_Rotation_t gWrap;
+  PT_Rotation_t q;
+  PT_Rotation_t qWrap;
+  PT_Rotation_t e;
+  PT_Rotation_t turn;
+} PT_RangeSteps_t;
+
+/**
+ * Compute the rotations of the sun position angles per day
+ *
+ * @param[out]  steps
+ **/
+static inline void
+PT__rangeSteps(PT_RangeSteps_t* steps)
+{
+  double pi = M_PI, turn = 2 * pi - 2 * acos(-1.0);
+  double g = (0.98560028f * pi) / 180.0f, q = (0.98564736f * pi) / 180.0f;
+  steps->g = (PT_Rotation_t){ sin(g), cos(g) };
+  steps->gWrap = (PT_Rotation_t){ sin(g - turn), cos(g - turn) };
+  steps->q = (PT_Rotation_t){ sin(q), cos(q) };
+  steps->qWrap = (PT_Rotation_t){ sin(q - turn), cos(q - turn) };
+  steps->e = PT__rotation(-0.00000036f);
+  steps->turn = (PT_Rotation_t){ sin(turn), cos(turn) };
+}
+
+/**
+ * Compute the sun position of a default time of a day, advancing the
+ * recurrences from the previous day unless anchoring
+ *
+ * Same as PTM__sunPosition but returning the sine & cosine of the declination
+ * angle, which is all the prayer times need.
+ *
+ * @param[in,out]  sun
+ * @param[in]      steps
+ * @param[in]      jd
+ * @param[in]      anchor  Evaluate the angles directly
+ * @param[out]     decl    Sine & cosine of the declination angle
+ * @return                 Equation of time
+ **/
+static inline double
+PT__rangeSunPosition(PT_RangeSun_t* sun,
+                     const PT_RangeSteps_t* steps,
+                     const double jd,
+                     const int anchor,
+                     PT_Rotation_t* decl)
+{
+  double D = jd - 2451545.0f;
+  double g = PTM__fixAngle(357.529f + 0.98560028f * D);
+  double q = PTM__fixAngle(280.459f + 0.98564736f * D);
+  if (anchor) {
+    sun->sinG = PT__rotation(g);
+    sun->sinQ = PT__rotation(q);
+    sun->sinE = PT__rotation(23.439f - 0.00000036f * D);
+  } else {
+    sun->sinG = PT__rotate(sun->sinG, g < sun->g ? steps->gWrap : steps->g);
+    sun->sinQ = PT__rotate(sun->sinQ, q < sun->q ? steps->qWrap : steps->q);
+    sun->sinE = PT__rotate(sun->sinE, steps->e);
+  }
+  sun->g = g;
+  sun->q = q;
+
+  double sin2G = 2 * sun->sinG.sin * sun->sinG.cos;
+  double c = (1.915f * sun->sinG.sin) + (0.020f * sin2G);
+  PT_Rotation_t L =
+    PT__rotate(sun->sinQ, PT__smallRotation((c * M_PI) / 180.0f));
+  if (q + c >= 360.0f)
+    L = PT__rotate(L, (PT_Rotation_t){ -steps->turn.sin, steps->turn.cos });
+  else if (q + c < 0)
+    L = PT__rotate(L, steps->turn);
+
+  double RA = PTM__arctan2(sun->sinE.cos * L.sin, L.cos) / 15.0f;
+  decl->sin = sun->sinE.sin * L.sin;
+  decl->cos = sqrt(1 - decl->sin * decl->sin);
+  return (q / 15.0) - PTM__fixHour(RA);
+}
+
+/**
+ * Compute the time of given angle of sun from the sine & cosine of the
+ * declination angle and latitude
+ *
+ * @param[in]  decl
+ * @param[in]  noon
+ * @param[in]  sinAngle   Sine of the angle
+ * @param[in]  direction
+ * @param[in]  lat
+ * @return
+ **/
+static inline double
+PT__rangeSunAngleTime(const PT_Rotation_t decl,
+                      const double noon,
+                      const double sinAngle,
+                      const PTM_SunDirection_t direction,
+                      const PT_Rotation_t lat)
+{
+  double t = (1 / 15.0f) * PTM__arccos((-sinAngle - (decl.sin * lat.sin)) /
+                                       (decl.cos * lat.cos));
+  return noon + (direction == PTM_SD_CCW ? -t : t);
+}
+
+/**
+ * Compute prayer times of consecutive days by recurrences
+ *
+ * @param[in]   pt
+ * @param[out]  results
+ * @param[in]   jDate     Julian date of the first day
+ * @param[in]   n         Number of days
+ * @param[in]   lat
+ * @param[in]   lng
+ * @param[in]   elv
+ * @param[in]   timezone
+ * @param[in]   dst
+ **/
+static inline void
+PT__computeRange(const PrivatePT pt,
+                 PT_PrayerTimes_t* results,
+                 const double jDate,
+                 const int n,
+                 const double lat,
+                 const double lng,
+                 const double elv,
+                 const int timezone,
+                 const int dst)
+{
+  double riseSetAngle = 0.833f + (0.0347f * sqrt(elv));
+  double timeAdjust = (double)(timezone + dst) - (lng / 15.0f);
+  double asrFactor = pt->settings.asr == PT_AJ_STANDARD ? 1.0f : 2.0f;
+  PT_Rotation_t latitude = PT__rotation(lat);
+  double sinAngle[PT_TN_MIDNIGHT] = { PTM__sin(pt->settings.imsak),
+                                      PTM__sin(pt->settings.fajr),
+                                      PTM__sin(riseSetAngle),
+                                      0,
+                                      0,
+                                      PTM__sin(riseSetAngle),
+                                      PTM__sin(pt->settings.maghrib),
+                                      PTM__sin(pt->settings.isha) };
+  PT_RangeSteps_t steps;
+  PT_RangeSun_t suns[PT_TN_MIDNIGHT];
+  PT__rangeSteps(&steps);
+
+  for (int day = 0; day < n; day++) {
+    PT_STATS_BEGIN(start);
+    PT_Rotation_t decl[PT_TN_MIDNIGHT];
+    double noon[PT_TN_MIDNIGHT];
+    for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+      if (i > PT_TN_IMSAK && defaultTimes[i] == defaultTimes[i - 1]) {
+        decl[i] = decl[i - 1];
+        noon[i] = noon[i - 1];
+        continue;
+      }
+      double jd = jDate + day + defaultTimes[i];
+      int anchor = day % PT_RANGE_ANCHOR == 0;
+      noon[i] = PTM__midDayAt(
+        PT__rangeSunPosition(&suns[i], &steps, jd, anchor, &decl[i]));
+    }
+
+    /* asr: -sin(-arccot(x)), x = factor + tan(|lat - decl|) */
+    PT_Rotation_t asr = decl[PT_TN_ASR];
+    double x = asrFactor +
+               fabs(latitude.sin * asr.cos - latitude.cos * asr.sin) /
+                 (latitude.cos * asr.cos + latitude.sin * asr.sin);
+    sinAngle[PT_TN_ASR] = -(x < 0 ? -1 : 1) / sqrt(x * x + 1);
+
+    /* the times before dhuhr are before mid-day, the others after */
+    double* times = results[day];
+    for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+      PTM_SunDirection_t direction = i < PT_TN_DHUHR ? PTM_SD_CCW : PTM_SD_CW;
+      times[i] = i == PT_TN_DHUHR ? noon[i]
+                                  : PT__rangeSunAngleTime(decl[i],
+                                                          noon[i],
+                                                          sinAngle[i],
+                                                          direction,
+                                                          latitude);
+      times[i] += timeAdjust;
+    }
+    PT_STATS_END(PT_ST_COMPUTE, start);
+    PT_STATS_COUNT(nanHourAngles, PT__countNaN(times, PT_TN_MASK_ALL));
+    pt->pipeline->finish(pt, times);
+  }
+}
+
+/**
+ * Hash of a result cache key
+ *
+ * @param[in]  key
+ * @return
+ **/
+static inline unsigned long long
+PT__cacheHash(const PT_CacheKey_t* key)
+{
+  unsigned long long words[sizeof(PT_CacheKey_t) / 8];
+  unsigned long long hash = 0x9e3779b97f4a7c15ULL;
+  memcpy(words, key, sizeof(words));
+  for (size_t i = 0; i < sizeof(words) / 8; i++)
+    hash = (hash ^ words[i]) * 0xc2b2ae3d27d4eb4fULL;
+  return hash ^ (hash >> 32);
+}
+
+/**
+ * Shard of a result cache key, from the high bits of its hash
+ *
+ * @param[in]  cache
+ * @param[in]  hash
+ * @return
+ **/
+static inline PT_CacheShard_t*
+PT__cacheShard(PT_Cache_t* cache, const unsigned long long hash)
+{
+  return &cache->shard[(hash >> 56) & (cache->shards - 1)];
+}
+
+/**
+ * Find a result cache entry, marking it most recently used; the caller holds
+ * the lock of the shard
+ *
+ * @param[in,out]  shard
+ * @param[in]      key
+ * @param[in]      hash
+ * @return               Entry index, -1 when not found
+ **/
+static inline int
+PT__cacheFind(PT_CacheShard_t* shard,
+              const PT_CacheKey_t* key,
+              const unsigned long long hash)
+{
+  int i = shard->buckets[hash & shard->mask];
+  while (i >= 0 && memcmp(&shard->entries[i].key, key, sizeof(*key)) != 0)
+    i = shard->entries[i].chain;
+  if (i < 0 || i == shard->head)
+    return i;
+
+  PT_CacheEntry_t* entry = &shard->entries[i];
+  shard->entries[entry->prev].next = entry->next;
+  if (entry->next >= 0)
+    shard->entries[entry->next].prev = entry->prev;
+  else
+    shard->tail = entry->prev;
+  entry->prev = -1;
+  entry->next = shard->head;
+  shard->entries[shard->head].prev = i;
+  shard->head = i;
+  return i;
+}
+
+/**
+ * Insert a result cache entry, evicting the least recently used one of the
+ * shard when full; the caller holds the lock of the shard
+ *
+ * @param[in,out]  shard
+ * @param[in]      key
+ * @param[in]      hash
+ * @param[in]      decl    Declination range, NULL for none
+ * @param[in]      times
+ **/
+static inline void
+PT__cacheInsert(PT_CacheShard_t* shard,
+                const PT_CacheKey_t* key,
+                const unsigned long long hash,
+                const double* decl,
+                const PT_PrayerTimes_t times)
+{
+  int i;
+  if (shard->size < shard->capacity)
+    i = shard->size++;
+  else {
+    i = shard->tail;
+    PT_CacheEntry_t* evicted = &shard->entries[i];
+    int* link = &shard->buckets[PT__cacheHash(&evicted->key) & shard->mask];
+    while (*link != i)
+      link = &shard->entries[*link].chain;
+    *link = evicted->chain;
+    shard->tail = evicted->prev;
+    if (shard->tail >= 0)
+      shard->entries[shard->tail].next = -1;
+    else
+      shard->head = -1;
+  }
+
+  PT_CacheEntry_t* entry = &shard->entries[i];
+  entry->key = *key;
+  entry->decl[0] = decl != NULL ? decl[0] : NAN;
+  entry->decl[1] = decl != NULL ? decl[1] : NAN;
+  memcpy(entry->times, times, sizeof(PT_PrayerTimes_t));
+
+  size_t bucket = hash & shard->mask;
+  entry->chain = shard->buckets[bucket];
+  shard->buckets[bucket] = i;
+
+  entry->prev = -1;
+  entry->next = shard->head;
+  if (shard->head >= 0)
+    shard->entries[shard->head].prev = i;
+  else
+    shard->tail = i;
+  shard->head = i;
+}
+
+/**
+ * Minute of day a time is formatted to, like PT__formatTimeTo up to rounding
+ * errors, for times after -1000 days
+ *
+ * @param[in]  time
+ * @return
+ **/
+static inline long
+PT__formattedMinute(const double time)
+{
+  return (long)((time + (1 / 180.0f)) * 60.0 + 1440.0 * 1000) % 1440;
+}
+
+/**
+ * Whether the hour angle of a sun angle may reach its extremum, at the
+ * latitude where sin(lat) = -sin(decl) / sin(angle), within a cell
+ *
+ * @param[in]  lat    Latitude range of the cell
+ * @param[in]  decl   Declination range
+ * @param[in]  angle  Sun angle range
+ * @return
+ **/
+static inline int
+PT__cacheAngleExtremum(const double lat[2],
+                       const double decl[2],
+                       const double angle[2])
+{
+  if (!(angle[0] > 0 && angle[1] <= 90))
+    return 1;
+  double low = INFINITY, high = -INFINITY;
+  for (int k = 0; k < 4; k++) {
+    double sinLat = -PTM__sin(decl[k & 1]) / PTM__sin(angle[k / 2]);
+    low = sinLat < low ? sinLat : low;
+    high = sinLat > high ? sinLat : high;
+  }
+  return low <= PTM__sin(lat[1]) && PTM__sin(lat[0]) <= high;
+}
+
+/**
+ * Whether every time is monotonic across a cell: asr is not around the
+ * latitude of the sun declination, nor the times computed from a sun angle
+ * around the extremum of their hour angle
+ *
+ * @param[in]  pt
+ * @param[in]  lat   Latitude range of the cell
+ * @param[in]  decl  Declination range of the times
+ * @param[in]  elv   Elevation range of the cell
+ * @return
+ **/
+static int
+PT__cacheMonotonic(const PrivatePT pt,
+                   const double lat[2],
+                   const double decl[2],
+                   const double elv[2])
+{
+  if (decl[0] <= lat[1] && lat[0] <= decl[1])
+    return 0;
+
+  const unsigned angleTimes = PT__angleTimes(pt->method, PT_TN_MASK_ALL);
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+    double angle[2];
+    switch (i) {
+      case PT_TN_FAJR:
+        angle[0] = angle[1] = pt->settings.fajr;
+        break;
+      case PT_TN_SUNRISE:
+      case PT_TN_SUNSET:
+        angle[0] = 0.833f + (0.0347f * sqrt(elv[0]));
+        angle[1] = 0.833f + (0.0347f * sqrt(elv[1]));
+        break;
+      case PT_TN_MAGHRIB:
+        angle[0] = angle[1] = pt->settings.maghrib;
+        break;
+      case PT_TN_ISHA:
+        angle[0] = angle[1] = pt->settings.isha;
+        break;
+      default:
+        continue;
+    }
+    if ((angleTimes & PT_TN_MASK(i)) &&
+        PT__cacheAngleExtremum(lat, decl, angle))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Times of the night set from a portion of the night for higher latitudes,
+ * from finished times
+ *
+ * @param[in]  pt
+ * @param[in]  times
+ * @return     Mask of the times at their bound, 0 without adjustment
+ **/
+static unsigned
+PT__cacheClamped(const PrivatePT pt, const PT_PrayerTimes_t times)
+{
+  const PT_HighLatMethod_t highlats = pt->settings.highlats;
+  if (highlats == PT_HL_NONE)
+    return 0;
+
+  double untuned[PT_TN_MIDNIGHT];
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+    untuned[i] = times[i] - (pt->offsets[i] / 60.0f);
+  const double nightTime =
+    PTM__fixHour(untuned[PT_TN_SUNRISE] - untuned[PT_TN_SUNSET]);
+  const unsigned angleTimes = PT__angleTimes(pt->method, PT_TN_MASK_ALL);
+  unsigned clamped = 0;
+  for (int i = PT_TN_FAJR; i < PT_TN_MIDNIGHT; i++) {
+    double angle, timeDiff;
+    if (i == PT_TN_FAJR) {
+      angle = pt->settings.fajr;
+      timeDiff = PTM__fixHour(untuned[PT_TN_SUNRISE] - untuned[i]);
+    } else if (i == PT_TN_MAGHRIB || i == PT_TN_ISHA) {
+      angle = i == PT_TN_ISHA ? pt->settings.isha : pt->settings.maghrib;
+      timeDiff = PTM__fixHour(untuned[i] - untuned[PT_TN_SUNSET]);
+    } else
+      continue;
+    if ((angleTimes & PT_TN_MASK(i)) &&
+        timeDiff > PT__highLatPortion(highlats, angle, nightTime) - 1e-7)
+      clamped |= PT_TN_MASK(i);
+  }
+  return clamped;
+}
+
+/**
+ * Return prayer times for a given date through a result cache of exact keys,
+ * the times of a hit being those computed for the same arguments
+ *
+ * @param[in]   pt
+ * @param[in]   cache
+ * @param[out]  results
+ * @param[in]   jDate
+ * @param[in]   lat
+ * @param[in]   lng
+ * @param[in]   elv
+ * @param[in]   timezone
+ * @param[in]   dst
+ **/
+static void
+PT__getTimesCachedExact(const PrivatePT pt,
+                        PT_Cache_t* cache,
+                        PT_PrayerTimes_t results,
+                        const int jDate,
+                        const double lat,
+                        const double lng,
+                        const double elv,
+                        const int timezone,
+                        const int dst)
+{
+  const PT_CacheKey_t key = { lat, lng, elv, jDate, timezone + dst };
+  const unsigned long long hash = PT__cacheHash(&key);
+  PT_CacheShard_t* shard = PT__cacheShard(cache, hash);
+  int valid, i = -1;
+
+  pthread_mutex_lock(&shard->lock);
+  valid = __atomic_load_n(&cache->generation, __ATOMIC_RELAXED) ==
+          pt->generation;
+  if (valid && (i = PT__cacheFind(shard, &key, hash)) >= 0)
+    memcpy(results, shard->entries[i].times, sizeof(PT_PrayerTimes_t));
+  pthread_mutex_unlock(&shard->lock);
+  if (i >= 0) {
+    __atomic_add_fetch(&shard->hits, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  PT_Ephemeris_t ephemeris;
+  PT__computeEphemeris(pt, jDate, &ephemeris);
+  PT__computeLocation(
+    pt, results, NULL, NULL, jDate, &ephemeris, lat, lng, elv, timezone, dst);
+  if (!valid)
+    return;
+
+  pthread_mutex_lock(&shard->lock);
+  if (__atomic_load_n(&cache->generation, __ATOMIC_RELAXED) ==
+        pt->generation &&
+      PT__cacheFind(shard, &key, hash) < 0)
+    PT__cacheInsert(shard, &key, hash, NULL, results);
+  pthread_mutex_unlock(&shard->lock);
+  __atomic_add_fetch(&shard->misses, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Return prayer times for a given date through the result cache, the exact
+ * ones when the cache is not valid for the configuration snapshot
+ *
+ * @param[in]   pt
+ * @param[in]   cache
+ * @param[out]  results
+ * @param[in]   jDate
+ * @param[in]   lat
+ * @param[in]   lng
+ * @param[in]   elv
+ * @param[in]   timezone
+ * @param[in]   dst
+ **/
+static void
+PT__getTimesCached(const PrivatePT pt,
+                   PT_Cache_t* cache,
+                   PT_PrayerTimes_t results,
+                   const int jDate,
+                   const double lat,
+                   const double lng,
+                   const double elv,
+                   const int timezone,
+                   const int dst)
+{
+  if (cache->latQuantum == 0) {
+    PT__getTimesCachedExact(
+      pt, cache, results, jDate, lat, lng, elv, timezone, dst);
+    return;
+  }
+
+  const double q = cache->latQuantum, e = cache->elvQuantum;
+  const long latIndex = (long)floor(lat / q);
+  const double elvs[2] = { e > 0 ? floor(elv / e) * e : elv,
+                           e > 0 ? (floor(elv / e) + 1) * e : elv };
+  const int n = e > 0 ? 4 : 2;
+  PT_CacheKey_t keys[4];
+  unsigned long long hashes[4];
+  PT_PrayerTimes_t corners[4];
+  double decl[2] = { NAN, NAN };
+  int found[4], hit = 1, valid = 1;
+  PT_Ephemeris_t ephemeris;
+  int ephemerisDone = 0;
+
+  /* corner k is at latitude index latIndex + (k & 1), elevation elvs[k / 2],
+   * each looked up in its shard */
+  for (int k = 0; k < n && valid; k++) {
+    const PT_CacheKey_t key = { latIndex + (k & 1), 0, elvs[k / 2], jDate, 0 };
+    keys[k] = key;
+    hashes[k] = PT__cacheHash(&key);
+    PT_CacheShard_t* shard = PT__cacheShard(cache, hashes[k]);
+    pthread_mutex_lock(&shard->lock);
+    valid = __atomic_load_n(&cache->generation, __ATOMIC_RELAXED) ==
+            pt->generation;
+    int i = valid ? PT__cacheFind(shard, &key, hashes[k]) : -1;
+    found[k] = i >= 0;
+    if (found[k]) {
+      memcpy(corners[k], shard->entries[i].times, sizeof(PT_PrayerTimes_t));
+      decl[0] = shard->entries[i].decl[0];
+      decl[1] = shard->entries[i].decl[1];
+    } else
+      hit = 0;
+    pthread_mutex_unlock(&shard->lock);
+  }
+  if (!valid) {
+    /* a snapshot replaced since the read section started */
+    PT__computeEphemeris(pt, jDate, &ephemeris);
+    PT__computeLocation(pt,
+                        results,
+                        NULL,
+                        NULL,
+                        jDate,
+                        &ephemeris,
+                        lat,
+                        lng,
+                        elv,
+                        timezone,
+                        dst);
+    return;
+  }
+
+  if (!hit) {
+    PT__computeEphemeris(pt, jDate, &ephemeris);
+    ephemerisDone = 1;
+    decl[0] = INFINITY;
+    decl[1] = -INFINITY;
+    for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++) {
+      decl[0] = ephemeris.decl[i] < decl[0] ? ephemeris.decl[i] : decl[0];
+      decl[1] = ephemeris.decl[i] > decl[1] ? ephemeris.decl[i] : decl[1];
+    }
+    for (int k = 0; k < n; k++)
+      if (!found[k])
+        PT__computeLocation(pt,
+                            corners[k],
+                            NULL,
+                            NULL,
+                            jDate,
+                            &ephemeris,
+                            (latIndex + (k & 1)) * q,
+                            0,
+                            elvs[k / 2],
+                            0,
+                            0);
+  }
+
+  /* the declinations move with refinement; the times set from a portion of
+   * the night for higher latitudes follow another curve than the others */
+  const double margin = pt->iterations > 1 ? 0.1 : 0.0;
+  const double timeAdjust = (double)(timezone + dst) - (lng / 15.0f);
+  const double lats[2] = { latIndex * q, (latIndex + 1) * q };
+  const double decls[2] = { decl[0] - margin, decl[1] + margin };
+  int uniform = PT__cacheMonotonic(pt, lats, decls, elvs);
+  const unsigned clamped = uniform ? PT__cacheClamped(pt, corners[0]) : 0;
+  for (int k = 1; uniform && k < n; k++)
+    uniform = PT__cacheClamped(pt, corners[k]) == clamped;
+  for (int i = PT_TN_IMSAK; uniform && i <= PT_TN_MIDNIGHT; i++) {
+    double low = INFINITY, high = -INFINITY;
+    int nans = 0;
+    for (int k = 0; k < n; k++) {
+      double time = corners[k][i] + timeAdjust;
+      nans += isnan(time);
+      low = time < low ? time : low;
+      high = time > high ? time : high;
+    }
+    if (nans == n)
+      continue;
+    /* midnight is half way between sunset and sunrise (or fajr): bounded by
+     * the bounds of these across the cell rather than by its corners */
+    if (i == PT_TN_MIDNIGHT) {
+      const int ends[2] = { PT_TN_SUNSET,
+                            pt->settings.midnight == PT_MM_JAFARI
+                              ? PT_TN_FAJR
+                              : PT_TN_SUNRISE };
+      double below = 0, above = 0;
+      for (int t = 0; t < 2; t++) {
+        double lowest = 0, highest = 0;
+        for (int k = 1; k < n; k++) {
+          double delta = corners[k][ends[t]] - corners[0][ends[t]];
+          lowest = delta < lowest ? delta : lowest;
+          highest = delta > highest ? delta : highest;
+        }
+        below += lowest;
+        above += highest;
+      }
+      low = fmin(low, corners[0][i] + timeAdjust + below / 2);
+      high = fmax(high, corners[0][i] + timeAdjust + above / 2);
+    }
+    uniform = nans == 0 && PT__formattedMinute(low - 1e-9) ==
+                             PT__formattedMinute(high + 1e-9);
+  }
+
+  for (int k = 0; k < n; k++) {
+    if (found[k])
+      continue;
+    PT_CacheShard_t* shard = PT__cacheShard(cache, hashes[k]);
+    pthread_mutex_lock(&shard->lock);
+    if (__atomic_load_n(&cache->generation, __ATOMIC_RELAXED) ==
+          pt->generation &&
+        PT__cacheFind(shard, &keys[k], hashes[k]) < 0)
+      PT__cacheInsert(shard, &keys[k], hashes[k], decl, corners[k]);
+    pthread_mutex_unlock(&shard->lock);
+  }
+  __atomic_add_fetch(hit && uniform
+                       ? &PT__cacheShard(cache, hashes[0])->hits
+                       : &PT__cacheShard(cache, hashes[0])->misses,
+                     1,
+                     __ATOMIC_RELAXED);
+
+  if (uniform) {
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      results[i] = corners[0][i] + timeAdjust;
+    return;
+  }
+
+  if (!ephemerisDone)
+    PT__computeEphemeris(pt, jDate, &ephemeris);
+  PT__computeLocation(pt,
+                      results,
+                      NULL,
+                      NULL,
+                      jDate,
+                      &ephemeris,
+                      lat,
+                      lng,
+                      elv,
+                      timezone,
+                      dst);
+}
+
+void
+PT__getTimes(const PT pt,
+             PT_PrayerTimes_t results,
+             const int year,
+             const int month,
+             const int day,
+             const double lat,
+             const double lng,
+             const double elv,
+             const int timezone,
+             const int dst)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  PT_Cache_t* cache =
+    __atomic_load_n(&((PT_Instance_t*)pt)->cache, __ATOMIC_SEQ_CST);
+  int jDate = PTM__julianDay(year, month, day);
+  if (cache)
+    PT__getTimesCached(
+      _pt, cache, results, jDate, lat, lng, elv, timezone, dst);
+  else {
+    PT_Ephemeris_t ephemeris;
+    PT__computeEphemeris(_pt, jDate, &ephemeris);
+    PT__computeLocation(_pt,
+                        results,
+                        NULL,
+                        NULL,
+                        jDate,
+                        &ephemeris,
+                        lat,
+                        lng,
+                        elv,
+                        timezone,
+                        dst);
+  }
+  PT__readEnd();
+}
+
+/**
+ * Add to a mask the times its times depend on
+ *
+ * @param[in]  pt
+ * @param[in]  mask
+ * @return
+ **/
+static unsigned
+PT__maskDependencies(const PrivatePT pt, unsigned mask)
+{
+  if (mask & PT_TN_MASK(PT_TN_MIDNIGHT))
+    mask |= PT_TN_MASK(PT_TN_SUNSET) |
+            PT_TN_MASK(pt->settings.midnight == PT_MM_JAFARI ? PT_TN_FAJR
+                                                             : PT_TN_SUNRISE);
+  if (mask & PT_TN_MASK(PT_TN_IMSAK))
+    mask |= PT_TN_MASK(PT_TN_FAJR);
+  if (pt->method == PT_M_MAKKAH && (mask & PT_TN_MASK(PT_TN_ISHA)))
+    mask |= PT_TN_MASK(PT_TN_MAGHRIB);
+  if (pt->method != PT_M_TEHRAN && pt->method != PT_M_JAFARI &&
+      (mask & PT_TN_MASK(PT_TN_MAGHRIB)))
+    mask |= PT_TN_MASK(PT_TN_SUNSET);
+  /* the night of the higher latitudes adjustment */
+  if (pt->settings.highlats != PT_HL_NONE &&
+      (PT__angleTimes(pt->method, mask) &
+       (PT_TN_MASK(PT_TN_FAJR) | PT_TN_MASK(PT_TN_MAGHRIB) |
+        PT_TN_MASK(PT_TN_ISHA))))
+    mask |= PT_TN_MASK(PT_TN_SUNRISE) | PT_TN_MASK(PT_TN_SUNSET);
+  return mask;
+}
+
+/**
+ * Return the masked prayer times for a given date
+ *
+ * @param[in]   _pt
+ * @param[out]  results
+ * @param[in]   mask
+ * @param[in]   jDate
+ * @param[in]   lat
+ * @param[in]   lng
+ * @param[in]   elv
+ * @param[in]   timezone
+ * @param[in]   dst
+ **/
+static void
+PT__computeMask(const PrivatePT _pt,
+                PT_PrayerTimes_t results,
+                const unsigned mask,
+                const int jDate,
+                const double lat,
+                const double lng,
+                const double elv,
+                const int timezone,
+                const int dst)
+{
+  const unsigned needed = PT__maskDependencies(_pt, mask & PT_TN_MASK_ALL);
+  const unsigned angleTimes = PT__angleTimes(_pt->method, needed);
+  double riseSetAngle = 0.833f + (0.0347f * sqrt(elv));
+  double timeAdjust = (double)(timezone + dst) - (lng / 15.0f);
+  PT_Ephemeris_t ephemeris;
+
+  PT__computeEphemerisMask(_pt, jDate, angleTimes, &ephemeris);
+  if (_pt->iterations > 1) {
+    PT_STATS_STAGE(PT_ST_COMPUTE,
+                   PT__refineTimes(_pt,
+                                   angleTimes,
+                                   results,
+                                   NULL,
+                                   NULL,
+                                   lat,
+                                   jDate,
+                                   &ephemeris,
+                                   riseSetAngle,
+                                   timeAdjust));
+    PT_STATS_COUNT(nanHourAngles, PT__countNaN(results, angleTimes));
+  } else
+    PT__computeTimes(_pt,
+                     _pt->settings.asr,
+                     angleTimes,
+                     results,
+                     lat,
+                     &ephemeris,
+                     riseSetAngle,
+                     timeAdjust);
+  PT__finishTimes(
+    _pt, _pt->method, _pt->settings.highlats, needed, results);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    if (!(needed & PT_TN_MASK(i)))
+      results[i] = NAN;
+}
+
+void
+PT__getTimesMask(const PT pt,
+                 PT_PrayerTimes_t results,
+                 const unsigned mask,
+                 const int year,
+                 const int month,
+                 const int day,
+                 const double lat,
+                 const double lng,
+                 const double elv,
+                 const int timezone,
+                 const int dst)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  PT__computeMask(_pt,
+                  results,
+                  mask,
+                  PTM__julianDay(year, month, day),
+                  lat,
+                  lng,
+                  elv,
+                  timezone,
+                  dst);
+  PT__readEnd();
+}
+
+PT_Location_t
+PT__location(const double lat,
+             const double lng,
+             const double elv,
+             const int timezone,
+             const int dst)
+{
+  PT_Location_t location;
+  location.lat = lat;
+  location.lng = lng;
+  location.elv = elv;
+  location.timezone = timezone;
+  location.dst = dst;
+  location.generation = 0;
+  location.day = 0;
+  return location;
+}
+
+/**
+ * Compute the Unix times of the prayers of a local day
+ *
+ * @param[in]   pt
+ * @param[in]   location
+ * @param[in]   day       Local day since 1970-01-01
+ * @param[out]  times
+ **/
+static void
+PT__locationDay(const PrivatePT pt,
+                const PT_Location_t* location,
+                const long day,
+                double times[PT_TN_MIDNIGHT + 1])
+{
+  /* the Julian day of 1970-01-(1 + day) is the one of the date */
+  PT__computeMask(pt,
+                  times,
+                  PT_TN_MASK_PRAYERS,
+                  PTM__julianDay(1970, 1, (int)(1 + day)),
+                  location->lat,
+                  location->lng,
+                  location->elv,
+                  location->timezone,
+                  location->dst);
+  const double start =
+    day * 86400.0 - (location->timezone + location->dst) * 3600.0;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    times[i] = start + times[i] * 3600.0;
+}
+
+/**
+ * Find the next prayer in the cached days
+ *
+ * @param[in]   location
+ * @param[in]   unixTime
+ * @param[out]  next
+ * @return                 1 when found, 0 otherwise
+ **/
+static int
+PT__nextCached(const PT_Location_t* location,
+               const double unixTime,
+               PT_NextPrayer_t* next)
+{
+  int found = 0;
+  for (int d = 0; d < 2; d++)
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++) {
+      double time = location->times[d][i];
+      if ((PT_TN_MASK_PRAYERS & PT_TN_MASK(i)) && time > unixTime &&
+          (!found || time < next->time)) {
+        next->name = i;
+        next->time = time;
+        found = 1;
+      }
+    }
+  return found;
+}
+
+PT_NextPrayer_t
+PT__nextPrayer(const PT pt, PT_Location_t* location, const double unixTime)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  const double offset = (location->timezone + location->dst) * 3600.0;
+  const long day = (long)floor((unixTime + offset) / 86400.0);
+  const int cached = location->generation == _pt->generation;
+  PT_NextPrayer_t next = { PT_TN_FAJR, NAN };
+
+  if (cached && day >= location->day && day <= location->day + 1 &&
+      PT__nextCached(location, unixTime, &next)) {
+    PT__readEnd();
+    return next;
+  }
+
+  if (cached && day == location->day + 1) {
+    /* past the prayers of the previous day: the next day follows */
+    memcpy(location->times[0], location->times[1], sizeof(location->times[0]));
+    PT__locationDay(_pt, location, day + 1, location->times[1]);
+    location->day = day;
+  } else {
+    PT__locationDay(_pt, location, day, location->times[0]);
+    int early = 1;
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      if (PT_TN_MASK_PRAYERS & PT_TN_MASK(i))
+        early = early && !(location->times[0][i] <= unixTime);
+    if (early) {
+      /* before the prayers of the day, isha of the previous one may be
+       * after midnight */
+      memcpy(
+        location->times[1], location->times[0], sizeof(location->times[0]));
+      PT__locationDay(_pt, location, day - 1, location->times[0]);
+      location->day = day - 1;
+    } else {
+      PT__locationDay(_pt, location, day + 1, location->times[1]);
+      location->day = day;
+    }
+    location->generation = _pt->generation;
+  }
+
+  PT__readEnd();
+  PT__nextCached(location, unixTime, &next);
+  return next;
+}
+
+/**
+ * Whether an event comes before another one in a stream
+ *
+ * @param[in]  a
+ * @param[in]  b
+ * @return
+ **/
+static inline int
+PT__eventBefore(const PT_Event_t* a, const PT_Event_t* b)
+{
+  return a->time < b->time || (a->time == b->time && a->location < b->location);
+}
+
+/**
+ * Move an event of the heap of a stream down to its place
+ *
+ * @param[in,out]  events
+ * @param[in]      i       Index of the event
+ **/
+static void
+PT__siftDown(PT_Events_t* events, size_t i)
+{
+  PT_Event_t event = events->heap[i];
+  for (size_t child; (child = 2 * i + 1) < events->count; i = child) {
+    if (child + 1 < events->count &&
+        PT__eventBefore(&events->heap[child + 1], &events->heap[child]))
+      child++;
+    if (!PT__eventBefore(&events->heap[child], &event))
+      break;
+    events->heap[i] = events->heap[child];
+  }
+  events->heap[i] = event;
+}
+
+/**
+ * Next event of a location in a stream
+ *
+ * @param[in,out]  events
+ * @param[in]      location  Index of the location
+ * @param[in]      time      Unix time, excluded
+ * @param[out]     event
+ * @return                   1 when before the end of the stream, 0 otherwise
+ **/
+static int
+PT__locationEvent(PT_Events_t* events,
+                  const size_t location,
+                  const double time,
+                  PT_Event_t* event)
+{
+  PT_NextPrayer_t next =
+    PT__nextPrayer(events->pt, &events->locations[location], time);
+  event->location = location;
+  event->name = next.name;
+  event->time = next.time;
+  return next.time < events->end; /* NaN compares false */
+}
+
+PT_Events
+PT__events(const PT pt,
+           PT_Location_t* locations,
+           const size_t count,
+           const double start,
+           const double end)
+{
+  PT_Events_t* events =
+    malloc(sizeof(PT_Events_t) + count * sizeof(PT_Event_t));
+  if (events == NULL)
+    return NULL;
+  events->pt = pt;
+  events->locations = locations;
+  events->end = end;
+  events->count = 0;
+  for (size_t i = 0; i < count; i++)
+    events->count +=
+      PT__locationEvent(events, i, start, &events->heap[events->count]);
+  for (size_t i = events->count / 2; i-- > 0;)
+    PT__siftDown(events, i);
+  return (PT_Events)events;
+}
+
+int
+PT__nextEvent(PT_Events events, PT_Event_t* event)
+{
+  PT_Events_t* _events = (PT_Events_t*)events;
+  if (_events->count == 0)
+    return 0;
+  *event = _events->heap[0];
+  if (!PT__locationEvent(
+        _events, event->location, event->time, &_events->heap[0]))
+    _events->heap[0] = _events->heap[--_events->count];
+  if (_events->count > 0)
+    PT__siftDown(_events, 0);
+  return 1;
+}
+
+void
+PT__freeEvents(PT_Events* events)
+{
+  free(*events);
+  *events = NULL;
+}
+
+void
+PT__getTimesRefined(const PT pt,
+                    PT_PrayerTimes_t results,
+                    PT_Iterations_t iterations,
+                    const int year,
+                    const int month,
+                    const int day,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  int jDate = PTM__julianDay(year, month, day);
+  PT_Ephemeris_t ephemeris;
+
+  PT__computeEphemeris(_pt, jDate, &ephemeris);
+  PT__computeLocation(_pt,
+                      results,
+                      iterations,
+                      NULL,
+                      jDate,
+                      &ephemeris,
+                      lat,
+                      lng,
+                      elv,
+                      timezone,
+                      dst);
+  PT__readEnd();
+}
+
+void
+PT__getTimesRange(const PT pt,
+                  PT_PrayerTimes_t* results,
+                  const int year,
+                  const int month,
+                  const int day,
+                  const int n,
+                  const double lat,
+                  const double lng,
+                  const double elv,
+                  const int timezone,
+                  const int dst)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  int jDate = PTM__julianDay(year, month, day);
+
+  if (_pt->iterations == 1 && _pt->table == NULL &&
+      _pt->precision != PT_P_FLOAT) {
+    PT__computeRange(_pt, results, jDate, n, lat, lng, elv, timezone, dst);
+    PT__readEnd();
+    return;
+  }
+
+  PT_Ephemeris_t ephemeris;
+  PT_PrayerTimes_t seeds;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    seeds[i] = NAN;
+  for (int i = 0; i < n; i++) {
+    PT__computeEphemeris(_pt, jDate + i, &ephemeris);
+    PT__computeLocation(_pt,
+                        results[i],
+                        NULL,
+                        seeds,
+                        jDate + i,
+                        &ephemeris,
+                        lat,
+                        lng,
+                        elv,
+                        timezone,
+                        dst);
+  }
+  PT__readEnd();
+}
+
+void
+PT__getTimesBatch(const PT pt,
+                  PT_PrayerTimesBatch_t results,
+                  const int year,
+                  const int month,
+                  const int day,
+                  const double* lat,
+                  const double* lng,
+                  const double* elv,
+                  const int* timezone,
+                  const int* dst,
+                  const size_t n)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  int jDate = PTM__julianDay(year, month, day);
+  PT_Ephemeris_t ephemeris;
+  PT_PrayerTimes_t times;
+
+  PT__computeEphemeris(_pt, jDate, &ephemeris);
+  for (size_t i = 0; i < n; i++) {
+    PT__computeLocation(_pt,
+                        times,
+                        NULL,
+                        NULL,
+                        jDate,
+                        &ephemeris,
+                        lat[i],
+                        lng[i],
+                        elv[i],
+                        timezone[i],
+                        dst[i]);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      results[j][i] = times[j];
+  }
+  PT__readEnd();
+}
+
+void
+PT__getTimesBatchF(const PT pt,
+                   PT_PrayerTimesBatchF_t results,
+                   const int year,
+                   const int month,
+                   const int day,
+                   const float* lat,
+                   const float* lng,
+                   const float* elv,
+                   const int* timezone,
+                   const int* dst,
+                   const size_t n)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  int jDate = PTM__julianDay(year, month, day);
+  PT_Ephemeris_t ephemeris;
+  PT_PrayerTimes_t times;
+
+  PT__computeEphemeris(_pt, jDate, &ephemeris);
+  for (size_t i = 0; i < n; i++) {
+    PT__computeLocation(_pt,
+                        times,
+                        NULL,
+                        NULL,
+                        jDate,
+                        &ephemeris,
+                        lat[i],
+                        lng[i],
+                        elv[i],
+                        timezone[i],
+                        dst[i]);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      results[j][i] = times[j];
+  }
+  PT__readEnd();
+}
+
+/**
+ * Local day since 1970-01-01 of a date
+ *
+ * @param[in]  year
+ * @param[in]  month
+ * @param[in]  day
+ * @return
+ **/
+static inline long
+PT__unixDay(const int year, const int month, const int day)
+{
+  return (long)(PTM__julianDay(year, month, day) - 2440587.5);
+}
+
+/**
+ * Shift times by a UTC offset; the times of a location only depend on its
+ * timezone through the time adjustment
+ *
+ * @param[in,out]  results
+ * @param[in]      offset   UTC offset (in hours)
+ **/
+static inline void
+PT__shiftTimes(PT_PrayerTimes_t results, const double offset)
+{
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    results[i] += offset;
+}
+
+void
+PT__getTimesZone(const PT pt,
+                 PT_PrayerTimes_t results,
+                 const int year,
+                 const int month,
+                 const int day,
+                 const double lat,
+                 const double lng,
+                 const double elv,
+                 const PTZ ptz)
+{
+  PT__getTimes(pt, results, year, month, day, lat, lng, elv, 0, 0);
+  PT__shiftTimes(results,
+                 PTZ__dayOffset(ptz, PT__unixDay(year, month, day)));
+}
+
+void
+PT__getTimesRangeZone(const PT pt,
+                      PT_PrayerTimes_t* results,
+                      const int year,
+                      const int month,
+                      const int day,
+                      const int n,
+                      const double lat,
+                      const double lng,
+                      const double elv,
+                      const PTZ ptz)
+{
+  const long first = PT__unixDay(year, month, day);
+  PT__getTimesRange(pt, results, year, month, day, n, lat, lng, elv, 0, 0);
+  for (int i = 0; i < n; i++)
+    PT__shiftTimes(results[i], PTZ__dayOffset(ptz, first + i));
+}
+
+void
+PT__getTimesBatchZone(const PT pt,
+                      PT_PrayerTimesBatch_t results,
+                      const int year,
+                      const int month,
+                      const int day,
+                      const double* lat,
+                      const double* lng,
+                      const double* elv,
+                      const PTZ* ptz,
+                      const size_t n)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  int jDate = PTM__julianDay(year, month, day);
+  const long unixDay = PT__unixDay(year, month, day);
+  PT_Ephemeris_t ephemeris;
+  PT_PrayerTimes_t times;
+
+  PT__computeEphemeris(_pt, jDate, &ephemeris);
+  for (size_t i = 0; i < n; i++) {
+    PT__computeLocation(
+      _pt, times, NULL, NULL, jDate, &ephemeris, lat[i], lng[i], elv[i], 0, 0);
+    PT__shiftTimes(times, PTZ__dayOffset(ptz[i], unixDay));
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      results[j][i] = times[j];
+  }
+  PT__readEnd();
+}
+
+void
+PT__getTimesGrid(const PT pt,
+                 PT_PrayerTimesBatch_t results,
+                 const int year,
+                 const int month,
+                 const int day,
+                 const double* lat,
+                 const size_t rows,
+                 const double* lng,
+                 const size_t cols,
+                 const double elv,
+                 const int timezone,
+                 const int dst)
+{
+  PrivatePT _pt = PT__readBegin(pt);
+  int jDate = PTM__julianDay(year, month, day);
+  PT_Ephemeris_t ephemeris;
+  PT_PrayerTimes_t times;
+
+  /* every time is a function of the latitude plus the time adjustment */
+  PT__computeEphemeris(_pt, jDate, &ephemeris);
+  for (size_t r = 0; r < rows; r++) {
+    PT__computeLocation(
+      _pt, times, NULL, NULL, jDate, &ephemeris, lat[r], 0, elv, 0, 0);
+    for (size_t c = 0; c < cols; c++) {
+      double timeAdjust = (double)(timezone + dst) - (lng[c] / 15.0f);
+      for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+        results[j][r * cols + c] = times[j] + timeAdjust;
+    }
+  }
+  PT__readEnd();
+}
+
+/**
+ * Compute prayer times of a location under many configurations
+ *
+ * Consecutive configurations of the same precision & ephemeris table share
+ * the sun positions; without refinement & but in PT_P_FAST precision, those
+ * of the same asr juristic also share sunrise, dhuhr, asr & sunset, leaving
+ * the sun angle times of the method (fajr, maghrib & isha) to each one.
+ *
+ * @param[in]   configs
+ * @param[in]   n
+ * @param[out]  results
+ * @param[in]   jDate
+ * @param[in]   lat
+ * @param[in]   lng
+ * @param[in]   elv
+ * @param[in]   timezone
+ * @param[in]   dst
+ **/
+static void
+PT__computeConfigs(const PrivatePT* configs,
+                   const size_t n,
+                   PT_PrayerTimes_t* results,
+                   const int jDate,
+                   const double lat,
+                   const double lng,
+                   const double elv,
+                   const int timezone,
+                   const int dst)
+{
+  const unsigned sharedTimes = PT_TN_MASK(PT_TN_SUNRISE) |
+                               PT_TN_MASK(PT_TN_DHUHR) | PT_TN_MASK(PT_TN_ASR) |
+                               PT_TN_MASK(PT_TN_SUNSET);
+  double riseSetAngle = 0.833f + (0.0347f * sqrt(elv));
+  double timeAdjust = (double)(timezone + dst) - (lng / 15.0f);
+  PT_Ephemeris_t ephemeris;
+  PT_PrayerTimes_t shared;
+  PrivatePT ephemerisOf = NULL, sharedOf = NULL;
+
+  for (size_t c = 0; c < n; c++) {
+    const PrivatePT pt = configs[c];
+    if (ephemerisOf == NULL || pt->precision != ephemerisOf->precision ||
+        pt->table != ephemerisOf->table) {
+      PT__computeEphemeris(pt, jDate, &ephemeris);
+      ephemerisOf = pt;
+      sharedOf = NULL;
+    }
+    if (pt->iterations > 1 || pt->precision == PT_P_FAST) {
+      PT__computeLocation(pt,
+                          results[c],
+                          NULL,
+                          NULL,
+                          jDate,
+                          &ephemeris,
+                          lat,
+                          lng,
+                          elv,
+                          timezone,
+                          dst);
+      continue;
+    }
+
+    if (sharedOf == NULL || pt->settings.asr != sharedOf->settings.asr) {
+      PT__computeTimes(pt,
+                       pt->settings.asr,
+                       sharedTimes,
+                       shared,
+                       lat,
+                       &ephemeris,
+                       riseSetAngle,
+                       timeAdjust);
+      sharedOf = pt;
+    }
+    PT__computeTimes(pt,
+                     pt->settings.asr,
+                     PT__angleTimes(pt->method, PT_TN_MASK_ALL) & ~sharedTimes,
+                     results[c],
+                     lat,
+                     &ephemeris,
+                     riseSetAngle,
+                     timeAdjust);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      if (sharedTimes & PT_TN_MASK(i))
+        results[c][i] = shared[i];
+    pt->pipeline->finish(pt, results[c]);
+  }
+}
+
+void
+PT__getTimesConfigs(const PT_Config* configs,
+                    PT_PrayerTimes_t* results,
+                    const int year,
+                    const int month,
+                    const int day,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst,
+                    const size_t n)
+{
+  PT__computeConfigs((const PrivatePT*)configs,
+                     n,
+                     results,
+                     PTM__julianDay(year, month, day),
+                     lat,
+                     lng,
+                     elv,
+                     timezone,
+                     dst);
+}
+
+void
+PT__getTimesMethods(const PT pt,
+                    PT_PrayerTimes_t* results,
+                    const int year,
+                    const int month,
+                    const int day,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst)
+{
+  struct private_pt_config_t methods[PT_M_INDONESIA + 1];
+  PrivatePT configs[PT_M_INDONESIA + 1];
+  PrivatePT _pt = PT__readBegin(pt);
+  for (int m = PT_M_MWL; m <= PT_M_INDONESIA; m++) {
+    configs[m] = &methods[m];
+    memcpy(configs[m], _pt, offsetof(struct private_pt_config_t, references));
+    PT__applyMethod(configs[m], m);
+    PT__selectPipeline(configs[m]);
+  }
+  PT__readEnd();
+
+  PT__computeConfigs(configs,
+                     PT_M_INDONESIA + 1,
+                     results,
+                     PTM__julianDay(year, month, day),
+                     lat,
+                     lng,
+                     elv,
+                     timezone,
+                     dst);
+}
+
+PT_TimeFormatSpec_t
+PT__compileFormat(const char* format)
+{
+  PT_TimeFormatSpec_t spec = { PT_TF_24H, { "am", "pm" } };
+  if (format == NULL)
+    return spec;
+  if (strcmp(format, "12h") == 0)
+    spec.format = PT_TF_12H;
+  else if (strcmp(format, "12hNS") == 0)
+    spec.format = PT_TF_12H_NS;
+  else if (strcmp(format, "Float") == 0)
+    spec.format = PT_TF_FLOAT;
+  return spec;
+}
+
+/**
+ * Write two digits number
+ *
+ * @param[out]  out
+ * @param[in]   value
+ * @return            Number of written chars
+ **/
+static inline int
+PT__writeTwoDigits(char* out, const int value)
+{
+  out[0] = '0' + (value / 10);
+  out[1] = '0' + (value % 10);
+  return 2;
+}
+
+int
+PT__formatTimeTo(const PT_TimeFormatSpec_t* spec,
+                 const double resultTime,
+                 char* buffer,
+                 const size_t size)
+{
+  PT_STATS_BEGIN(start);
+  char formatted[PT_TIME_SIZE];
+  int length = 0;
+
+  if (!(fabs(resultTime) < 1e6)) {
+    memcpy(formatted, "-----", 5);
+    length = 5;
+  } else if (spec->format == PT_TF_FLOAT) {
+    long long scaled = llround(fabs(resultTime) * 10000);
+    char digits[8];
+    int nDigits = 0;
+    if (resultTime < 0 && scaled)
+      formatted[length++] = '-';
+    for (long long whole = scaled / 10000; nDigits == 0 || whole; whole /= 10)
+      digits[nDigits++] = '0' + (whole % 10);
+    while (nDigits)
+      formatted[length++] = digits[--nDigits];
+    formatted[length++] = '.';
+    length += PT__writeTwoDigits(formatted + length, (scaled % 10000) / 100);
+    length += PT__writeTwoDigits(formatted + length, scaled % 100);
+  } else {
+    const double time = PTM__fixHour(resultTime + (1 / 180.0f));
+    const int hours = (int)floor(time);
+    const int minutes = (int)floor((time - hours) * 60);
+    if (spec->format == PT_TF_24H)
+      length += PT__writeTwoDigits(formatted, hours);
+    else if ((hours + 11) % 12 + 1 >= 10)
+      length += PT__writeTwoDigits(formatted, (hours + 11) % 12 + 1);
+    else
+      formatted[length++] = '0' + (hours + 11) % 12 + 1;
+    formatted[length++] = ':';
+    length += PT__writeTwoDigits(formatted + length, minutes);
+    if (spec->format == PT_TF_12H) {
+      const char* suffix = spec->suffixes[hours < 12 ? 0 : 1];
+      formatted[length++] = ' ';
+      while (*suffix && length < PT_TIME_SIZE - 1)
+        formatted[length++] = *suffix++;
+    }
+  }
+
+  if (size > 0) {
+    size_t copied = (size_t)length < size - 1 ? (size_t)length : size - 1;
+    memcpy(buffer, formatted, copied);
+    buffer[copied] = '\0';
+  }
+
+  PT_STATS_END(PT_ST_FORMAT, start);
+  return length;
+}
+
+void
+PT__formatTimesTo(const PT_TimeFormatSpec_t* spec,
+                  const PT_PrayerTimes_t times,
+                  PT_FormattedTimes_t buffers)
+{
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    PT__formatTimeTo(spec, times[i], buffers[i], PT_TIME_SIZE);
 }
 
 char*
 PT__formatTime(const PT pt, const double resultTime, const char* format)
 {
-  const double time = PTM__fixHour(resultTime + (1 / 180.0f));
-  const int hours = (int)floor(time);
-  const int minutes = (int)floor((time - hours) * 60);
-  char* formatted = malloc(6 * sizeof(char));
-  formatted[0] = '0' + (hours / 10);
-  formatted[1] = '0' + (hours % 10);
-  formatted[2] = ':';
-  formatted[3] = '0' + (minutes / 10);
-  formatted[4] = '0' + (minutes % 10);
-  formatted[5] = '\0';
+  const PT_TimeFormatSpec_t spec = PT__compileFormat(format);
+  char buffer[PT_TIME_SIZE];
+  const int length =
+    PT__formatTimeTo(&spec, resultTime, buffer, sizeof(buffer));
+  char* formatted = malloc((length + 1) * sizeof(char));
+  memcpy(formatted, buffer, length + 1);
 
   return formatted;
 }
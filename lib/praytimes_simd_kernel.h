@@ -0,0 +1,508 @@
+/*
+ * Vector kernels template, included by praytimes_simd.c once per instruction
+ * set and once for plain doubles, with these macros defined:
+ *
+ *   PTV_NAME(name)  name suffixed by the instruction set
+ *   PTV_ATTR        function attributes enabling the instruction set
+ *   PTV_LANES       number of lanes, 1 for the scalar polynomial functions
+ *                   which get no array drivers
+ *   V, M            vector & mask types
+ *   V_SET1, V_LOAD, V_STORE, V_ADD, V_SUB, V_MUL, V_DIV, V_SQRT, V_ABS,
+ *   V_LT, V_LE, V_GT, V_EQ, V_MAND, V_SEL(mask, a, b)
+ */
+
+#define PTV_DP1 1.5707963267341256e+00
+#define PTV_DP2 6.0771005065061922e-11
+#define PTV_DP3 2.0222662487959506e-21
+#define PTV_ROUND_MAGIC 6755399441055744.0
+#define PTV_PI 3.14159265358979323846
+#define PTV_MOREBITS 6.123233995736765886130E-17
+
+/**
+ * Round to nearest integer (|x| < 2^51)
+ *
+ * @param[in]  x
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vround)(V x)
+{
+  return V_SUB(V_ADD(x, V_SET1(PTV_ROUND_MAGIC)), V_SET1(PTV_ROUND_MAGIC));
+}
+
+/**
+ * Round down to integer (|x| < 2^51)
+ *
+ * @param[in]  x
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vfloor)(V x)
+{
+  V r = PTV_NAME(vround)(x);
+  return V_SEL(V_GT(r, x), V_SUB(r, V_SET1(1.0)), r);
+}
+
+/**
+ * Sin & cos of radians angle
+ *
+ * @param[in]   x
+ * @param[out]  s
+ * @param[out]  c
+ **/
+static inline PTV_ATTR void
+PTV_NAME(vsincos)(V x, V* s, V* c)
+{
+  V j = PTV_NAME(vround)(V_MUL(x, V_SET1(2.0 / PTV_PI)));
+  V r = V_SUB(V_SUB(V_SUB(x, V_MUL(j, V_SET1(PTV_DP1))),
+                    V_MUL(j, V_SET1(PTV_DP2))),
+              V_MUL(j, V_SET1(PTV_DP3)));
+  V q = V_SUB(j,
+              V_MUL(V_SET1(4.0),
+                    PTV_NAME(vround)(V_SUB(V_MUL(j, V_SET1(0.25)),
+                                           V_SET1(0.375)))));
+  V z = V_MUL(r, r);
+
+  V ps = V_SET1(1.58962301576546568060E-10);
+  ps = V_ADD(V_MUL(ps, z), V_SET1(-2.50507477628578072866E-8));
+  ps = V_ADD(V_MUL(ps, z), V_SET1(2.75573136213857245213E-6));
+  ps = V_ADD(V_MUL(ps, z), V_SET1(-1.98412698295895385996E-4));
+  ps = V_ADD(V_MUL(ps, z), V_SET1(8.33333333332211858878E-3));
+  ps = V_ADD(V_MUL(ps, z), V_SET1(-1.66666666666666307295E-1));
+  V sr = V_ADD(r, V_MUL(V_MUL(r, z), ps));
+
+  V pc = V_SET1(-1.13585365213876817300E-11);
+  pc = V_ADD(V_MUL(pc, z), V_SET1(2.08757008419747316778E-9));
+  pc = V_ADD(V_MUL(pc, z), V_SET1(-2.75573141792967388112E-7));
+  pc = V_ADD(V_MUL(pc, z), V_SET1(2.48015872888517045348E-5));
+  pc = V_ADD(V_MUL(pc, z), V_SET1(-1.38888888888730564116E-3));
+  pc = V_ADD(V_MUL(pc, z), V_SET1(4.16666666666665929218E-2));
+  V cr = V_ADD(V_SUB(V_SET1(1.0), V_MUL(V_SET1(0.5), z)),
+               V_MUL(V_MUL(z, z), pc));
+
+  V zero = V_SET1(0.0);
+  M q1 = V_EQ(q, V_SET1(1.0)), q2 = V_EQ(q, V_SET1(2.0));
+  M q3 = V_EQ(q, V_SET1(3.0));
+  V nsr = V_SUB(zero, sr), ncr = V_SUB(zero, cr);
+  *s = V_SEL(q1, cr, V_SEL(q2, nsr, V_SEL(q3, ncr, sr)));
+  *c = V_SEL(q1, nsr, V_SEL(q2, ncr, V_SEL(q3, sr, cr)));
+}
+
+/**
+ * Arctan in radians
+ *
+ * @param[in]  x
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vatan)(V x)
+{
+  V zero = V_SET1(0.0), one = V_SET1(1.0);
+  M negative = V_LT(x, zero);
+  V a = V_ABS(x);
+  M big = V_GT(a, V_SET1(2.41421356237309504880));
+  M small = V_LE(a, V_SET1(0.66));
+
+  V y = V_SEL(big, V_SET1(PTV_PI / 2), V_SEL(small, zero, V_SET1(PTV_PI / 4)));
+  V more = V_SEL(
+    big, V_SET1(PTV_MOREBITS), V_SEL(small, zero, V_SET1(0.5 * PTV_MOREBITS)));
+  a = V_DIV(V_SEL(big, V_SET1(-1.0), V_SEL(small, a, V_SUB(a, one))),
+            V_SEL(big, a, V_SEL(small, one, V_ADD(a, one))));
+
+  V z = V_MUL(a, a);
+  V p = V_SET1(-8.750608600031904122785E-1);
+  p = V_ADD(V_MUL(p, z), V_SET1(-1.615753718733365076637E1));
+  p = V_ADD(V_MUL(p, z), V_SET1(-7.500855792314704667340E1));
+  p = V_ADD(V_MUL(p, z), V_SET1(-1.228866684490136173410E2));
+  p = V_ADD(V_MUL(p, z), V_SET1(-6.485021904942025371773E1));
+  V q = V_ADD(z, V_SET1(2.485846490142306297962E1));
+  q = V_ADD(V_MUL(q, z), V_SET1(1.650270098316988542046E2));
+  q = V_ADD(V_MUL(q, z), V_SET1(4.328810604912902668951E2));
+  q = V_ADD(V_MUL(q, z), V_SET1(4.853903996359136964868E2));
+  q = V_ADD(V_MUL(q, z), V_SET1(1.945506571482613964425E2));
+  z = V_ADD(V_MUL(a, V_DIV(V_MUL(z, p), q)), a);
+  y = V_ADD(y, V_ADD(z, more));
+
+  return V_SEL(negative, V_SUB(zero, y), y);
+}
+
+/**
+ * Arctan2 in radians
+ *
+ * @param[in]  y
+ * @param[in]  x
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vatan2)(V y, V x)
+{
+  V zero = V_SET1(0.0);
+  V t = PTV_NAME(vatan)(V_DIV(y, x));
+  V turn = V_SEL(V_LT(y, zero), V_SET1(-PTV_PI), V_SET1(PTV_PI));
+  t = V_SEL(V_LT(x, zero), V_ADD(t, turn), t);
+  return V_SEL(V_MAND(V_EQ(x, zero), V_EQ(y, zero)), zero, t);
+}
+
+/**
+ * Degrees to radians, with the same pi as the scalar functions
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vrad)(V a)
+{
+  return V_DIV(V_MUL(a, V_SET1(M_PI)), V_SET1(180.0f));
+}
+
+/**
+ * Radians to degrees, with the same pi as the scalar functions
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vdeg)(V a)
+{
+  return V_DIV(V_MUL(a, V_SET1(180.0f)), V_SET1(M_PI));
+}
+
+/**
+ * Degree-based sin
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vsin)(V a)
+{
+  V s, c;
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(a), &s, &c);
+  return s;
+}
+
+/**
+ * Degree-based cos
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vcos)(V a)
+{
+  V s, c;
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(a), &s, &c);
+  return c;
+}
+
+/**
+ * Degree-based tan
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vtan)(V a)
+{
+  V s, c;
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(a), &s, &c);
+  return V_DIV(s, c);
+}
+
+/**
+ * Degree-based arccot
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(varccot)(V a)
+{
+  return PTV_NAME(vdeg)(PTV_NAME(vatan)(V_DIV(V_SET1(1.0), a)));
+}
+
+/**
+ * Degree-based arccos
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(varccos)(V a)
+{
+  V one = V_SET1(1.0);
+  V root = V_SQRT(V_MUL(V_SUB(one, a), V_ADD(one, a)));
+  return PTV_NAME(vdeg)(PTV_NAME(vatan2)(root, a));
+}
+
+/**
+ * Degree-based arcsin
+ *
+ * @param[in]  a
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(varcsin)(V a)
+{
+  V one = V_SET1(1.0);
+  V root = V_SQRT(V_MUL(V_SUB(one, a), V_ADD(one, a)));
+  return PTV_NAME(vdeg)(PTV_NAME(vatan2)(a, root));
+}
+
+/**
+ * Degree-based arctan2
+ *
+ * @param[in]  a
+ * @param[in]  b
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(varctan2)(V a, V b)
+{
+  return PTV_NAME(vdeg)(PTV_NAME(vatan2)(a, b));
+}
+
+/**
+ * Fix value into [0, range)
+ *
+ * @param[in]  a
+ * @param[in]  range
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vfix)(V a, const double range)
+{
+  V r = V_SET1(range);
+  a = V_SUB(a, V_MUL(r, PTV_NAME(vfloor)(V_DIV(a, r))));
+  return V_SEL(V_LT(a, V_SET1(0.0)), V_ADD(a, r), a);
+}
+
+/**
+ * Compute declination angle of sun and equation of time
+ *
+ * @param[in]   jd
+ * @param[out]  decl
+ * @param[out]  eqt
+ **/
+static inline PTV_ATTR void
+PTV_NAME(vsunPosition)(V jd, V* decl, V* eqt)
+{
+  V D = V_SUB(jd, V_SET1(2451545.0f));
+  V g = PTV_NAME(vfix)(
+    V_ADD(V_SET1(357.529f), V_MUL(V_SET1(0.98560028f), D)), 360.0f);
+  V q = PTV_NAME(vfix)(
+    V_ADD(V_SET1(280.459f), V_MUL(V_SET1(0.98564736f), D)), 360.0f);
+  V L = PTV_NAME(vfix)(
+    V_ADD(V_ADD(q, V_MUL(V_SET1(1.915f), PTV_NAME(vsin)(g))),
+          V_MUL(V_SET1(0.020f),
+                PTV_NAME(vsin)(V_MUL(V_SET1(2.0f), g)))),
+    360.0f);
+  V e = V_SUB(V_SET1(23.439f), V_MUL(V_SET1(0.00000036f), D));
+
+  V sinL, cosL, sinE, cosE;
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(L), &sinL, &cosL);
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(e), &sinE, &cosE);
+  V RA = V_DIV(PTV_NAME(varctan2)(V_MUL(cosE, sinL), cosL), V_SET1(15.0f));
+  *decl = PTV_NAME(varcsin)(V_MUL(sinE, sinL));
+  *eqt = V_SUB(V_DIV(q, V_SET1(15.0)), PTV_NAME(vfix)(RA, 24.0f));
+}
+
+/**
+ * Compute the hour angle (in hours) of given angle of sun
+ *
+ * @param[in]  decl
+ * @param[in]  angle
+ * @param[in]  lat
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vsunHourAngle)(V decl, V angle, V lat)
+{
+  V sinD, cosD, sinLat, cosLat;
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(decl), &sinD, &cosD);
+  PTV_NAME(vsincos)(PTV_NAME(vrad)(lat), &sinLat, &cosLat);
+  return V_MUL(
+    V_SET1(1 / 15.0f),
+    PTV_NAME(varccos)(V_DIV(
+      V_SUB(V_SUB(V_SET1(0.0), PTV_NAME(vsin)(angle)), V_MUL(sinD, sinLat)),
+      V_MUL(cosD, cosLat))));
+}
+
+/**
+ * Compute the time of given angle of sun from a known sun position
+ *
+ * @param[in]  decl
+ * @param[in]  noon
+ * @param[in]  angle
+ * @param[in]  direction
+ * @param[in]  lat
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vsunAngleTimeAt)(V decl,
+                          V noon,
+                          V angle,
+                          const PTM_SunDirection_t direction,
+                          V lat)
+{
+  V t = PTV_NAME(vsunHourAngle)(decl, angle, lat);
+  return direction == PTM_SD_CCW ? V_SUB(noon, t) : V_ADD(noon, t);
+}
+
+/**
+ * Compute the time of given angle of sun
+ *
+ * @param[in]  jDate
+ * @param[in]  angle
+ * @param[in]  time
+ * @param[in]  direction
+ * @param[in]  lat
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vsunAngleTime)(V jDate,
+                        V angle,
+                        V time,
+                        const PTM_SunDirection_t direction,
+                        V lat)
+{
+  V decl, eqt;
+  PTV_NAME(vsunPosition)(V_ADD(jDate, time), &decl, &eqt);
+  V noon = PTV_NAME(vfix)(V_SUB(V_SET1(12.0f), eqt), 24.0f);
+  return PTV_NAME(vsunAngleTimeAt)(decl, noon, angle, direction, lat);
+}
+
+/**
+ * Load up to PTV_LANES values, padding with zeros
+ *
+ * @param[in]  a
+ * @param[in]  n
+ * @return
+ **/
+static inline PTV_ATTR V
+PTV_NAME(vloadPartial)(const double* a, const size_t n)
+{
+  double padded[PTV_LANES] = { 0 };
+  for (size_t i = 0; i < n; i++)
+    padded[i] = a[i];
+  return V_LOAD(padded);
+}
+
+/**
+ * Store up to PTV_LANES values
+ *
+ * @param[out]  out
+ * @param[in]   v
+ * @param[in]   n
+ **/
+static inline PTV_ATTR void
+PTV_NAME(vstorePartial)(double* out, V v, const size_t n)
+{
+  double padded[PTV_LANES];
+  V_STORE(padded, v);
+  for (size_t i = 0; i < n; i++)
+    out[i] = padded[i];
+}
+
+#if PTV_LANES > 1
+
+/*
+ * Array drivers: full vectors, then the padded remainder.
+ */
+
+#define PTV_FOR_EACH(body)                                                     \
+  for (size_t i = 0; i < n; i += PTV_LANES) {                                  \
+    size_t lanes = n - i < PTV_LANES ? n - i : PTV_LANES;                      \
+    body                                                                       \
+  }
+
+#define PTV_IN(a)                                                              \
+  (lanes == PTV_LANES ? V_LOAD((a) + i)                                        \
+                      : PTV_NAME(vloadPartial)((a) + i, lanes))
+
+#define PTV_STORE(a, v)                                                        \
+  if (lanes == PTV_LANES)                                                      \
+    V_STORE((a) + i, (v));                                                     \
+  else                                                                         \
+    PTV_NAME(vstorePartial)((a) + i, (v), lanes);
+
+#define PTV_OUT(v) PTV_STORE(out, v)
+
+static PTV_ATTR void
+PTV_NAME(PTV__sin)(double* out, const double* a, const size_t n)
+{
+  PTV_FOR_EACH(V r = PTV_NAME(vsin)(PTV_IN(a)); PTV_OUT(r))
+}
+
+static PTV_ATTR void
+PTV_NAME(PTV__cos)(double* out, const double* a, const size_t n)
+{
+  PTV_FOR_EACH(V r = PTV_NAME(vcos)(PTV_IN(a)); PTV_OUT(r))
+}
+
+static PTV_ATTR void
+PTV_NAME(PTV__arccos)(double* out, const double* a, const size_t n)
+{
+  PTV_FOR_EACH(V r = PTV_NAME(varccos)(PTV_IN(a)); PTV_OUT(r))
+}
+
+static PTV_ATTR void
+PTV_NAME(PTV__arctan2)(double* out,
+                       const double* a,
+                       const double* b,
+                       const size_t n)
+{
+  PTV_FOR_EACH(V r = PTV_NAME(varctan2)(PTV_IN(a), PTV_IN(b)); PTV_OUT(r))
+}
+
+static PTV_ATTR void
+PTV_NAME(PTV__sunAngleTime)(double* out,
+                            const double* jDate,
+                            const double* angle,
+                            const double* time,
+                            const PTM_SunDirection_t direction,
+                            const double* lat,
+                            const size_t n)
+{
+  PTV_FOR_EACH(V r = PTV_NAME(vsunAngleTime)(PTV_IN(jDate),
+                                             PTV_IN(angle),
+                                             PTV_IN(time),
+                                             direction,
+                                             PTV_IN(lat));
+               PTV_OUT(r))
+}
+
+static PTV_ATTR void
+PTV_NAME(PTV__sunPosition)(double* decl,
+                           double* eqt,
+                           const double* jd,
+                           const size_t n)
+{
+  PTV_FOR_EACH(V d; V e; PTV_NAME(vsunPosition)(PTV_IN(jd), &d, &e);
+               PTV_STORE(decl, d) PTV_STORE(eqt, e))
+}
+
+static PTV_ATTR void
+PTV_NAME(PTV__sunHourAngle)(double* out,
+                            const double* decl,
+                            const double* angle,
+                            const double* lat,
+                            const size_t n)
+{
+  PTV_FOR_EACH(
+    V r = PTV_NAME(vsunHourAngle)(PTV_IN(decl), PTV_IN(angle), PTV_IN(lat));
+    PTV_OUT(r))
+}
+
+#undef PTV_STORE
+#undef PTV_FOR_EACH
+#undef PTV_IN
+#undef PTV_OUT
+
+#endif
+#undef PTV_DP1
+#undef PTV_DP2
+#undef PTV_DP3
+#undef PTV_ROUND_MAGIC
+#undef PTV_PI
+#undef PTV_MOREBITS
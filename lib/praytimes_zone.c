@@ -0,0 +1,481 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "praytimes_zone.h"
+
+#define PTZ_DIR "/usr/share/zoneinfo"
+#define PTZ_PATH_SIZE 4096
+#define PTZ_MAX_SIZE (1 << 20)
+#define PTZ_HEADER_SIZE 44
+#define PTZ_LAST_YEAR 2200
+
+/**
+ * Daylight saving rule of a TZif footer (POSIX TZ string).
+ **/
+typedef struct private_ptz_rule_t
+{
+  char type; /* 'M' month, week & weekday, 'J' day without leap, 'D' day */
+  int month;
+  int week;
+  int weekday;
+  int day;
+  long time; /* local time of the change (in seconds) */
+} PTZ_Rule_t;
+
+/**
+ * Real time zone struct data type.
+ **/
+typedef struct private_ptz_t
+{
+  char* name;
+  int references;
+  struct private_ptz_t* next;
+  int32_t initial;  /* offset before the first transition (in seconds) */
+  size_t count;     /* number of transitions */
+  int64_t* times;   /* Unix times of the transitions, ascending */
+  int32_t* offsets; /* offsets from each transition (in seconds) */
+} * PrivatePTZ;
+
+/**
+ * Loaded zones
+ **/
+static pthread_mutex_t zonesLock = PTHREAD_MUTEX_INITIALIZER;
+static PrivatePTZ zones = NULL;
+
+/**
+ * Read big-endian signed integer
+ *
+ * @param[in]  p
+ * @param[in]  size  4 or 8 bytes
+ * @return
+ **/
+static int64_t
+PTZ__read(const uint8_t* p, const size_t size)
+{
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; i++)
+    value = value << 8 | p[i];
+  return size == 4 ? (int32_t)(uint32_t)value : (int64_t)value;
+}
+
+/**
+ * Days since 1970-01-01 of a date
+ *
+ * @param[in]  year
+ * @param[in]  month
+ * @param[in]  day
+ * @return
+ **/
+static long
+PTZ__days(const int year, const int month, const int day)
+{
+  const long y = year - (month <= 2);
+  const long era = (y >= 0 ? y : y - 399) / 400;
+  const long yoe = y - era * 400;
+  const long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+/**
+ * Day of a daylight saving rule in a year
+ *
+ * @param[in]  year
+ * @param[in]  rule
+ * @return          Days since 1970-01-01
+ **/
+static long
+PTZ__ruleDay(const int year, const PTZ_Rule_t* rule)
+{
+  static const int lengths[12] = { 31, 28, 31, 30, 31, 30,
+                                   31, 31, 30, 31, 30, 31 };
+  const int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  if (rule->type == 'J')
+    return PTZ__days(year, 1, 1) + rule->day - 1 + (leap && rule->day >= 60);
+  if (rule->type == 'D')
+    return PTZ__days(year, 1, 1) + rule->day;
+
+  const long first = PTZ__days(year, rule->month, 1);
+  const int length = lengths[rule->month - 1] + (leap && rule->month == 2);
+  const int weekday = (int)(((first + 4) % 7 + 7) % 7); /* thursday */
+  int day = (rule->weekday - weekday + 7) % 7 + (rule->week - 1) * 7;
+  while (day >= length)
+    day -= 7;
+  return first + day;
+}
+
+/**
+ * Parse a zone abbreviation of a POSIX TZ string
+ *
+ * @param[in]  s
+ * @return       End of the abbreviation, NULL when there is none
+ **/
+static const char*
+PTZ__parseName(const char* s)
+{
+  const char* start = s;
+  if (*s == '<') {
+    while (*s && *s != '>')
+      s++;
+    return *s ? s + 1 : NULL;
+  }
+  while ((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))
+    s++;
+  return s - start >= 3 ? s : NULL;
+}
+
+/**
+ * Parse [+-]hh[:mm[:ss]] of a POSIX TZ string
+ *
+ * @param[in]   s
+ * @param[out]  seconds
+ * @return               End of the time, NULL when there is none
+ **/
+static const char*
+PTZ__parseTime(const char* s, long* seconds)
+{
+  int sign = 1;
+  if (*s == '-' || *s == '+')
+    sign = *s++ == '-' ? -1 : 1;
+  if (*s < '0' || *s > '9')
+    return NULL;
+  long value = 0;
+  for (int field = 0, unit = 3600; field < 3; field++, unit /= 60) {
+    long number = 0;
+    while (*s >= '0' && *s <= '9')
+      number = number * 10 + (*s++ - '0');
+    value += number * unit;
+    if (field == 2 || *s != ':' || s[1] < '0' || s[1] > '9')
+      break;
+    s++;
+  }
+  *seconds = sign * value;
+  return s;
+}
+
+/**
+ * Parse a daylight saving rule of a POSIX TZ string
+ *
+ * @param[in]   s
+ * @param[out]  rule
+ * @return            End of the rule, NULL when malformed
+ **/
+static const char*
+PTZ__parseRule(const char* s, PTZ_Rule_t* rule)
+{
+  char* end;
+  rule->time = 7200;
+  if (*s == 'M') {
+    rule->type = 'M';
+    rule->month = strtol(s + 1, &end, 10);
+    if (*end != '.')
+      return NULL;
+    rule->week = strtol(end + 1, &end, 10);
+    if (*end != '.')
+      return NULL;
+    rule->weekday = strtol(end + 1, &end, 10);
+    if (rule->month < 1 || rule->month > 12 || rule->week < 1 ||
+        rule->week > 5 || rule->weekday < 0 || rule->weekday > 6)
+      return NULL;
+  } else {
+    rule->type = *s == 'J' ? 'J' : 'D';
+    if (*s == 'J')
+      s++;
+    if (*s < '0' || *s > '9')
+      return NULL;
+    rule->day = strtol(s, &end, 10);
+    if (rule->day > 365 || (rule->type == 'J' && rule->day < 1))
+      return NULL;
+  }
+  s = end;
+  if (*s == '/' && (s = PTZ__parseTime(s + 1, &rule->time)) == NULL)
+    return NULL;
+  return s;
+}
+
+/**
+ * Append a transition
+ *
+ * @param[in,out]  ptz
+ * @param[in,out]  capacity
+ * @param[in]      time
+ * @param[in]      offset
+ * @return                   0 on success, -1 on allocation failure
+ **/
+static int
+PTZ__append(PrivatePTZ ptz,
+            size_t* capacity,
+            const int64_t time,
+            const int32_t offset)
+{
+  if (ptz->count == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 64;
+    int64_t* times = realloc(ptz->times, grown * sizeof(int64_t));
+    if (times == NULL)
+      return -1;
+    ptz->times = times;
+    int32_t* offsets = realloc(ptz->offsets, grown * sizeof(int32_t));
+    if (offsets == NULL)
+      return -1;
+    ptz->offsets = offsets;
+    *capacity = grown;
+  }
+  ptz->times[ptz->count] = time;
+  ptz->offsets[ptz->count++] = offset;
+  return 0;
+}
+
+/**
+ * Expand the daylight saving rule of a TZif footer into transitions, after
+ * the last transition of the file, up to PTZ_LAST_YEAR
+ *
+ * @param[in,out]  ptz
+ * @param[in,out]  capacity
+ * @param[in]      tz        POSIX TZ string
+ * @return                   0 on success, -1 on failure
+ **/
+static int
+PTZ__expand(PrivatePTZ ptz, size_t* capacity, const char* tz)
+{
+  long stdOffset, dstOffset;
+  PTZ_Rule_t start, end;
+  const char* s = PTZ__parseName(tz);
+  if (s == NULL || (s = PTZ__parseTime(s, &stdOffset)) == NULL)
+    return -1;
+  stdOffset = -stdOffset;
+  if (*s == '\0') {
+    /* no daylight saving, the last transition lasts */
+    if (ptz->count == 0)
+      ptz->initial = stdOffset;
+    return 0;
+  }
+  if ((s = PTZ__parseName(s)) == NULL)
+    return -1;
+  dstOffset = stdOffset + 3600;
+  if (*s != ',' && *s != '\0') {
+    if ((s = PTZ__parseTime(s, &dstOffset)) == NULL)
+      return -1;
+    dstOffset = -dstOffset;
+  }
+  if (*s != ',')
+    return 0; /* implementation defined rule, left out */
+  if ((s = PTZ__parseRule(s + 1, &start)) == NULL || *s != ',' ||
+      (s = PTZ__parseRule(s + 1, &end)) == NULL || *s != '\0')
+    return -1;
+
+  int64_t last = ptz->count ? ptz->times[ptz->count - 1] : INT64_MIN;
+  int year = ptz->count ? 1970 + (int)(last / 31556952) - 1 : 1970;
+  for (; year <= PTZ_LAST_YEAR; year++) {
+    int64_t starts = PTZ__ruleDay(year, &start) * 86400LL + start.time -
+                     stdOffset;
+    int64_t ends = PTZ__ruleDay(year, &end) * 86400LL + end.time - dstOffset;
+    int64_t times[2] = { starts < ends ? starts : ends,
+                         starts < ends ? ends : starts };
+    int32_t offsets[2] = { starts < ends ? dstOffset : stdOffset,
+                           starts < ends ? stdOffset : dstOffset };
+    for (int i = 0; i < 2; i++)
+      if (times[i] > last) {
+        if (PTZ__append(ptz, capacity, times[i], offsets[i]) != 0)
+          return -1;
+        last = times[i];
+      }
+  }
+  return 0;
+}
+
+/**
+ * Parse a TZif file into the transitions of a zone
+ *
+ * @param[out]  ptz
+ * @param[in]   data
+ * @param[in]   size
+ * @return            0 on success, -1 on failure
+ **/
+static int
+PTZ__parse(PrivatePTZ ptz, const uint8_t* data, const size_t size)
+{
+  const uint8_t* p = data;
+  const uint8_t* limit = data + size;
+  size_t timeSize = 4, counts[6], length = 0;
+
+  for (int block = 0; block < 2; block++) {
+    if (limit - p < PTZ_HEADER_SIZE || memcmp(p, "TZif", 4) != 0)
+      return -1;
+    /* isutcnt, isstdcnt, leapcnt, timecnt, typecnt & charcnt */
+    for (int i = 0; i < 6; i++)
+      counts[i] = (uint32_t)PTZ__read(p + 20 + i * 4, 4);
+    length = counts[3] * timeSize + counts[3] + counts[4] * 6 + counts[5] +
+             counts[2] * (timeSize + 4) + counts[1] + counts[0];
+    if (counts[4] == 0 || (size_t)(limit - p) - PTZ_HEADER_SIZE < length)
+      return -1;
+    if (data[4] < '2' || block == 1)
+      break;
+    /* the version 2+ data block follows, with 64-bit times */
+    p += PTZ_HEADER_SIZE + length;
+    timeSize = 8;
+  }
+
+  const size_t timecnt = counts[3], typecnt = counts[4];
+  const uint8_t* times = p + PTZ_HEADER_SIZE;
+  const uint8_t* indexes = times + timecnt * timeSize;
+  const uint8_t* types = indexes + timecnt;
+  size_t capacity = 0;
+
+  ptz->initial = (int32_t)PTZ__read(types, 4);
+  for (size_t i = 0; i < timecnt; i++) {
+    if (indexes[i] >= typecnt)
+      return -1;
+    if (PTZ__append(ptz,
+                    &capacity,
+                    PTZ__read(times + i * timeSize, timeSize),
+                    (int32_t)PTZ__read(types + indexes[i] * 6, 4)) != 0)
+      return -1;
+  }
+
+  /* the footer, a POSIX TZ string, rules the times after the last one */
+  const uint8_t* footer = p + PTZ_HEADER_SIZE + length;
+  if (timeSize == 8 && footer < limit && *footer == '\n') {
+    const uint8_t* eol = memchr(footer + 1, '\n', limit - footer - 1);
+    if (eol == NULL)
+      return -1;
+    char tz[256];
+    size_t tzLength = eol - footer - 1;
+    if (tzLength >= sizeof(tz))
+      return -1;
+    memcpy(tz, footer + 1, tzLength);
+    tz[tzLength] = '\0';
+    if (tzLength && PTZ__expand(ptz, &capacity, tz) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+/**
+ * Free a zone
+ *
+ * @param[in]  ptz
+ **/
+static void
+PTZ__destroy(PrivatePTZ ptz)
+{
+  free(ptz->name);
+  free(ptz->times);
+  free(ptz->offsets);
+  free(ptz);
+}
+
+/**
+ * Read a zone from its file
+ *
+ * @param[in]  name
+ * @return          Zone, NULL on failure
+ **/
+static PrivatePTZ
+PTZ__loadFile(const char* name)
+{
+  char path[PTZ_PATH_SIZE];
+  const char* dir = getenv("TZDIR");
+  if (name[0] == '/')
+    snprintf(path, sizeof(path), "%s", name);
+  else if (strstr(name, "..") != NULL ||
+           snprintf(path, sizeof(path), "%s/%s", dir ? dir : PTZ_DIR, name) >=
+             (int)sizeof(path))
+    return NULL;
+
+  FILE* file = fopen(path, "rb");
+  if (file == NULL)
+    return NULL;
+  uint8_t* data = malloc(PTZ_MAX_SIZE);
+  size_t size = data ? fread(data, 1, PTZ_MAX_SIZE, file) : 0;
+  fclose(file);
+
+  PrivatePTZ ptz = calloc(1, sizeof(struct private_ptz_t));
+  if (ptz == NULL || data == NULL || size == PTZ_MAX_SIZE ||
+      PTZ__parse(ptz, data, size) != 0 ||
+      (ptz->name = malloc(strlen(name) + 1)) == NULL) {
+    if (ptz)
+      PTZ__destroy(ptz);
+    free(data);
+    return NULL;
+  }
+  free(data);
+  strcpy(ptz->name, name);
+  return ptz;
+}
+
+PTZ
+PTZ__load(const char* name)
+{
+  pthread_mutex_lock(&zonesLock);
+  PrivatePTZ ptz = zones;
+  while (ptz != NULL && strcmp(ptz->name, name) != 0)
+    ptz = ptz->next;
+  if (ptz == NULL && (ptz = PTZ__loadFile(name)) != NULL) {
+    ptz->next = zones;
+    zones = ptz;
+  }
+  if (ptz != NULL)
+    ptz->references++;
+  pthread_mutex_unlock(&zonesLock);
+  return (PTZ)ptz;
+}
+
+void
+PTZ__free(PTZ* ptz)
+{
+  PrivatePTZ _ptz = (PrivatePTZ)*ptz;
+  *ptz = NULL;
+  if (_ptz == NULL)
+    return;
+  pthread_mutex_lock(&zonesLock);
+  if (--_ptz->references == 0) {
+    PrivatePTZ* link = &zones;
+    while (*link != _ptz)
+      link = &(*link)->next;
+    *link = _ptz->next;
+    PTZ__destroy(_ptz);
+  }
+  pthread_mutex_unlock(&zonesLock);
+}
+
+/**
+ * Get the UTC offset of a zone at a time
+ *
+ * @param[in]  ptz
+ * @param[in]  unixTime
+ * @return               Offset (in seconds)
+ **/
+static int32_t
+PTZ__lookup(const PrivatePTZ ptz, const double unixTime)
+{
+  /* first transition after the time */
+  size_t low = 0, high = ptz->count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (ptz->times[middle] <= unixTime)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low == 0 ? ptz->initial : ptz->offsets[low - 1];
+}
+
+double
+PTZ__offset(const PTZ ptz, const double unixTime)
+{
+  return PTZ__lookup((PrivatePTZ)ptz, unixTime) / 3600.0;
+}
+
+double
+PTZ__dayOffset(const PTZ ptz, const long day)
+{
+  PrivatePTZ _ptz = (PrivatePTZ)ptz;
+  const double noon = day * 86400.0 + 43200.0;
+  int32_t offset = PTZ__lookup(_ptz, noon);
+  offset = PTZ__lookup(_ptz, noon - offset);
+  return offset / 3600.0;
+}
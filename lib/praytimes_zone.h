@@ -0,0 +1,142 @@
+#ifndef __PRAYTIMES_ZONE_H
+#define __PRAYTIMES_ZONE_H
+
+#include "praytimes.h"
+
+/**
+ * Time zone data type.
+ *
+ * A zone is read once from its TZif file (RFC 8536) of the zoneinfo
+ * directory, $TZDIR or /usr/share/zoneinfo, into a sorted index of its UTC
+ * offset transitions, the rule of the file footer being expanded up to 2200.
+ * Lookups binary search the index, without system call. Zones are cached by
+ * name & shared, they are immutable and safe to use from many threads.
+ **/
+typedef struct ptz_t
+{
+} * PTZ;
+
+/**
+ * Load a time zone, or take it from the cache of the loaded zones
+ *
+ * @param[in]  name  IANA zone name (e.g. "Asia/Kolkata") or TZif file path
+ * @return           Time zone instance, NULL on failure
+ **/
+PTZ
+PTZ__load(const char* name);
+
+/**
+ * Release a time zone, freed with its last reference
+ *
+ * @param[out]  ptz  Time zone instance
+ **/
+void
+PTZ__free(PTZ* ptz);
+
+/**
+ * Get the UTC offset of a zone at a time
+ *
+ * @param[in]  ptz       Time zone instance
+ * @param[in]  unixTime  Unix time (in seconds)
+ * @return               UTC offset (in hours), daylight saving included
+ **/
+double
+PTZ__offset(const PTZ ptz, const double unixTime);
+
+/**
+ * Get the UTC offset of a zone on a local day, the one in effect at noon
+ *
+ * @param[in]  ptz  Time zone instance
+ * @param[in]  day  Local day since 1970-01-01
+ * @return          UTC offset (in hours), daylight saving included
+ **/
+double
+PTZ__dayOffset(const PTZ ptz, const long day);
+
+/**
+ * Return prayer times for a given date in the local time of a zone
+ *
+ * Same as PT__getTimes with the UTC offset of the zone on the date
+ * (PTZ__dayOffset), which may be fractional.
+ *
+ * @param[in]   pt       PrayTimes instance
+ * @param[out]  results  Prayer times result
+ * @param[in]   year     Year
+ * @param[in]   month    Month
+ * @param[in]   day      Day
+ * @param[in]   lat      Latitude
+ * @param[in]   lng      Longitude
+ * @param[in]   elv      Elevation
+ * @param[in]   ptz      Time zone instance
+ **/
+void
+PT__getTimesZone(const PT pt,
+                 PT_PrayerTimes_t results,
+                 const int year,
+                 const int month,
+                 const int day,
+                 const double lat,
+                 const double lng,
+                 const double elv,
+                 const PTZ ptz);
+
+/**
+ * Return prayer times of consecutive days in the local time of a zone
+ *
+ * Same as PT__getTimesRange, each day with the UTC offset of the zone on that
+ * day: ranges may span daylight saving changes.
+ *
+ * @param[in]   pt       PrayTimes instance
+ * @param[out]  results  Prayer times result, one per day
+ * @param[in]   year     Year of the first day
+ * @param[in]   month    Month of the first day
+ * @param[in]   day      First day
+ * @param[in]   n        Number of days
+ * @param[in]   lat      Latitude
+ * @param[in]   lng      Longitude
+ * @param[in]   elv      Elevation
+ * @param[in]   ptz      Time zone instance
+ **/
+void
+PT__getTimesRangeZone(const PT pt,
+                      PT_PrayerTimes_t* results,
+                      const int year,
+                      const int month,
+                      const int day,
+                      const int n,
+                      const double lat,
+                      const double lng,
+                      const double elv,
+                      const PTZ ptz);
+
+/**
+ * Return prayer times of many locations for a given date in the local time
+ * of their zones
+ *
+ * Same as PT__getTimesBatch, each location with the UTC offset of its zone on
+ * the date.
+ *
+ * @param[in]   pt       PrayTimes instance
+ * @param[out]  results  Prayer times result, n values per time name
+ * @param[in]   year     Year
+ * @param[in]   month    Month
+ * @param[in]   day      Day
+ * @param[in]   lat      Latitudes
+ * @param[in]   lng      Longitudes
+ * @param[in]   elv      Elevations
+ * @param[in]   ptz      Time zone instances
+ * @param[in]   n        Number of locations
+ **/
+void
+PT__getTimesBatchZone(const PT pt,
+                      PT_PrayerTimesBatch_t results,
+                      const int year,
+                      const int month,
+                      const int day,
+                      const double* lat,
+                      const double* lng,
+                      const double* elv,
+                      const PTZ* ptz,
+                      const size_t n);
+
+#endif
@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columns.h"
+#include <praytimes_math.h>
+
+#define COLUMNS_MAGIC "PTCOLMN"
+#define COLUMNS_VERSION 1
+
+struct columns_t
+{
+  void* map;
+  size_t size;
+  size_t valueSize;
+};
+
+/**
+ * Whether the host is little-endian
+ *
+ * @return
+ **/
+static int
+littleEndian(void)
+{
+  const uint16_t probe = 1;
+  return *(const uint8_t*)&probe == 1;
+}
+
+/**
+ * Reverse the bytes of every value, converting between host & little-endian
+ * byte order on big-endian hosts
+ *
+ * @param[in,out]  data  Values
+ * @param[in]      size  Size of a value
+ * @param[in]      n     Number of values
+ **/
+static void
+swapBytes(void* data, const size_t size, const size_t n)
+{
+  uint8_t* bytes = data;
+  for (size_t i = 0; i < n; i++, bytes += size)
+    for (size_t j = 0; j < size / 2; j++) {
+      uint8_t byte = bytes[j];
+      bytes[j] = bytes[size - 1 - j];
+      bytes[size - 1 - j] = byte;
+    }
+}
+
+/**
+ * Size of a value of a unit
+ *
+ * @param[in]  unit
+ * @return
+ **/
+static size_t
+valueSize(const ColumnsUnit unit)
+{
+  return unit == COLUMNS_MINUTES ? sizeof(int16_t) : sizeof(float);
+}
+
+int
+columnsWrite(const char* path,
+             const PT pt,
+             const ColumnsUnit unit,
+             const int year,
+             const int month,
+             const int day,
+             const int days,
+             const double lat,
+             const double lng,
+             const double elv,
+             const int tmz,
+             const int dst)
+{
+  if (days < 1 || (unit != COLUMNS_MINUTES && unit != COLUMNS_HOURS))
+    return -1;
+
+  PT_Parameters_t parameters = PT__getParameters(pt);
+  ColumnsHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+  header.version = COLUMNS_VERSION;
+  header.unit = unit;
+  header.columns = PT_TN_MIDNIGHT + 1;
+  header.days = days;
+  header.year = year;
+  header.month = month;
+  header.day = day;
+  header.method = parameters.method;
+  header.timezone = tmz;
+  header.dst = dst;
+  header.asr = parameters.asr;
+  header.midnight = parameters.midnight;
+  header.highlats = parameters.highlats;
+  header.lat = lat;
+  header.lng = lng;
+  header.elv = elv;
+  header.imsak = parameters.imsak;
+  header.fajr = parameters.fajr;
+  header.dhuhr = parameters.dhuhr;
+  header.maghrib = parameters.maghrib;
+  header.isha = parameters.isha;
+  memcpy(header.offsets, parameters.offsets, sizeof(header.offsets));
+
+  PT_PrayerTimes_t* times = malloc(days * sizeof(PT_PrayerTimes_t));
+  void* column = malloc(days * valueSize(unit));
+  FILE* file = fopen(path, "wb");
+  int failed = times == NULL || column == NULL || file == NULL;
+  if (!failed) {
+    PT__getTimesRange(
+      pt, times, year, month, day, days, lat, lng, elv, tmz, dst);
+
+    /* the integers then the doubles of the header */
+    if (!littleEndian()) {
+      swapBytes((uint8_t*)&header + 8, sizeof(uint32_t), 14);
+      swapBytes(&header.lat, sizeof(double), 17);
+    }
+    failed = fwrite(&header, sizeof(header), 1, file) != 1;
+  }
+
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT && !failed; i++) {
+    for (int d = 0; d < days; d++) {
+      double time = times[d][i];
+      if (unit == COLUMNS_HOURS) {
+        /* in [0, 24) like the minutes, wrapping a float rounded up to 24 */
+        const float t = fabs(time) < 1e6 ? PTM__fixHour(time) : NAN;
+        ((float*)column)[d] = t == 24.0f ? 0.0f : t;
+      } else if (!(fabs(time) < 1e6))
+        ((int16_t*)column)[d] = -1;
+      else {
+        /* like PT__formatTimeTo */
+        const double t = PTM__fixHour(time + (1 / 180.0f));
+        const int hours = (int)floor(t);
+        ((int16_t*)column)[d] = hours * 60 + (int)floor((t - hours) * 60);
+      }
+    }
+    if (!littleEndian())
+      swapBytes(column, valueSize(unit), days);
+    failed = fwrite(column, valueSize(unit), days, file) != (size_t)days;
+  }
+
+  free(column);
+  free(times);
+  if (file && fclose(file) != 0)
+    failed = 1;
+  return failed ? -1 : 0;
+}
+
+Columns
+columnsOpen(const char* path)
+{
+  if (!littleEndian())
+    return NULL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ColumnsHeader)) {
+    close(fd);
+    return NULL;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const ColumnsHeader* header = map;
+  size_t size = header->unit == COLUMNS_MINUTES ? sizeof(int16_t)
+                : header->unit == COLUMNS_HOURS ? sizeof(float)
+                                                : 0;
+  if (memcmp(header->magic, COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC)) != 0 ||
+      header->version != COLUMNS_VERSION || size == 0 ||
+      header->columns != PT_TN_MIDNIGHT + 1 ||
+      (size_t)header->days * header->columns * size >
+        (size_t)st.st_size - sizeof(ColumnsHeader)) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  Columns columns = malloc(sizeof(struct columns_t));
+  if (columns == NULL) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  columns->map = map;
+  columns->size = st.st_size;
+  columns->valueSize = size;
+  return columns;
+}
+
+const ColumnsHeader*
+columnsHeader(const Columns columns)
+{
+  return columns->map;
+}
+
+const void*
+columnsColumn(const Columns columns, const PT_TimeName_t name)
+{
+  const ColumnsHeader* header = columns->map;
+  return (const uint8_t*)(header + 1) +
+         (size_t)name * header->days * columns->valueSize;
+}
+
+void
+columnsClose(Columns* columns)
+{
+  if (*columns != NULL)
+    munmap((*columns)->map, (*columns)->size);
+  free(*columns);
+  *columns = NULL;
+}
@@ -0,0 +1,125 @@
+#ifndef __COLUMNS_H
+#define __COLUMNS_H
+
+#include <stdint.h>
+
+#include <praytimes.h>
+
+/**
+ * Column units
+ **/
+typedef enum columns_unit_t
+{
+  COLUMNS_MINUTES, /* int16 minute of day as formatted in "24h", -1 for none */
+  COLUMNS_HOURS,   /* float32 hour of day in [0, 24), NaN for none */
+} ColumnsUnit;
+
+/**
+ * Columnar timetable file header, little-endian.
+ *
+ * The header is followed by one column per time name, in PT_TimeName_t
+ * order, of days values each.
+ **/
+typedef struct columns_header_t
+{
+  char magic[8]; /* "PTCOLMN" */
+  uint32_t version;
+  uint32_t unit; /* ColumnsUnit */
+  uint32_t columns;
+  uint32_t days;
+  int32_t year; /* first day */
+  int32_t month;
+  int32_t day;
+  int32_t method; /* PT_Method_t */
+  int32_t timezone;
+  int32_t dst;
+  int32_t asr;      /* PT_AsrJuristic_t */
+  int32_t midnight; /* PT_MidnightMethod_t */
+  int32_t highlats; /* PT_HighLatMethod_t */
+  int32_t reserved;
+  double lat;
+  double lng;
+  double elv;
+  double imsak;
+  double fajr;
+  double dhuhr;
+  double maghrib;
+  double isha;
+  double offsets[PT_TN_MIDNIGHT + 1]; /* in minutes */
+} ColumnsHeader;
+
+/**
+ * Mapped columnar timetable file data type.
+ **/
+typedef struct columns_t* Columns;
+
+/**
+ * Write prayer times of consecutive days of a location to a columnar file
+ *
+ * @param[in]  path  File path
+ * @param[in]  pt    PrayTimes instance
+ * @param[in]  unit  Column unit
+ * @param[in]  year  Year of the first day
+ * @param[in]  month Month of the first day
+ * @param[in]  day   First day
+ * @param[in]  days  Number of days
+ * @param[in]  lat   Latitude
+ * @param[in]  lng   Longitude
+ * @param[in]  elv   Elevation
+ * @param[in]  tmz   Timezone
+ * @param[in]  dst   Daylight saving time
+ * @return           0 on success, -1 on failure
+ **/
+int
+columnsWrite(const char* path,
+             const PT pt,
+             const ColumnsUnit unit,
+             const int year,
+             const int month,
+             const int day,
+             const int days,
+             const double lat,
+             const double lng,
+             const double elv,
+             const int tmz,
+             const int dst);
+
+/**
+ * Map a columnar file, on little-endian hosts only: the columns are read in
+ * place, without copy nor conversion
+ *
+ * @param[in]  path  File path
+ * @return           Mapped file, NULL on failure
+ **/
+Columns
+columnsOpen(const char* path);
+
+/**
+ * Get the header of a mapped columnar file
+ *
+ * @param[in]  columns  Mapped file
+ * @return              Header
+ **/
+const ColumnsHeader*
+columnsHeader(const Columns columns);
+
+/**
+ * Get a column of a mapped columnar file
+ *
+ * @param[in]  columns  Mapped file
+ * @param[in]  name     Time name
+ * @return              Column, of const int16_t or const float values
+ *                      depending on the unit
+ **/
+const void*
+columnsColumn(const Columns columns, const PT_TimeName_t name);
+
+/**
+ * Unmap a columnar file
+ *
+ * @param[out]  columns  Mapped file
+ **/
+void
+columnsClose(Columns* columns);
+
+#endif
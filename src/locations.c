@@ -0,0 +1,275 @@
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "locations.h"
+
+#define LOCATIONS_RECORD_SIZE 32
+#define LOCATIONS_RELEASE (16 << 20)
+#define LOCATIONS_NUMBER_SIZE 64
+
+struct locations_t
+{
+  const char* map;
+  size_t size;
+  size_t pos;
+  size_t released;
+  size_t page;
+  long line;
+  int binary;
+};
+
+/**
+ * Exact powers of ten
+ **/
+static const double powers[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/**
+ * Parse a decimal number in place, without terminating NUL
+ *
+ * Numbers of up to 15 significant digits & 22 decimals are computed with a
+ * single rounding, exactly like strtod, which parses the longer ones.
+ *
+ * @param[in,out]  p      Position, moved after the number
+ * @param[in]      end    End of the input
+ * @param[out]     value  Number
+ * @return                0 on success, -1 when there is no number
+ **/
+static int
+parseNumber(const char** p, const char* end, double* value)
+{
+  const char* s = *p;
+  int negative = 0, digits = 0, any = 0, scale = 0;
+  uint64_t mantissa = 0;
+
+  if (s < end && (*s == '-' || *s == '+'))
+    negative = *s++ == '-';
+  for (; s < end && *s >= '0' && *s <= '9'; s++, any = 1)
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*s - '0');
+      digits += mantissa != 0;
+    } else
+      scale++;
+  if (s < end && *s == '.')
+    for (s++; s < end && *s >= '0' && *s <= '9'; s++, any = 1)
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*s - '0');
+        digits += mantissa != 0;
+        scale--;
+      }
+  if (!any)
+    return -1;
+  if (s < end && (*s == 'e' || *s == 'E')) {
+    const char* e = s + 1;
+    int sign = 1, exponent = 0, expDigits = 0;
+    if (e < end && (*e == '-' || *e == '+'))
+      sign = *e++ == '-' ? -1 : 1;
+    for (; e < end && *e >= '0' && *e <= '9' && expDigits < 4; e++)
+      exponent = exponent * 10 + (*e - '0'), expDigits++;
+    if (expDigits) {
+      scale += sign * exponent;
+      s = e;
+    }
+  }
+
+  double v;
+  if (digits <= 15 && scale >= -22 && scale <= 22)
+    v = scale < 0 ? mantissa / powers[-scale] : mantissa * powers[scale];
+  else {
+    char buffer[LOCATIONS_NUMBER_SIZE];
+    if (s - *p >= LOCATIONS_NUMBER_SIZE)
+      return -1;
+    memcpy(buffer, *p, s - *p);
+    buffer[s - *p] = '\0';
+    v = strtod(buffer, NULL);
+    negative = 0;
+  }
+  *value = negative ? -v : v;
+  *p = s;
+  return 0;
+}
+
+/**
+ * Release the pages of the mapping before the current position
+ *
+ * @param[in,out]  locations
+ **/
+static void
+release(Locations locations)
+{
+  if (locations->pos - locations->released < LOCATIONS_RELEASE)
+    return;
+  size_t end = locations->pos / locations->page * locations->page;
+  madvise((void*)(locations->map + locations->released),
+          end - locations->released,
+          MADV_DONTNEED);
+  locations->released = end;
+}
+
+/**
+ * Read next binary record
+ *
+ * @param[in,out]  locations
+ * @param[out]     location
+ * @return
+ **/
+static int
+nextRecord(Locations locations, Location* location)
+{
+  if (locations->size - locations->pos < LOCATIONS_RECORD_SIZE)
+    return 0;
+  const uint8_t* record = (const uint8_t*)locations->map + locations->pos;
+  uint64_t bits[3];
+  uint32_t ints[2];
+  double values[3];
+  for (int i = 0; i < 3; i++) {
+    bits[i] = 0;
+    for (int j = 7; j >= 0; j--)
+      bits[i] = bits[i] << 8 | record[i * 8 + j];
+    memcpy(&values[i], &bits[i], sizeof(double));
+  }
+  for (int i = 0; i < 2; i++) {
+    ints[i] = 0;
+    for (int j = 3; j >= 0; j--)
+      ints[i] = ints[i] << 8 | record[24 + i * 4 + j];
+  }
+  location->lat = values[0];
+  location->lng = values[1];
+  location->elv = values[2];
+  location->tmz = (int32_t)ints[0];
+  location->dst = (int32_t)ints[1];
+  locations->pos += LOCATIONS_RECORD_SIZE;
+  locations->line++;
+  return 1;
+}
+
+/**
+ * Read next CSV line
+ *
+ * @param[in,out]  locations
+ * @param[out]     location
+ * @return
+ **/
+static int
+nextLine(Locations locations, Location* location)
+{
+  const char* end = locations->map + locations->size;
+  while (locations->pos < locations->size) {
+    const char* p = locations->map + locations->pos;
+    const char* eol = memchr(p, '\n', end - p);
+    if (eol == NULL)
+      eol = end;
+    locations->pos = eol - locations->map + (eol < end);
+    locations->line++;
+
+    while (p < eol && (*p == ' ' || *p == '\t'))
+      p++;
+    if (p == eol || *p == '#' || *p == '\r' ||
+        (locations->line == 1 &&
+         ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))))
+      continue;
+
+    double values[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    int n = 0;
+    for (; n < 5 && p < eol && *p != '\r'; n++) {
+      if (parseNumber(&p, eol, &values[n]) != 0)
+        return -1;
+      while (p < eol && (*p == ' ' || *p == '\t'))
+        p++;
+      if (p < eol && (*p == ',' || *p == ';'))
+        p++;
+      while (p < eol && (*p == ' ' || *p == '\t'))
+        p++;
+    }
+    if (n < 2 || (p < eol && *p != '\r'))
+      return -1;
+    /* whole hours, like the binary records */
+    for (int i = 3; i < 5; i++)
+      if (!(values[i] >= -24 && values[i] <= 24) ||
+          values[i] != (int)values[i])
+        return -1;
+    location->lat = values[0];
+    location->lng = values[1];
+    location->elv = values[2];
+    location->tmz = (int)values[3];
+    location->dst = (int)values[4];
+    return 1;
+  }
+  return 0;
+}
+
+Locations
+locationsOpen(const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return NULL;
+  }
+  void* map = NULL;
+  if (st.st_size > 0) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      return NULL;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  Locations locations = malloc(sizeof(struct locations_t));
+  if (locations == NULL) {
+    if (map)
+      munmap(map, st.st_size);
+    return NULL;
+  }
+  locations->map = map;
+  locations->size = st.st_size;
+  locations->pos = 0;
+  locations->released = 0;
+  locations->page = sysconf(_SC_PAGESIZE);
+  locations->line = 0;
+  locations->binary =
+    locations->size >= sizeof(LOCATIONS_MAGIC) &&
+    memcmp(map, LOCATIONS_MAGIC, sizeof(LOCATIONS_MAGIC)) == 0;
+  if (locations->binary)
+    locations->pos = sizeof(LOCATIONS_MAGIC);
+  return locations;
+}
+
+int
+locationsNext(Locations locations, Location* location)
+{
+  int read = locations->binary ? nextRecord(locations, location)
+                               : nextLine(locations, location);
+  release(locations);
+  return read;
+}
+
+long
+locationsLine(const Locations locations)
+{
+  return locations->line;
+}
+
+void
+locationsClose(Locations* locations)
+{
+  if (*locations != NULL && (*locations)->map != NULL)
+    munmap((void*)(*locations)->map, (*locations)->size);
+  free(*locations);
+  *locations = NULL;
+}
@@ -0,0 +1,77 @@
+#ifndef __LOCATIONS_H
+#define __LOCATIONS_H
+
+/**
+ * Location struct data type.
+ **/
+typedef struct location_t
+{
+  double lat;
+  double lng;
+  double elv;
+  int tmz;
+  int dst;
+} Location;
+
+/**
+ * Memory-mapped location file reader data type.
+ *
+ * Two formats are read:
+ *
+ * - CSV, one location per line: lat,lng[,elevation[,timezone[,dst]]], the
+ *   timezone & dst being whole hours within 24 hours (a fractional one is a
+ *   malformed location).
+ *   Fields may be separated by commas, semicolons, tabs or spaces; empty
+ *   lines, lines starting with '#' and a first line starting with a letter
+ *   (column names) are skipped.
+ * - Binary, starting with the magic "PTLOCAT" then little-endian records of
+ *   double lat, lng & elevation and int32 timezone & dst (32 bytes).
+ *
+ * Locations are parsed in place from the mapping, which is released behind
+ * the reader so that the memory used stays bounded whatever the file size.
+ **/
+typedef struct locations_t* Locations;
+
+/**
+ * Binary location file magic
+ **/
+#define LOCATIONS_MAGIC "PTLOCAT"
+
+/**
+ * Open location file
+ *
+ * @param[in]  path  File path
+ * @return           Reader, NULL on failure
+ **/
+Locations
+locationsOpen(const char* path);
+
+/**
+ * Read next location
+ *
+ * @param[in,out]  locations  Reader
+ * @param[out]     location   Location
+ * @return                    1 when read, 0 at the end of the file, -1 on a
+ *                            malformed location
+ **/
+int
+locationsNext(Locations locations, Location* location);
+
+/**
+ * Get the line (CSV) or record (binary) number of the last location read
+ *
+ * @param[in]  locations  Reader
+ * @return                Line or record number, from 1
+ **/
+long
+locationsLine(const Locations locations);
+
+/**
+ * Close location file
+ *
+ * @param[out]  locations  Reader
+ **/
+void
+locationsClose(Locations* locations);
+
+#endif
@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "pool.h"
+
+/**
+ * Pool task struct data type.
+ **/
+typedef struct pool_task_t
+{
+  PoolTask_t task;
+  void* arg;
+} PoolTask;
+
+/**
+ * Per-worker task deque (ring buffer) struct data type.
+ **/
+typedef struct pool_deque_t
+{
+  pthread_mutex_t lock;
+  PoolTask* tasks;
+  int capacity;
+  int head;
+  int size;
+} PoolDeque;
+
+/**
+ * Real thread pool struct data type.
+ **/
+struct pool_t
+{
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t idle;
+  int queued;
+  int pending;
+  int stopping;
+  int threads;
+  int started;
+  unsigned int next;
+  PoolDeque* deques;
+  pthread_t* workers;
+};
+
+/**
+ * Worker thread argument struct data type.
+ **/
+typedef struct pool_worker_t
+{
+  Pool pool;
+  int id;
+} PoolWorker;
+
+/**
+ * Push task to the back of the deque
+ *
+ * @param[out]  deque
+ * @param[in]   task
+ * @return           0 on success, -1 when out of memory
+ **/
+static int
+dequePushBack(PoolDeque* deque, const PoolTask task)
+{
+  pthread_mutex_lock(&deque->lock);
+  if (deque->size == deque->capacity) {
+    int capacity = deque->capacity ? deque->capacity * 2 : 16;
+    PoolTask* tasks = malloc(capacity * sizeof(PoolTask));
+    if (tasks == NULL) {
+      pthread_mutex_unlock(&deque->lock);
+      return -1;
+    }
+    for (int i = 0; i < deque->size; i++)
+      tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+    free(deque->tasks);
+    deque->tasks = tasks;
+    deque->capacity = capacity;
+    deque->head = 0;
+  }
+  deque->tasks[(deque->head + deque->size) % deque->capacity] = task;
+  deque->size++;
+  pthread_mutex_unlock(&deque->lock);
+  return 0;
+}
+
+/**
+ * Pop task from the back (owner side) or the front (thief side) of the deque
+ *
+ * @param[out]  deque
+ * @param[out]  task
+ * @param[in]   back
+ * @return           1 if a task was popped, 0 if the deque is empty
+ **/
+static int
+dequePop(PoolDeque* deque, PoolTask* task, const int back)
+{
+  int popped = 0;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->size > 0) {
+    if (back)
+      *task = deque->tasks[(deque->head + deque->size - 1) % deque->capacity];
+    else {
+      *task = deque->tasks[deque->head];
+      deque->head = (deque->head + 1) % deque->capacity;
+    }
+    deque->size--;
+    popped = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return popped;
+}
+
+/**
+ * Worker thread main loop
+ *
+ * @param[in]  arg  Worker thread argument
+ * @return
+ **/
+static void*
+poolWork(void* arg)
+{
+  PoolWorker* worker = arg;
+  Pool pool = worker->pool;
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->queued == 0 && !pool->stopping)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->queued == 0) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    /* reserve a task, it is then guaranteed to be found in some deque */
+    pool->queued--;
+    pthread_mutex_unlock(&pool->lock);
+
+    PoolTask task;
+    int found = dequePop(&pool->deques[worker->id], &task, 1);
+    for (int i = 1; !found; i = i % pool->threads + 1)
+      found = dequePop(
+        &pool->deques[(worker->id + i) % pool->threads], &task, 0);
+    task.task(task.arg);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0)
+      pthread_cond_broadcast(&pool->idle);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  free(worker);
+  return NULL;
+}
+
+Pool
+poolNew(const int threads)
+{
+  if (threads < 1)
+    return NULL;
+
+  Pool pool = calloc(1, sizeof(struct pool_t));
+  if (pool == NULL)
+    return NULL;
+  pool->deques = calloc(threads, sizeof(PoolDeque));
+  pool->workers = calloc(threads, sizeof(pthread_t));
+  if (pool->deques == NULL || pool->workers == NULL) {
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  pool->threads = threads;
+  for (int i = 0; i < threads; i++)
+    pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+  for (int i = 0; i < threads; i++) {
+    PoolWorker* worker = malloc(sizeof(PoolWorker));
+    if (worker == NULL)
+      break;
+    worker->pool = pool;
+    worker->id = i;
+    if (pthread_create(&pool->workers[i], NULL, poolWork, worker) != 0) {
+      free(worker);
+      break;
+    }
+    pool->started++;
+  }
+  if (pool->started == 0) {
+    poolFree(&pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+int
+poolSubmit(Pool pool, PoolTask_t task, void* arg)
+{
+  PoolTask _task = { task, arg };
+  pthread_mutex_lock(&pool->lock);
+  int id = pool->next++ % pool->threads;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (dequePushBack(&pool->deques[id], _task) != 0)
+    return -1;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->queued++;
+  pool->pending++;
+  pthread_cond_signal(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+void
+poolFree(Pool* pool)
+{
+  Pool _pool = *pool;
+  pthread_mutex_lock(&_pool->lock);
+  while (_pool->pending > 0)
+    pthread_cond_wait(&_pool->idle, &_pool->lock);
+  _pool->stopping = 1;
+  pthread_cond_broadcast(&_pool->wake);
+  pthread_mutex_unlock(&_pool->lock);
+
+  for (int i = 0; i < _pool->started; i++)
+    pthread_join(_pool->workers[i], NULL);
+  for (int i = 0; i < _pool->threads; i++) {
+    pthread_mutex_destroy(&_pool->deques[i].lock);
+    free(_pool->deques[i].tasks);
+  }
+  pthread_cond_destroy(&_pool->idle);
+  pthread_cond_destroy(&_pool->wake);
+  pthread_mutex_destroy(&_pool->lock);
+  free(_pool->deques);
+  free(_pool->workers);
+  free(_pool);
+  *pool = NULL;
+}
@@ -0,0 +1,49 @@
+#ifndef __POOL_H
+#define __POOL_H
+
+/**
+ * Work-stealing thread pool data type.
+ *
+ * Every worker owns a deque of tasks. Submitted tasks are spread over the
+ * deques round-robin, a worker runs tasks from the back of its own deque and,
+ * once it runs dry, steals from the front of the other workers' deques.
+ **/
+typedef struct pool_t* Pool;
+
+/**
+ * Task function
+ *
+ * @param[in]  arg  Task argument
+ **/
+typedef void (*PoolTask_t)(void* arg);
+
+/**
+ * Create new thread pool
+ *
+ * @param[in]  threads  Number of worker threads
+ * @return              Thread pool instance, NULL on failure
+ **/
+Pool
+poolNew(const int threads);
+
+/**
+ * Submit task to the thread pool
+ *
+ * @param[in]  pool  Thread pool instance
+ * @param[in]  task  Task function
+ * @param[in]  arg   Task argument
+ * @return           0 on success, -1 when out of memory (the task is not
+ *                   submitted)
+ **/
+int
+poolSubmit(Pool pool, PoolTask_t task, void* arg);
+
+/**
+ * Wait for all submitted tasks, stop the workers and free the thread pool
+ *
+ * @param[out]  pool  Thread pool instance
+ **/
+void
+poolFree(Pool* pool);
+
+#endif
@@ -1,17 +1,289 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <math.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "columns.h"
+#include "locations.h"
+#include "pool.h"
+#include "raster.h"
+#include "server.h"
 #include "utils.h"
 #include <praytimes.h>
+#include <praytimes_ephemeris.h>
+#include <praytimes_zone.h>
+
+#define DAYS_PER_UNIT 32
+#define UNITS_PER_THREAD 4
+#define ROW_SIZE 128
+
+/**
+ * Work unit (chunk of consecutive days of one location) struct data type.
+ **/
+typedef struct unit_t
+{
+  PT pt;
+  const PT_TimeFormatSpec_t* format;
+  PTZ zone;
+  Location location;
+  long record;
+  int year;
+  int month;
+  int day;
+  int n;
+  int detailed;
+  char* output;
+  size_t length;
+  int done;
+} Unit;
+
+static pthread_mutex_t unitLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t unitDone = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Length of a buffer after appending snprintf output, truncated to its
+ * capacity
+ *
+ * @param[in]  length    Length before
+ * @param[in]  written   snprintf result
+ * @param[in]  capacity  Buffer capacity
+ * @return               Length after
+ **/
+static size_t
+appended(const size_t length, const int written, const size_t capacity)
+{
+  if (written < 0)
+    return length;
+  return length + written < capacity ? length + written : capacity - 1;
+}
+
+/**
+ * Compute & format the prayer times of the work unit's days
+ *
+ * @param[in,out]  arg  Work unit
+ **/
+static void
+runUnit(void* arg)
+{
+  Unit* unit = arg;
+  const Location* loc = &unit->location;
+  int year = unit->year, month = unit->month, day = unit->day;
+  PT_PrayerTimes_t results[DAYS_PER_UNIT];
+  PT_FormattedTimes_t formatted;
+  const size_t capacity = unit->n * ROW_SIZE;
+  char* output = malloc(capacity);
+  size_t length = 0;
+
+  if (output == NULL) {
+    pthread_mutex_lock(&unitLock);
+    unit->output = NULL;
+    unit->length = 0;
+    unit->done = 1;
+    pthread_cond_broadcast(&unitDone);
+    pthread_mutex_unlock(&unitLock);
+    return;
+  }
+
+  if (unit->zone)
+    PT__getTimesRangeZone(unit->pt,
+                          results,
+                          year,
+                          month,
+                          day,
+                          unit->n,
+                          loc->lat,
+                          loc->lng,
+                          loc->elv,
+                          unit->zone);
+  else
+    PT__getTimesRange(unit->pt,
+                      results,
+                      year,
+                      month,
+                      day,
+                      unit->n,
+                      loc->lat,
+                      loc->lng,
+                      loc->elv,
+                      loc->tmz,
+                      loc->dst);
+  for (int i = 0; i < unit->n; i++) {
+    PT__formatTimesTo(unit->format, results[i], formatted);
+
+    int written = 0;
+    if (unit->record) {
+      written = snprintf(
+        output + length, capacity - length, "%-8ld ", unit->record);
+      length = appended(length, written, capacity);
+    }
+    if (unit->detailed)
+      written = snprintf(output + length,
+                         capacity - length,
+                         "%04d-%02d-%02d %s %s %s   %s %s %s  %s   %s %s\n",
+                         year,
+                         month,
+                         day,
+                         formatted[PT_TN_IMSAK],
+                         formatted[PT_TN_FAJR],
+                         formatted[PT_TN_SUNRISE],
+                         formatted[PT_TN_DHUHR],
+                         formatted[PT_TN_ASR],
+                         formatted[PT_TN_SUNSET],
+                         formatted[PT_TN_MAGHRIB],
+                         formatted[PT_TN_ISHA],
+                         formatted[PT_TN_MIDNIGHT]);
+    else
+      written = snprintf(output + length,
+                         capacity - length,
+                         "%04d-%02d-%02d %s %s %s %s %s   %s\n",
+                         year,
+                         month,
+                         day,
+                         formatted[PT_TN_IMSAK],
+                         formatted[PT_TN_FAJR],
+                         formatted[PT_TN_DHUHR],
+                         formatted[PT_TN_ASR],
+                         formatted[PT_TN_MAGHRIB],
+                         formatted[PT_TN_ISHA]);
+    length = appended(length, written, capacity);
+
+    dateInc(&year, &month, &day);
+  }
+
+  pthread_mutex_lock(&unitLock);
+  unit->output = output;
+  unit->length = length;
+  unit->done = 1;
+  pthread_cond_broadcast(&unitDone);
+  pthread_mutex_unlock(&unitLock);
+}
+
+/**
+ * Print the instrumentation statistics
+ **/
+static void
+printStats(void)
+{
+  static const char* stages[PT_STAGE_COUNT] = {
+    "compute", "highlats", "adjust", "midnight", "tune", "format",
+  };
+  PT_Stats_t stats;
+  if (PT__getStats(&stats) != 0) {
+    fprintf(stderr, "No statistics, build with CFLAG=-DPT_STATS\n");
+    return;
+  }
+  fprintf(stderr, "Stage          Calls            Ticks  Ticks/call\n");
+  for (int i = 0; i < PT_STAGE_COUNT; i++)
+    fprintf(stderr,
+            "%-8s %12lu %16llu %11.1f\n",
+            stages[i],
+            stats.calls[i],
+            stats.ticks[i],
+            stats.calls[i] ? (double)stats.ticks[i] / stats.calls[i] : 0.0);
+  fprintf(stderr,
+          "%lu higher latitudes fallbacks, %lu NaN hour angles\n",
+          stats.highLatFallbacks,
+          stats.nanHourAngles);
+}
+
+/**
+ * Print the prayers of the locations from a date (00:00 UTC) for some hours,
+ * in chronological order, in UTC
+ *
+ * @param[in]  pt
+ * @param[in]  locations  Location file, NULL for the single location
+ * @param[in]  location   Single location
+ * @param[in]  start      Days since 1970-01-01
+ * @param[in]  hours
+ * @return                0 on success, -1 on a malformed location, -2 when
+ *                        out of memory
+ **/
+static int
+printEvents(const PT pt,
+            Locations locations,
+            Location location,
+            const long start,
+            const int hours)
+{
+  static const char* names[PT_TN_MIDNIGHT + 1] = {
+    "Imsak", "Fajr",    "Sunrise", "Dhuhr",    "Asr",
+    "Sunset", "Maghrib", "Isha",    "Midnight",
+  };
+  PT_Location_t* ptLocations = NULL;
+  long* records = NULL;
+  size_t count = 0, capacity = 0;
+  int more = locations ? locationsNext(locations, &location) : 1;
+  for (; more > 0;
+       more = locations ? locationsNext(locations, &location) : 0) {
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      PT_Location_t* grownLocations =
+        realloc(ptLocations, capacity * sizeof(PT_Location_t));
+      if (grownLocations)
+        ptLocations = grownLocations;
+      long* grownRecords = realloc(records, capacity * sizeof(long));
+      if (grownRecords)
+        records = grownRecords;
+      if (grownLocations == NULL || grownRecords == NULL) {
+        more = -2;
+        break;
+      }
+    }
+    ptLocations[count] = PT__location(
+      location.lat, location.lng, location.elv, location.tmz, location.dst);
+    records[count++] = locations ? locationsLine(locations) : 0;
+  }
+
+  PT_Events events = NULL;
+  if (more != -2)
+    events = PT__events(pt,
+                        ptLocations,
+                        count,
+                        start * 86400.0,
+                        start * 86400.0 + hours * 3600.0);
+  if (events == NULL) {
+    free(ptLocations);
+    free(records);
+    return -2;
+  }
+  PT_Event_t event;
+  printf(locations ? "Date       Time  Location Prayer\n"
+                   : "Date       Time  Prayer\n");
+  while (PT__nextEvent(events, &event)) {
+    time_t minute = (time_t)floor(event.time / 60 + 0.5) * 60;
+    struct tm utc;
+    char date[ROW_SIZE];
+    gmtime_r(&minute, &utc);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M", &utc);
+    if (locations)
+      printf(
+        "%s %-8ld %s\n", date, records[event.location], names[event.name]);
+    else
+      printf("%s %s\n", date, names[event.name]);
+  }
+  PT__freeEvents(&events);
+  free(ptLocations);
+  free(records);
+  return more;
+}
 
 int
 main(int argc, char* argv[])
 {
   int year = 0, month = 1, day = 1, tmz = 0, dst = 0, n = 1;
-  int detailed = 0;
-  double lat = 0.0f, lng = 0.0f, elv = 0.0f;
+  int detailed = 0, years = 1, samples = 24, threads = 1, rows = 1, cols = 1;
+  int cache = 0, statistics = 0, events = 0, hours = 48;
+  double lat = 0.0f, lng = 0.0f, elv = 0.0f, step = 0.05f;
+  const char *ephemeris = NULL, *generate = NULL, *raster = NULL;
+  const char *serve = NULL, *columns = NULL, *locationsFile = NULL;
+  const char* zoneName = NULL;
+  ColumnsUnit unit = COLUMNS_MINUTES;
+  PT_Precision_t precision = PT_P_EXACT;
   for (int i = 0; i < argc; i++) {
     if (strncmp(argv[i], "--year=", 7) == 0)
       year = str2uint(argv[i], strlen(argv[i]));
@@ -33,12 +305,169 @@ main(int argc, char* argv[])
       n = str2uint(argv[i], strlen(argv[i]));
     if (strncmp(argv[i], "--detailed", 10) == 0)
       detailed = 1;
+    if (strncmp(argv[i], "--ephemeris=", 12) == 0)
+      ephemeris = argv[i] + 12;
+    if (strncmp(argv[i], "--generate-ephemeris=", 21) == 0)
+      generate = argv[i] + 21;
+    if (strncmp(argv[i], "--years=", 8) == 0)
+      years = str2uint(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--samples=", 10) == 0)
+      samples = str2uint(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--threads=", 10) == 0)
+      threads = str2uint(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--raster=", 9) == 0)
+      raster = argv[i] + 9;
+    if (strncmp(argv[i], "--rows=", 7) == 0)
+      rows = str2uint(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--cols=", 7) == 0)
+      cols = str2uint(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--step=", 7) == 0)
+      step = str2float(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--locations=", 12) == 0)
+      locationsFile = argv[i] + 12;
+    if (strncmp(argv[i], "--columns=", 10) == 0)
+      columns = argv[i] + 10;
+    if (strcmp(argv[i], "--unit=hours") == 0)
+      unit = COLUMNS_HOURS;
+    if (strncmp(argv[i], "--cache=", 8) == 0)
+      cache = str2uint(argv[i], strlen(argv[i]));
+    if (strncmp(argv[i], "--serve=", 8) == 0)
+      serve = argv[i] + 8;
+    if (strcmp(argv[i], "--stats") == 0)
+      statistics = 1;
+    if (strncmp(argv[i], "--zone=", 7) == 0)
+      zoneName = argv[i] + 7;
+    if (strcmp(argv[i], "--events") == 0)
+      events = 1;
+    if (strncmp(argv[i], "--hours=", 8) == 0)
+      hours = str2uint(argv[i], strlen(argv[i]));
+    if (strcmp(argv[i], "--precision=fast") == 0)
+      precision = PT_P_FAST;
+    if (strcmp(argv[i], "--precision=float") == 0)
+      precision = PT_P_FLOAT;
+  }
+
+  if (generate) {
+    if (PTE__generate(generate, year, year + years - 1, samples) == 0)
+      return 0;
+    fprintf(stderr, "Failed to generate ephemeris table: %s\n", generate);
+    return 1;
+  }
+
+  PTE pte = NULL;
+  if (ephemeris && (pte = PTE__load(ephemeris)) == NULL) {
+    fprintf(stderr, "Failed to load ephemeris table: %s\n", ephemeris);
+    return 1;
+  }
+
+  if (serve) {
+    Server server = serverNew(threads, pte, precision, cache);
+    int failed = server == NULL;
+    signal(SIGPIPE, SIG_IGN);
+    if (!failed && strcmp(serve, "-") == 0) {
+      ServerStats stats;
+      failed = serverServe(server, 0, 1) != 0;
+      serverStats(server, &stats);
+      fprintf(stderr,
+              "%ld requests, latency p50 %.1f us, p90 %.1f us, p99 %.1f us, "
+              "max %.1f us\n",
+              stats.count,
+              stats.p50,
+              stats.p90,
+              stats.p99,
+              stats.max);
+    } else if (!failed && serverListen(server, serve) != 0) {
+      fprintf(stderr, "Failed to listen: %s\n", serve);
+      failed = 1;
+    }
+    serverFree(&server);
+    if (statistics)
+      printStats();
+    PTE__free(&pte);
+    return failed ? 1 : 0;
   }
 
   PT pt = PT__new();
-  PT_PrayerTimes_t results;
   PT__setMethod(pt, PT_M_INDONESIA);
   PT__tune(pt, 2.0f);
+  PT__setEphemeris(pt, pte);
+  PT__setPrecision(pt, precision);
+  PT_TimeFormatSpec_t format = PT__compileFormat("24h");
+
+  if (raster) {
+    int failed = rasterWrite(raster,
+                             pt,
+                             year,
+                             month,
+                             day,
+                             n,
+                             lat,
+                             lng,
+                             rows,
+                             cols,
+                             step,
+                             elv,
+                             tmz,
+                             dst);
+    if (failed)
+      fprintf(stderr, "Failed to write raster: %s\n", raster);
+    if (statistics)
+      printStats();
+    PT__free(&pt);
+    PTE__free(&pte);
+    return failed ? 1 : 0;
+  }
+
+  if (columns) {
+    int failed = columnsWrite(
+      columns, pt, unit, year, month, day, n, lat, lng, elv, tmz, dst);
+    if (failed)
+      fprintf(stderr, "Failed to write columns: %s\n", columns);
+    if (statistics)
+      printStats();
+    PT__free(&pt);
+    PTE__free(&pte);
+    return failed ? 1 : 0;
+  }
+
+  Locations locations = NULL;
+  if (locationsFile && (locations = locationsOpen(locationsFile)) == NULL) {
+    fprintf(stderr, "Failed to open locations: %s\n", locationsFile);
+    PT__free(&pt);
+    PTE__free(&pte);
+    return 1;
+  }
+
+  Location location = { lat, lng, elv, tmz, dst };
+  if (events) {
+    int more = printEvents(
+      pt, locations, location, date2days(year, month, day), hours);
+    if (more == -2)
+      fprintf(stderr, "Out of memory\n");
+    else if (more < 0)
+      fprintf(stderr,
+              "Malformed location: %s:%ld\n",
+              locationsFile,
+              locationsLine(locations));
+    locationsClose(&locations);
+    if (statistics)
+      printStats();
+    PT__free(&pt);
+    PTE__free(&pte);
+    return more < 0 ? 1 : 0;
+  }
+
+  PTZ zone = NULL;
+  if (zoneName && (zone = PTZ__load(zoneName)) == NULL) {
+    fprintf(stderr, "Failed to load zone: %s\n", zoneName);
+    locationsClose(&locations);
+    PT__free(&pt);
+    PTE__free(&pte);
+    return 1;
+  }
+
+  if (locations)
+    printf("Location ");
   if (detailed)
     printf("Date       "
            "Imsak "
@@ -59,57 +488,80 @@ main(int argc, char* argv[])
            "Maghrib "
            "Isha\n");
 
-  for (int i = 0; i < n; i++) {
-    PT__getTimes(pt, results, year, month, day, lat, lng, elv, tmz, dst);
-    char* imsak = PT__formatTime(pt, results[PT_TN_IMSAK], NULL);
-    char* fajr = PT__formatTime(pt, results[PT_TN_FAJR], NULL);
-    char* sunrise = PT__formatTime(pt, results[PT_TN_SUNRISE], NULL);
-    char* dhuhr = PT__formatTime(pt, results[PT_TN_DHUHR], NULL);
-    char* asr = PT__formatTime(pt, results[PT_TN_ASR], NULL);
-    char* sunset = PT__formatTime(pt, results[PT_TN_SUNSET], NULL);
-    char* maghrib = PT__formatTime(pt, results[PT_TN_MAGHRIB], NULL);
-    char* isha = PT__formatTime(pt, results[PT_TN_ISHA], NULL);
-    char* midnight = PT__formatTime(pt, results[PT_TN_MIDNIGHT], NULL);
-
-    if (detailed)
-      printf("%04d-%02d-%02d %s %s %s   %s %s %s  %s   %s %s\n",
-             year,
-             month,
-             day,
-             imsak,
-             fajr,
-             sunrise,
-             dhuhr,
-             asr,
-             sunset,
-             maghrib,
-             isha,
-             midnight);
-    else
-      printf("%04d-%02d-%02d %s %s %s %s %s   %s\n",
-             year,
-             month,
-             day,
-             imsak,
-             fajr,
-             dhuhr,
-             asr,
-             maghrib,
-             isha);
-
-    free(imsak);
-    free(fajr);
-    free(sunrise);
-    free(dhuhr);
-    free(asr);
-    free(sunset);
-    free(maghrib);
-    free(isha);
-    free(midnight);
+  /* units are printed in submission order, which is the serial order; the
+   * locations are read as units are submitted, at most a window ahead */
+  int more = n < 1 ? 0 : locations ? locationsNext(locations, &location) : 1;
+  int unitsPerLocation = (n + DAYS_PER_UNIT - 1) / DAYS_PER_UNIT, index = 0;
+  Pool pool = threads > 1 ? poolNew(threads) : NULL;
+  int window = pool ? threads * UNITS_PER_THREAD : 1;
+  Unit* units = calloc(window, sizeof(Unit));
+  int outOfMemory = units == NULL;
+  if (outOfMemory)
+    more = 0;
+  int uYear = year, uMonth = month, uDay = day;
+  for (long submitted = 0, printed = 0;; printed++) {
+    for (; more > 0 && submitted - printed < window; submitted++) {
+      Unit* unit = &units[submitted % window];
+      if (index == 0) {
+        uYear = year;
+        uMonth = month;
+        uDay = day;
+      }
+      unit->pt = pt;
+      unit->format = &format;
+      unit->zone = zone;
+      unit->location = location;
+      unit->record = locations ? locationsLine(locations) : 0;
+      unit->year = uYear;
+      unit->month = uMonth;
+      unit->day = uDay;
+      unit->n = index == unitsPerLocation - 1
+                  ? n - index * DAYS_PER_UNIT
+                  : DAYS_PER_UNIT;
+      unit->detailed = detailed;
+      unit->done = 0;
+      for (int i = 0; i < unit->n; i++)
+        dateInc(&uYear, &uMonth, &uDay);
+      /* out of memory for the task, the unit runs on the main thread */
+      if (pool == NULL || poolSubmit(pool, runUnit, unit) != 0)
+        runUnit(unit);
+      if (++index == unitsPerLocation) {
+        index = 0;
+        more = locations ? locationsNext(locations, &location) : 0;
+      }
+    }
+    if (printed == submitted)
+      break;
 
-    dateInc(&year, &month, &day);
+    Unit* unit = &units[printed % window];
+    pthread_mutex_lock(&unitLock);
+    while (!unit->done)
+      pthread_cond_wait(&unitDone, &unitLock);
+    pthread_mutex_unlock(&unitLock);
+    if (unit->output == NULL) {
+      /* stop submitting, the submitted units still run */
+      outOfMemory = 1;
+      more = 0;
+    } else if (!outOfMemory)
+      fwrite(unit->output, 1, unit->length, stdout);
+    free(unit->output);
   }
+  if (pool)
+    poolFree(&pool);
+  free(units);
+  if (outOfMemory)
+    fprintf(stderr, "Out of memory\n");
+  else if (more < 0)
+    fprintf(stderr,
+            "Malformed location: %s:%ld\n",
+            locationsFile,
+            locationsLine(locations));
+  locationsClose(&locations);
+  if (statistics)
+    printStats();
 
+  PTZ__free(&zone);
   PT__free(&pt);
-  return 0;
+  PTE__free(&pte);
+  return more < 0 || outOfMemory ? 1 : 0;
 }
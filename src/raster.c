@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raster.h"
+#include "utils.h"
+
+#define RASTER_MAGIC "PTRASTR"
+#define RASTER_VERSION 1
+#define RASTER_BYTE_ORDER 0x01020304
+#define RASTER_BLOCK_CELLS 65536
+
+/**
+ * Raster file header.
+ **/
+typedef struct raster_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t rows;
+  uint32_t cols;
+  uint32_t bands;
+  uint32_t days;
+  int32_t year;
+  int32_t month;
+  int32_t day;
+  int32_t reserved;
+  double lat;
+  double lng;
+  double step;
+} RasterHeader;
+
+int
+rasterWrite(const char* path,
+            const PT pt,
+            const int year,
+            const int month,
+            const int day,
+            const int days,
+            const double lat,
+            const double lng,
+            const int rows,
+            const int cols,
+            const double step,
+            const double elv,
+            const int tmz,
+            const int dst)
+{
+  if (rows < 1 || cols < 1 || days < 1 || !(step > 0))
+    return -1;
+
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+    return -1;
+
+  RasterHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, RASTER_MAGIC, sizeof(RASTER_MAGIC));
+  header.version = RASTER_VERSION;
+  header.byteOrder = RASTER_BYTE_ORDER;
+  header.rows = rows;
+  header.cols = cols;
+  header.bands = PT_TN_MIDNIGHT + 1;
+  header.days = days;
+  header.year = year;
+  header.month = month;
+  header.day = day;
+  header.lat = lat;
+  header.lng = lng;
+  header.step = step;
+  int failed = fwrite(&header, sizeof(header), 1, file) != 1;
+
+  /* each day is computed by blocks of at most RASTER_BLOCK_CELLS cells (or a
+   * row), each band of a block being written at its place in the file */
+  size_t cells = (size_t)rows * cols;
+  size_t blockRows = RASTER_BLOCK_CELLS / cols ? RASTER_BLOCK_CELLS / cols : 1;
+  if (blockRows > (size_t)rows)
+    blockRows = rows;
+  size_t blockCells = blockRows * cols;
+  double* lats = malloc(rows * sizeof(double));
+  double* lngs = malloc(cols * sizeof(double));
+  double* times = malloc((PT_TN_MIDNIGHT + 1) * blockCells * sizeof(double));
+  float* band = malloc(blockCells * sizeof(float));
+  if (lats == NULL || lngs == NULL || times == NULL || band == NULL)
+    failed = 1;
+  PT_PrayerTimesBatch_t results;
+  for (int r = 0; r < rows && !failed; r++)
+    lats[r] = lat - r * step;
+  for (int c = 0; c < cols && !failed; c++)
+    lngs[c] = lng + c * step;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT && !failed; i++)
+    results[i] = times + i * blockCells;
+
+  int _year = year, _month = month, _day = day;
+  for (int d = 0; d < days && !failed; d++) {
+    for (size_t r = 0; r < (size_t)rows && !failed; r += blockRows) {
+      size_t n = (size_t)rows - r < blockRows ? (size_t)rows - r : blockRows;
+      PT__getTimesGrid(pt,
+                       results,
+                       _year,
+                       _month,
+                       _day,
+                       lats + r,
+                       n,
+                       lngs,
+                       cols,
+                       elv,
+                       tmz,
+                       dst);
+      for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT && !failed; i++) {
+        size_t index = ((size_t)d * header.bands + i) * cells + r * cols;
+        long offset = sizeof(header) + index * sizeof(float);
+        for (size_t k = 0; k < n * cols; k++)
+          band[k] = results[i][k];
+        failed = fseek(file, offset, SEEK_SET) != 0 ||
+                 fwrite(band, sizeof(float), n * cols, file) != n * cols;
+      }
+    }
+    dateInc(&_year, &_month, &_day);
+  }
+
+  free(band);
+  free(times);
+  free(lngs);
+  free(lats);
+  if (fclose(file) != 0)
+    failed = 1;
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,48 @@
+#ifndef __RASTER_H
+#define __RASTER_H
+
+#include <praytimes.h>
+
+/**
+ * Write prayer times of a latitude/longitude grid to a binary raster file
+ *
+ * The file starts with a header (magic "PTRASTR", version, byte order marker
+ * 0x01020304, rows, cols, bands, days, first date, north-west corner & step,
+ * in native byte order), followed for each day by one band per time name of
+ * rows * cols native float32 hours, row-major, north to south and west to
+ * east. NaN marks times that do not occur.
+ *
+ * @param[in]  path      File path
+ * @param[in]  pt        PrayTimes instance
+ * @param[in]  year      Year of the first day
+ * @param[in]  month     Month of the first day
+ * @param[in]  day       First day
+ * @param[in]  days      Number of days
+ * @param[in]  lat       Latitude of the north-west corner
+ * @param[in]  lng       Longitude of the north-west corner
+ * @param[in]  rows      Number of rows
+ * @param[in]  cols      Number of columns
+ * @param[in]  step      Grid step (in degrees)
+ * @param[in]  elv       Elevation
+ * @param[in]  tmz       Timezone
+ * @param[in]  dst       Daylight saving time
+ * @return               0 on success, -1 on failure (including when out of
+ *                       memory)
+ **/
+int
+rasterWrite(const char* path,
+            const PT pt,
+            const int year,
+            const int month,
+            const int day,
+            const int days,
+            const double lat,
+            const double lng,
+            const int rows,
+            const int cols,
+            const double step,
+            const double elv,
+            const int tmz,
+            const int dst);
+
+#endif
@@ -0,0 +1,516 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "server.h"
+
+#define SERVER_WINDOW 256
+#define SERVER_LINE_SIZE 256
+#define SERVER_RESPONSE_SIZE 128
+#define SERVER_READ_SIZE 65536
+#define SERVER_SAMPLES 65536
+#define SERVER_BACKLOG 16
+#define SERVER_CACHE_LAT 0.005 /* degrees, about 500 m */
+#define SERVER_CACHE_ELV 1.0   /* metres */
+
+/**
+ * Method names, in PT_Method_t order.
+ **/
+static const char* methodNames[] = {
+  "MWL", "ISNA", "EGYPT", "MAKKAH", "KARACHI", "TEHRAN", "JAFARI", "INDONESIA",
+};
+
+#define SERVER_METHODS (sizeof(methodNames) / sizeof(methodNames[0]))
+
+struct server_t
+{
+  PT pts[SERVER_METHODS];
+  PT_TimeFormatSpec_t format;
+  Pool pool;
+  pthread_mutex_t lock;
+  double samples[SERVER_SAMPLES]; /* ring of recent latencies (in seconds) */
+  long count;
+};
+
+typedef struct connection_t Connection;
+
+/**
+ * Pipelined request slot struct data type.
+ **/
+typedef struct request_t
+{
+  Connection* connection;
+  char line[SERVER_LINE_SIZE];
+  char response[SERVER_RESPONSE_SIZE];
+  size_t length;
+  double start;
+  int done;
+} Request;
+
+/**
+ * Connection struct data type: a window of requests, read & submitted by the
+ * serving thread, written back in order by the writer thread.
+ **/
+struct connection_t
+{
+  Server server;
+  int out;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  Request slots[SERVER_WINDOW];
+  long submitted;
+  long written;
+  int eof;
+  int failed;
+};
+
+/**
+ * Monotonic clock
+ *
+ * @return  Seconds
+ **/
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Compare doubles, for qsort
+ **/
+static int
+compareDoubles(const void* a, const void* b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Parse & answer one request line
+ *
+ * @param[in]   server    Server instance
+ * @param[in]   line      Request line, NUL terminated
+ * @param[out]  response  Response line buffer (SERVER_RESPONSE_SIZE)
+ * @return                Length of response
+ **/
+static size_t
+answer(Server server, const char* line, char* response)
+{
+  char method[16], *end;
+  int length, year, month, day;
+
+  if (strcmp(line, "stats") == 0) {
+    ServerStats stats;
+    serverStats(server, &stats);
+    return snprintf(response,
+                    SERVER_RESPONSE_SIZE,
+                    "stats %ld %.1f %.1f %.1f %.1f\n",
+                    stats.count,
+                    stats.p50,
+                    stats.p90,
+                    stats.p99,
+                    stats.max);
+  }
+
+  if (sscanf(line, "%15s %d-%d-%d%n", method, &year, &month, &day, &length) !=
+      4)
+    return snprintf(response, SERVER_RESPONSE_SIZE, "error malformed\n");
+
+  size_t m = 0;
+  while (m < SERVER_METHODS && strcmp(method, methodNames[m]) != 0)
+    m++;
+  if (m == SERVER_METHODS)
+    return snprintf(response, SERVER_RESPONSE_SIZE, "error unknown method\n");
+  if (month < 1 || month > 12 || day < 1 || day > 31)
+    return snprintf(response, SERVER_RESPONSE_SIZE, "error invalid date\n");
+
+  /* lat & long are required, elevation, timezone & dst optional */
+  double values[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+  const char* p = line + length;
+  int parsed = 0;
+  for (; parsed < 5; parsed++) {
+    values[parsed] = strtod(p, &end);
+    if (end == p || !isfinite(values[parsed]))
+      break;
+    p = end;
+  }
+  while (*p == ' ' || *p == '\t' || *p == '\r')
+    p++;
+  if (parsed < 2 || *p != '\0')
+    return snprintf(response, SERVER_RESPONSE_SIZE, "error malformed\n");
+
+  /* a fractional UTC offset (+5.5, +5.75) shifts the times of its whole
+   * hours by the rest, like PT__getTimesZone */
+  const double offset = values[3] + values[4];
+  if (!(fabs(offset) <= 24))
+    return snprintf(response, SERVER_RESPONSE_SIZE, "error invalid timezone\n");
+  const int hours = (int)floor(offset);
+  const double fraction = offset - hours;
+
+  PT_PrayerTimes_t times;
+  PT_FormattedTimes_t formatted;
+  PT__getTimes(server->pts[m],
+               times,
+               year,
+               month,
+               day,
+               values[0],
+               values[1],
+               values[2],
+               hours,
+               0);
+  if (fraction != 0)
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      times[i] += fraction;
+  PT__formatTimesTo(&server->format, times, formatted);
+  return snprintf(response,
+                  SERVER_RESPONSE_SIZE,
+                  "%04d-%02d-%02d %s %s %s %s %s %s %s %s %s\n",
+                  year,
+                  month,
+                  day,
+                  formatted[PT_TN_IMSAK],
+                  formatted[PT_TN_FAJR],
+                  formatted[PT_TN_SUNRISE],
+                  formatted[PT_TN_DHUHR],
+                  formatted[PT_TN_ASR],
+                  formatted[PT_TN_SUNSET],
+                  formatted[PT_TN_MAGHRIB],
+                  formatted[PT_TN_ISHA],
+                  formatted[PT_TN_MIDNIGHT]);
+}
+
+/**
+ * Answer the request of a slot, on a worker thread
+ *
+ * @param[in,out]  arg  Request slot
+ **/
+static void
+runRequest(void* arg)
+{
+  Request* request = arg;
+  Connection* connection = request->connection;
+  size_t length = answer(connection->server, request->line, request->response);
+
+  pthread_mutex_lock(&connection->lock);
+  request->length = length;
+  request->done = 1;
+  pthread_cond_broadcast(&connection->cond);
+  pthread_mutex_unlock(&connection->lock);
+}
+
+/**
+ * Write the answered requests of a connection in order, coalescing the
+ * responses ready at once into one write
+ *
+ * @param[in,out]  arg  Connection
+ * @return              NULL
+ **/
+static void*
+runWriter(void* arg)
+{
+  Connection* connection = arg;
+  Server server = connection->server;
+  char buffer[SERVER_WINDOW * SERVER_RESPONSE_SIZE];
+  double latencies[SERVER_WINDOW];
+
+  pthread_mutex_lock(&connection->lock);
+  for (;;) {
+    while (!connection->eof &&
+           (connection->written == connection->submitted ||
+            !connection->slots[connection->written % SERVER_WINDOW].done))
+      pthread_cond_wait(&connection->cond, &connection->lock);
+    if (connection->written == connection->submitted)
+      break;
+    if (!connection->slots[connection->written % SERVER_WINDOW].done) {
+      pthread_cond_wait(&connection->cond, &connection->lock);
+      continue;
+    }
+
+    size_t length = 0;
+    long first = connection->written, last = first;
+    for (; last < connection->submitted; last++) {
+      Request* request = &connection->slots[last % SERVER_WINDOW];
+      if (!request->done)
+        break;
+      memcpy(buffer + length, request->response, request->length);
+      length += request->length;
+    }
+    pthread_mutex_unlock(&connection->lock);
+
+    for (size_t offset = 0; offset < length && !connection->failed;) {
+      ssize_t n = write(connection->out, buffer + offset, length - offset);
+      if (n < 0 && errno != EINTR)
+        connection->failed = 1;
+      else if (n > 0)
+        offset += n;
+    }
+
+    double end = now();
+    int count = 0;
+    for (long i = first; i < last; i++)
+      latencies[count++] = end - connection->slots[i % SERVER_WINDOW].start;
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < count; i++)
+      server->samples[server->count++ % SERVER_SAMPLES] = latencies[i];
+    pthread_mutex_unlock(&server->lock);
+
+    pthread_mutex_lock(&connection->lock);
+    connection->written = last;
+    pthread_cond_broadcast(&connection->cond);
+  }
+  pthread_mutex_unlock(&connection->lock);
+  return NULL;
+}
+
+/**
+ * Submit a request line of a connection, waiting for a free slot
+ *
+ * @param[in,out]  connection  Connection
+ * @param[in]      line        Request line
+ * @param[in]      length      Length of the line, may exceed the slot
+ * @param[in]      start       Time the line was read
+ **/
+static void
+submit(Connection* connection,
+       const char* line,
+       size_t length,
+       const double start)
+{
+  pthread_mutex_lock(&connection->lock);
+  while (connection->submitted - connection->written == SERVER_WINDOW)
+    pthread_cond_wait(&connection->cond, &connection->lock);
+  Request* request = &connection->slots[connection->submitted % SERVER_WINDOW];
+  pthread_mutex_unlock(&connection->lock);
+
+  int tooLong = length >= SERVER_LINE_SIZE;
+  request->connection = connection;
+  request->start = start;
+  request->done = tooLong;
+  if (tooLong)
+    request->length = snprintf(
+      request->response, SERVER_RESPONSE_SIZE, "error request too long\n");
+  else {
+    memcpy(request->line, line, length);
+    request->line[length] = '\0';
+  }
+
+  pthread_mutex_lock(&connection->lock);
+  connection->submitted++;
+  pthread_cond_broadcast(&connection->cond);
+  pthread_mutex_unlock(&connection->lock);
+  /* out of memory for the task, the request is answered on the reader */
+  if (!tooLong &&
+      poolSubmit(connection->server->pool, runRequest, request) != 0)
+    runRequest(request);
+}
+
+Server
+serverNew(const int threads,
+          const PTE pte,
+          const PT_Precision_t precision,
+          const size_t cache)
+{
+  Server server = calloc(1, sizeof(struct server_t));
+  if (server == NULL)
+    return NULL;
+
+  for (size_t m = 0; m < SERVER_METHODS; m++) {
+    server->pts[m] = PT__new();
+    PT__setMethod(server->pts[m], (PT_Method_t)m);
+    PT__tune(server->pts[m], 2.0f);
+    PT__setEphemeris(server->pts[m], pte);
+    PT__setPrecision(server->pts[m], precision);
+    PT__setCache(server->pts[m], cache, SERVER_CACHE_LAT, SERVER_CACHE_ELV);
+  }
+  server->format = PT__compileFormat("24h");
+  server->pool = poolNew(threads > 0 ? threads : 1);
+  pthread_mutex_init(&server->lock, NULL);
+  if (server->pool == NULL)
+    serverFree(&server);
+  return server;
+}
+
+int
+serverServe(Server server, const int in, const int out)
+{
+  Connection* connection = calloc(1, sizeof(Connection));
+  char* buffer = malloc(SERVER_READ_SIZE);
+  pthread_t writer;
+  if (connection == NULL || buffer == NULL) {
+    free(connection);
+    free(buffer);
+    return -1;
+  }
+  connection->server = server;
+  connection->out = out;
+  pthread_mutex_init(&connection->lock, NULL);
+  pthread_cond_init(&connection->cond, NULL);
+  pthread_create(&writer, NULL, runWriter, connection);
+
+  /* lines longer than a slot are skipped, answered with an error */
+  size_t length = 0, skipped = 0;
+  for (;;) {
+    ssize_t n = read(in, buffer + length, SERVER_READ_SIZE - length);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    double start = now();
+
+    size_t begin = 0, end = length + n;
+    for (size_t i = length; i < end; i++) {
+      if (buffer[i] != '\n')
+        continue;
+      size_t size = skipped ? SERVER_LINE_SIZE : i - begin;
+      if (size > 0 && !skipped && buffer[i - 1] == '\r')
+        size--;
+      if (size > 0)
+        submit(connection, buffer + begin, size, start);
+      begin = i + 1;
+      skipped = 0;
+    }
+    length = end - begin;
+    memmove(buffer, buffer + begin, length);
+    if (length >= SERVER_LINE_SIZE) {
+      skipped = 1;
+      length = 0;
+    }
+  }
+  if (length > 0 || skipped)
+    submit(connection, buffer, skipped ? SERVER_LINE_SIZE : length, now());
+
+  pthread_mutex_lock(&connection->lock);
+  connection->eof = 1;
+  pthread_cond_broadcast(&connection->cond);
+  pthread_mutex_unlock(&connection->lock);
+  pthread_join(writer, NULL);
+
+  int failed = connection->failed ? -1 : 0;
+  pthread_mutex_destroy(&connection->lock);
+  pthread_cond_destroy(&connection->cond);
+  free(connection);
+  free(buffer);
+  return failed;
+}
+
+/**
+ * Client connection argument struct data type.
+ **/
+typedef struct client_t
+{
+  Server server;
+  int fd;
+} Client;
+
+/**
+ * Serve a client connection & close it
+ *
+ * @param[in]  arg  Client
+ * @return          NULL
+ **/
+static void*
+runClient(void* arg)
+{
+  Client* client = arg;
+  serverServe(client->server, client->fd, client->fd);
+  close(client->fd);
+  free(client);
+  return NULL;
+}
+
+int
+serverListen(Server server, const char* path)
+{
+  struct sockaddr_un address;
+  if (strlen(path) >= sizeof(address.sun_path))
+    return -1;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  unlink(path);
+  if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(fd, SERVER_BACKLOG) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  for (;;) {
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      close(fd);
+      return -1;
+    }
+
+    pthread_t thread;
+    Client* arg = malloc(sizeof(Client));
+    if (arg == NULL) {
+      close(client);
+      continue;
+    }
+    arg->server = server;
+    arg->fd = client;
+    if (pthread_create(&thread, NULL, runClient, arg) != 0) {
+      close(client);
+      free(arg);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+}
+
+void
+serverStats(Server server, ServerStats* stats)
+{
+  static double sorted[SERVER_SAMPLES];
+  static pthread_mutex_t sortLock = PTHREAD_MUTEX_INITIALIZER;
+
+  pthread_mutex_lock(&sortLock);
+  pthread_mutex_lock(&server->lock);
+  long count = server->count < SERVER_SAMPLES ? server->count : SERVER_SAMPLES;
+  memcpy(sorted, server->samples, count * sizeof(double));
+  pthread_mutex_unlock(&server->lock);
+
+  memset(stats, 0, sizeof(ServerStats));
+  stats->count = count;
+  if (count > 0) {
+    qsort(sorted, count, sizeof(double), compareDoubles);
+    stats->p50 = sorted[(count - 1) * 50 / 100] * 1e6;
+    stats->p90 = sorted[(count - 1) * 90 / 100] * 1e6;
+    stats->p99 = sorted[(count - 1) * 99 / 100] * 1e6;
+    stats->max = sorted[count - 1] * 1e6;
+  }
+  pthread_mutex_unlock(&sortLock);
+}
+
+void
+serverFree(Server* server)
+{
+  if (*server == NULL)
+    return;
+  if ((*server)->pool)
+    poolFree(&(*server)->pool);
+  for (size_t m = 0; m < SERVER_METHODS; m++)
+    PT__free(&(*server)->pts[m]);
+  pthread_mutex_destroy(&(*server)->lock);
+  free(*server);
+  *server = NULL;
+}
@@ -0,0 +1,99 @@
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include <praytimes.h>
+#include <praytimes_ephemeris.h>
+
+/**
+ * Request server data type.
+ *
+ * The server keeps one configured PrayTimes instance per calculation method
+ * and answers line requests:
+ *
+ *   <method> <year>-<month>-<day> <lat> <long> [<elevation> [<timezone>
+ *   [<dst>]]]
+ *
+ * where method is one of MWL, ISNA, EGYPT, MAKKAH, KARACHI, TEHRAN, JAFARI or
+ * INDONESIA and timezone & dst are in hours, fractional ones included (their
+ * sum within 24 hours), with one response line per request:
+ *
+ *   <year>-<month>-<day> <imsak> <fajr> <sunrise> <dhuhr> <asr> <sunset>
+ *   <maghrib> <isha> <midnight>
+ *
+ * or "error <reason>". The request "stats" answers the latency percentiles
+ * (in microseconds) of the recent requests:
+ *
+ *   stats <count> <p50> <p90> <p99> <max>
+ *
+ * Requests may be pipelined: they are computed concurrently on the worker
+ * pool, responses are written in request order.
+ **/
+typedef struct server_t* Server;
+
+/**
+ * Latency statistics struct data type.
+ **/
+typedef struct server_stats_t
+{
+  long count; /* number of requests sampled */
+  double p50; /* latency percentiles (in microseconds) */
+  double p90;
+  double p99;
+  double max;
+} ServerStats;
+
+/**
+ * Create new server
+ *
+ * @param[in]  threads    Number of worker threads
+ * @param[in]  pte        Ephemeris table, may be NULL
+ * @param[in]  precision  Precision
+ * @param[in]  cache      Result cache entries per method (see PT__setCache),
+ *                        0 for none
+ * @return                Server instance, NULL on failure
+ **/
+Server
+serverNew(const int threads,
+          const PTE pte,
+          const PT_Precision_t precision,
+          const size_t cache);
+
+/**
+ * Serve one connection until the end of its input
+ *
+ * @param[in]  server  Server instance
+ * @param[in]  in      Input file descriptor
+ * @param[in]  out     Output file descriptor
+ * @return             0 on success, -1 on write failure
+ **/
+int
+serverServe(Server server, const int in, const int out);
+
+/**
+ * Listen on a Unix domain socket, serving every connection in its own thread
+ *
+ * @param[in]  server  Server instance
+ * @param[in]  path    Socket path, replaced if it exists
+ * @return             -1 on failure, does not return otherwise
+ **/
+int
+serverListen(Server server, const char* path);
+
+/**
+ * Get latency statistics of the recent requests
+ *
+ * @param[in]   server  Server instance
+ * @param[out]  stats   Latency statistics
+ **/
+void
+serverStats(Server server, ServerStats* stats);
+
+/**
+ * Free server, once no connection is served anymore
+ *
+ * @param[out]  server  Server instance
+ **/
+void
+serverFree(Server* server);
+
+#endif
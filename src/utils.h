@@ -79,6 +79,24 @@ str2float(const char* str, const int strlen)
   return result * sign;
 }
 
+/**
+ * Days since 1970-01-01 of a date
+ *
+ * @param[in]  year   Year value
+ * @param[in]  month  Month value
+ * @param[in]  day    Day value
+ * @return            Days, negative before 1970
+ **/
+static inline long
+date2days(const int year, const int month, const int day)
+{
+  const long y = year - (month <= 2);
+  const long era = (y >= 0 ? y : y - 399) / 400;
+  const long yoe = y - era * 400;
+  const long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
 /**
  * Date increment
  *
@@ -104,9 +122,12 @@ dateInc(int* year, int* month, int* day)
       *month = *month + 1;
       return;
     }
+  } else if (*day == 29 && *month == 2) {
+    *day = 1;
+    *month = *month + 1;
+    return;
   } else if (*day == 30) {
     switch (*month) {
-      case 2:
       case 4:
       case 6:
       case 9:
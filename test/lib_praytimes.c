@@ -1,9 +1,51 @@
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <praytimes.h>
 
+/**
+ * Instance shared by the readers while it is reconfigured
+ **/
+typedef struct
+{
+  PT pt;
+  PT_PrayerTimes_t expected[2]; /* times of both configurations */
+  double tolerance;             /* of the times of the result cache */
+  int stop;
+  unsigned long reads;
+} Shared_t;
+
+/**
+ * Read the times of the shared instance until stopped, each consistent with
+ * one configuration
+ **/
+static void*
+readShared(void* arg)
+{
+  Shared_t* shared = arg;
+  PT_PrayerTimes_t times;
+  while (!__atomic_load_n(&shared->stop, __ATOMIC_ACQUIRE)) {
+    PT__getTimes(shared->pt, times, 2022, 1, 24, 51.5074, -0.1278, 11, 0, 0);
+    int matches[2] = { 1, 1 };
+    for (int c = 0; c < 2; c++)
+      for (int i = PT_TN_FAJR; i <= PT_TN_ISHA; i++)
+        if (i != PT_TN_SUNRISE && i != PT_TN_SUNSET)
+          matches[c] = matches[c] && fabs(times[i] - shared->expected[c][i]) <=
+                                       shared->tolerance;
+    assert(matches[0] || matches[1]);
+    PT_Parameters_t parameters = PT__getParameters(shared->pt);
+    assert(parameters.method == PT_M_MWL
+             ? parameters.fajr == 18.0 && parameters.isha == 17.0
+             : parameters.fajr == 15.0 && parameters.isha == 15.0);
+    __atomic_add_fetch(&shared->reads, 1, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -30,6 +72,543 @@ main(int argc, char* argv[])
   assert(strcmp(isha, "19:48") == 0);
   assert(strcmp(midnight, "00:40") == 0);
 
+  char buffer[PT_TIME_SIZE];
+  PT_TimeFormatSpec_t spec = PT__compileFormat("12h");
+  assert(PT__formatTimeTo(&spec, results[PT_TN_ASR], buffer, 16) == 7);
+  assert(strcmp(buffer, "4:04 pm") == 0);
+  assert(PT__formatTimeTo(&spec, results[PT_TN_FAJR], buffer, 16) == 7);
+  assert(strcmp(buffer, "5:29 am") == 0);
+  assert(PT__formatTimeTo(&spec, 0.5, buffer, 16) == 8);
+  assert(strcmp(buffer, "12:30 am") == 0);
+  assert(PT__formatTimeTo(&spec, results[PT_TN_ASR], buffer, 3) == 7);
+  assert(strcmp(buffer, "4:") == 0);
+  spec = PT__compileFormat("12hNS");
+  assert(PT__formatTimeTo(&spec, results[PT_TN_ISHA], buffer, 16) == 4);
+  assert(strcmp(buffer, "7:48") == 0);
+  spec = PT__compileFormat("Float");
+  assert(PT__formatTimeTo(&spec, 5.25, buffer, 16) == 6);
+  assert(strcmp(buffer, "5.2500") == 0);
+  assert(PT__formatTimeTo(&spec, -0.125, buffer, 16) == 7);
+  assert(strcmp(buffer, "-0.1250") == 0);
+  assert(PT__formatTimeTo(&spec, NAN, buffer, 16) == 5);
+  assert(strcmp(buffer, "-----") == 0);
+  spec = PT__compileFormat(NULL);
+  PT_FormattedTimes_t formatted;
+  PT__formatTimesTo(&spec, results, formatted);
+  assert(strcmp(formatted[PT_TN_IMSAK], imsak) == 0);
+  assert(strcmp(formatted[PT_TN_DHUHR], dhuhr) == 0);
+  assert(strcmp(formatted[PT_TN_MIDNIGHT], midnight) == 0);
+  char* formattedIsha = PT__formatTime(pt, results[PT_TN_ISHA], "12h");
+  assert(strcmp(formattedIsha, "7:48 pm") == 0);
+  free(formattedIsha);
+
+  PT_PrayerTimes_t refined;
+  PT_Iterations_t iterations;
+  PT__getTimesRefined(
+    pt, refined, iterations, 2022, 1, 21, 3.583333, 97.666667, 0, 7, 0);
+  for (int i = PT_TN_IMSAK; i < PT_TN_MIDNIGHT; i++)
+    assert(iterations[i] == 1 && refined[i] == results[i]);
+  assert(iterations[PT_TN_MIDNIGHT] == 0);
+  PT__refine(pt, 10, 0.01);
+  PT__getTimesRefined(
+    pt, refined, iterations, 2022, 1, 21, 3.583333, 97.666667, 0, 7, 0);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++) {
+    assert(fabs(refined[i] - results[i]) < 2 / 60.0);
+    assert(i == PT_TN_MIDNIGHT || (iterations[i] > 1 && iterations[i] < 10));
+  }
+  PT__refine(pt, 10, 60);
+  PT__getTimesRefined(
+    pt, refined, iterations, 2022, 1, 21, 3.583333, 97.666667, 0, 7, 0);
+  assert(iterations[PT_TN_FAJR] == 1);
+  assert(refined[PT_TN_FAJR] == results[PT_TN_FAJR]);
+  assert(iterations[PT_TN_ASR] == 2);
+  PT__refine(pt, 1, 0);
+
+  double lats[3] = { 3.583333, -33.8688, 64.1466 };
+  double lngs[3] = { 97.666667, 151.2093, -21.9426 };
+  double elvs[3] = { 0, 58, 10 };
+  int tmzs[3] = { 7, 10, 0 }, dsts[3] = { 0, 1, 0 };
+  double columns[PT_TN_MIDNIGHT + 1][3];
+  PT_PrayerTimesBatch_t batch;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    batch[i] = columns[i];
+  PT__getTimesBatch(pt, batch, 2022, 1, 21, lats, lngs, elvs, tmzs, dsts, 3);
+  for (int i = 0; i < 3; i++) {
+    PT__getTimes(
+      pt, results, 2022, 1, 21, lats[i], lngs[i], elvs[i], tmzs[i], dsts[i]);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      assert(memcmp(&columns[j][i], &results[j], sizeof(double)) == 0);
+  }
+
+  float latsF[3], lngsF[3], elvsF[3];
+  float columnsF[PT_TN_MIDNIGHT + 1][3];
+  PT_PrayerTimesBatchF_t batchF;
+  for (int i = 0; i < 3; i++) {
+    latsF[i] = lats[i];
+    lngsF[i] = lngs[i];
+    elvsF[i] = elvs[i];
+  }
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    batchF[i] = columnsF[i];
+  PT__getTimesBatchF(
+    pt, batchF, 2022, 1, 21, latsF, lngsF, elvsF, tmzs, dsts, 3);
+  for (int i = 0; i < 3; i++)
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      assert(fabs(columnsF[j][i] - columns[j][i]) < 0.01 / 60);
+
+  double gridLats[4] = { 64.1466, 21.3891, -6.2088, -33.8688 };
+  double gridLngs[3] = { -74.006, 39.8579, 151.2093 };
+  double cells[PT_TN_MIDNIGHT + 1][12];
+  PT_PrayerTimesBatch_t grid;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    grid[i] = cells[i];
+  PT__getTimesGrid(pt, grid, 2022, 6, 21, gridLats, 4, gridLngs, 3, 20, 3, 0);
+  for (int r = 0; r < 4; r++)
+    for (int c = 0; c < 3; c++) {
+      PT__getTimes(
+        pt, results, 2022, 6, 21, gridLats[r], gridLngs[c], 20, 3, 0);
+      for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+        assert(fabs(cells[j][r * 3 + c] - results[j]) < 1e-12 / 60);
+    }
+
+  PT_PrayerTimes_t range[400];
+  PT__getTimesRange(pt, range, 2022, 1, 21, 400, -33.86, 151.2, 58, 10, 0);
+  for (int i = 0; i < 400; i++) {
+    PT__getTimes(pt, results, 2022, 1, 21 + i, -33.86, 151.2, 58, 10, 0);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      assert(fabs(range[i][j] - results[j]) < 1e-9 / 60);
+  }
+  PT__refine(pt, 10, 0.01);
+  PT__getTimesRange(pt, range, 2022, 1, 21, 30, 64.1466, -21.9426, 10, 0, 0);
+  for (int i = 0; i < 30; i++) {
+    PT__getTimes(pt, results, 2022, 1, 21 + i, 64.1466, -21.9426, 10, 0, 0);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      assert(fabs(range[i][j] - results[j]) < 0.02 / 60);
+  }
+  PT__refine(pt, 1, 0);
+
+  PT_PrayerTimes_t exact;
+  for (int month = 1; month <= 12; month++) {
+    PT__setPrecision(pt, PT_P_EXACT);
+    PT__getTimes(pt, exact, 2022, month, 21, -33.86, 151.2, 58, 10, 0);
+    PT__setPrecision(pt, PT_P_FAST);
+    PT__getTimes(pt, results, 2022, month, 21, -33.86, 151.2, 58, 10, 0);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      assert(fabs(results[i] - exact[i]) < 1e-9 / 60);
+    PT__setPrecision(pt, PT_P_FLOAT);
+    PT__getTimes(pt, results, 2022, month, 21, -33.86, 151.2, 58, 10, 0);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      assert(fabs(results[i] - exact[i]) < 0.05 / 60);
+  }
+  PT__setPrecision(pt, PT_P_EXACT);
+
+  /* clustered cached lookups format like uncached ones */
+  PT cached = PT__new();
+  PT_TimeFormatSpec_t format24h = PT__compileFormat("24h");
+  PT_FormattedTimes_t formattedCached;
+  PT__tune(cached, 0);
+  PT__setCache(cached, 512, 0.005, 10);
+  for (int i = 0; i < 20000; i++) {
+    int city = i % 40;
+    double lat = -60.0 + city * 3.0 + (i / 40 % 5) * 0.0007;
+    double lng = -170.0 + city * 8.5 + (i / 40 % 7) * 0.0011;
+    double elv = (city % 5) * 37.0 + (i % 3);
+    int month = 1 + (i / 2000) % 12, day = 1 + (i / 1000) % 28;
+    PT__getTimes(pt, results, 2022, month, day, lat, lng, elv, 0, 0);
+    PT__getTimes(cached, exact, 2022, month, day, lat, lng, elv, 0, 0);
+    PT__formatTimesTo(&format24h, results, formatted);
+    PT__formatTimesTo(&format24h, exact, formattedCached);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+      assert(strcmp(formatted[j], formattedCached[j]) == 0);
+  }
+  PT_CacheStats_t stats = PT__getCacheStats(cached);
+  assert(stats.hits + stats.misses == 20000);
+  assert(stats.hits > stats.misses && stats.entries <= 512);
+  PT__setMethod(cached, PT_M_ISNA);
+  assert(PT__getCacheStats(cached).entries == 0);
+  PT__getTimes(cached, exact, 2022, 1, 21, -6.2, 106.8, 0, 7, 0);
+  assert(PT__getCacheStats(cached).entries == 4);
+  PT__tune(cached, 0);
+  assert(PT__getCacheStats(cached).entries == 4);
+  PT__tune(cached, 1);
+  assert(PT__getCacheStats(cached).entries == 0);
+
+  /* exact keys return the uncached times themselves, evicted or not */
+  PT_PrayerTimes_t uncached[400];
+  PT__setCache(cached, 0, 0, 0);
+  for (int pass = 0; pass < 3; pass++) {
+    if (pass == 1)
+      PT__setCache(cached, 64, 0, 0);
+    for (int i = 0; i < 400; i++) {
+      double lat = -40.0 + (i % 100) * 0.0013, lng = 106.8 + (i % 7) * 0.5;
+      int day = 1 + i % 5, dst = i % 2;
+      for (int call = 0; call < (pass == 1 ? 2 : 1); call++) {
+        PT__getTimes(cached, exact, 2022, 3, day, lat, lng, 10, 7, dst);
+        if (pass == 0)
+          memcpy(uncached[i], exact, sizeof(PT_PrayerTimes_t));
+        for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+          assert(exact[j] == uncached[i][j] ||
+                 (isnan(exact[j]) && isnan(uncached[i][j])));
+      }
+    }
+  }
+  stats = PT__getCacheStats(cached);
+  assert(stats.hits + stats.misses == 1200 && stats.hits >= 400);
+  assert(stats.misses >= 400 && stats.entries <= 64);
+  PT__setCache(cached, 0, 0, 0);
+  assert(PT__getCacheStats(cached).hits == 0);
+
+  /* fajr peaks inside a cell around the latitude where its hour angle is
+   * extremal, beyond a minute its corners do not reach */
+  double peakLat = 0, peak = -INFINITY, corners = -INFINITY;
+  for (double lat = -36.0; lat < -32.0; lat += 0.001) {
+    PT__getTimes(pt, results, 2022, 4, 16, lat, 0, 0, 0, 0);
+    if (results[PT_TN_FAJR] > peak) {
+      peak = results[PT_TN_FAJR];
+      peakLat = lat;
+    }
+  }
+  for (int k = 0; k < 2; k++) {
+    double lat = (floor(peakLat / 0.1) + k) * 0.1;
+    PT__getTimes(pt, results, 2022, 4, 16, lat, 0, 0, 0, 0);
+    corners = fmax(corners, results[PT_TN_FAJR]);
+  }
+  /* a minute boundary between the corners and the peak */
+  double middle = (corners + peak) / 2;
+  double lng =
+    -15 * (round((middle + 1 / 180.0) * 60) / 60 - 1 / 180.0 - middle);
+  PT__setMethod(cached, PT__getMethod(pt));
+  PT__tune(cached, 0);
+  PT__setCache(cached, 64, 0.1, 0);
+  PT__getTimes(pt, results, 2022, 4, 16, peakLat, lng, 0, 0, 0);
+  PT__getTimes(cached, exact, 2022, 4, 16, peakLat, lng, 0, 0, 0);
+  PT__formatTimesTo(&format24h, results, formatted);
+  PT__formatTimesTo(&format24h, exact, formattedCached);
+  assert(strcmp(formatted[PT_TN_FAJR], formattedCached[PT_TN_FAJR]) == 0);
+  PT__free(&cached);
+
+  /* the specialised pipeline follows the configuration changes */
+  PT switched = PT__new();
+  PT__tune(switched, 0);
+  for (int m = PT_M_INDONESIA; m >= PT_M_MWL; m--)
+    for (int h = PT_HL_ONE_SEVENTH; h >= PT_HL_NONE; h--)
+      for (int a = PT_AJ_HANAFI; a >= PT_AJ_STANDARD; a--) {
+        PT fresh = PT__new();
+        PT__tune(fresh, 0);
+        PT__setMethod(fresh, m);
+        PT__setMethod(switched, m);
+        PT_Parameters_t parameters = PT__getParameters(fresh);
+        PT__adjust(fresh,
+                   parameters.imsak,
+                   parameters.fajr,
+                   parameters.dhuhr,
+                   a,
+                   parameters.maghrib,
+                   parameters.isha,
+                   parameters.midnight,
+                   h);
+        PT__adjust(switched,
+                   parameters.imsak,
+                   parameters.fajr,
+                   parameters.dhuhr,
+                   a,
+                   parameters.maghrib,
+                   parameters.isha,
+                   parameters.midnight,
+                   h);
+        PT__getTimes(fresh, results, 2022, 12, 21, 61.2, 10.7, 0, 1, 0);
+        PT__getTimes(switched, exact, 2022, 12, 21, 61.2, 10.7, 0, 1, 0);
+        /* sunrise, sunset & midnight are not tuned */
+        for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+          assert(j == PT_TN_SUNRISE || j == PT_TN_SUNSET ||
+                 j == PT_TN_MIDNIGHT || results[j] == exact[j] ||
+                 (isnan(results[j]) && isnan(exact[j])));
+        if (m == PT_M_MAKKAH)
+          assert(results[PT_TN_ISHA] == results[PT_TN_MAGHRIB] + 1.5);
+        PT__free(&fresh);
+      }
+  PT__free(&switched);
+
+  /* masked times equal the full ones, the times not needed are NaN */
+  PT masked = PT__new();
+  PT__tune(masked, 1);
+  for (int c = 0; c < 8 * 4 * 2 * 3 * 2; c++) {
+    int m = c % 8, h = c / 8 % 4, mm = c / 32 % 2, p = c / 64 % 3;
+    PT__setMethod(masked, m);
+    PT_Parameters_t parameters = PT__getParameters(masked);
+    PT__adjust(masked,
+               parameters.imsak,
+               parameters.fajr,
+               parameters.dhuhr,
+               PT_AJ_STANDARD,
+               parameters.maghrib,
+               parameters.isha,
+               mm,
+               h);
+    PT__setPrecision(masked, p);
+    PT__refine(masked, c / 192 ? 5 : 1, 0.01);
+    PT__getTimes(masked, exact, 2022, 6, 21, 61.2, 10.7, 0, 1, 0);
+    for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++) {
+      PT__getTimesMask(
+        masked, results, PT_TN_MASK(j), 2022, 6, 21, 61.2, 10.7, 0, 1, 0);
+      assert(results[j] == exact[j] || (isnan(results[j]) && isnan(exact[j])));
+    }
+  }
+  PT__setMethod(masked, PT_M_MWL);
+  PT__getTimesMask(masked,
+                   results,
+                   PT_TN_MASK(PT_TN_SUNRISE) | PT_TN_MASK(PT_TN_ASR),
+                   2022,
+                   1,
+                   21,
+                   -6.2,
+                   106.8,
+                   0,
+                   7,
+                   0);
+  for (int j = PT_TN_IMSAK; j <= PT_TN_MIDNIGHT; j++)
+    assert(isnan(results[j]) == (j != PT_TN_SUNRISE && j != PT_TN_ASR));
+  const unsigned midnightMask = PT_TN_MASK(PT_TN_MIDNIGHT);
+  PT__getTimesMask(
+    masked, results, midnightMask, 2022, 1, 21, -6.2, 106.8, 0, 7, 0);
+  assert(!isnan(results[PT_TN_SUNSET]) && isnan(results[PT_TN_ASR]));
+  PT__free(&masked);
+
+  /* next prayer from the cached local days, in Unix time */
+  const double localDay = 19013 * 86400.0 - 7 * 3600.0; /* 2022-01-21 */
+  PT_PrayerTimes_t today, tomorrow;
+  PT__getTimes(pt, today, 2022, 1, 21, 3.583333, 97.666667, 0, 7, 0);
+  PT__getTimes(pt, tomorrow, 2022, 1, 22, 3.583333, 97.666667, 0, 7, 0);
+  PT_Location_t location = PT__location(3.583333, 97.666667, 0, 7, 0);
+  PT_NextPrayer_t next = PT__nextPrayer(pt, &location, localDay);
+  assert(next.name == PT_TN_FAJR);
+  assert(fabs(next.time - (localDay + today[PT_TN_FAJR] * 3600)) < 1e-3);
+  const PT_Location_t filled = location;
+  const PT_TimeName_t prayers[] = {
+    PT_TN_FAJR, PT_TN_DHUHR, PT_TN_ASR, PT_TN_MAGHRIB, PT_TN_ISHA
+  };
+  for (int i = 0; i < 5; i++) {
+    const double time = localDay + today[prayers[i]] * 3600;
+    next = PT__nextPrayer(pt, &location, time - 1);
+    assert(next.name == prayers[i] && fabs(next.time - time) < 1e-3);
+    if (i < 4) {
+      next = PT__nextPrayer(pt, &location, time);
+      assert(next.name == prayers[i + 1]);
+    }
+  }
+  /* answered from the cache, not recomputed */
+  assert(memcmp(&filled, &location, sizeof(location)) == 0);
+  /* after isha: fajr of the next day */
+  next = PT__nextPrayer(pt, &location, localDay + today[PT_TN_ISHA] * 3600);
+  assert(next.name == PT_TN_FAJR);
+  assert(fabs(next.time - (localDay + 86400 + tomorrow[PT_TN_FAJR] * 3600)) <
+         1e-3);
+  next = PT__nextPrayer(pt, &location, localDay + 86400 + 12 * 3600);
+  assert(next.name == PT_TN_DHUHR);
+  assert(fabs(next.time - (localDay + 86400 + tomorrow[PT_TN_DHUHR] * 3600)) <
+         1e-3);
+  /* a fresh location agrees with the rolled over one */
+  PT_Location_t fresh = PT__location(3.583333, 97.666667, 0, 7, 0);
+  PT_NextPrayer_t freshNext =
+    PT__nextPrayer(pt, &fresh, localDay + 86400 + 12 * 3600);
+  assert(freshNext.name == next.name && freshNext.time == next.time);
+  /* reconfiguring the instance invalidates the cache */
+  const unsigned long generation = location.generation;
+  PT__tune(pt, 10);
+  next = PT__nextPrayer(pt, &location, localDay + 86400 + 12 * 3600);
+  assert(location.generation != generation);
+  assert(fabs(next.time - freshNext.time - 600) < 1e-3);
+  PT__tune(pt, 0);
+
+  /* the prayers of many locations in chronological order */
+  PT_Location_t streamed[3] = {
+    PT__location(3.583333, 97.666667, 0, 7, 0),
+    PT__location(21.4225, 39.8262, 277, 3, 0),
+    PT__location(64.1466, -21.9426, 0, 0, 0),
+  };
+  const double start = 19013 * 86400.0; /* 2022-01-21 00:00 UTC */
+  PT_Events events = PT__events(pt, streamed, 3, start, start + 48 * 3600);
+  PT_Event_t event, previous = { 0, PT_TN_FAJR, start };
+  int streamedCount[3] = { 0, 0, 0 };
+  while (PT__nextEvent(events, &event)) {
+    assert(event.time > previous.time ||
+           (event.time == previous.time && event.location > previous.location));
+    assert(event.time < start + 48 * 3600);
+    /* the next prayer of its location after its previous one */
+    PT_Location_t check = streamed[event.location];
+    check.generation = 0;
+    next = PT__nextPrayer(pt,
+                          &check,
+                          streamedCount[event.location]++
+                            ? event.time - 60
+                            : start);
+    assert(next.name == event.name && next.time == event.time);
+    previous = event;
+  }
+  for (int i = 0; i < 3; i++)
+    assert(streamedCount[i] == 10);
+  assert(PT__nextEvent(events, &event) == 0);
+  PT__freeEvents(&events);
+  assert(events == NULL);
+
+  /* the stages are counted when instrumented, nothing is otherwise */
+  PT_Stats_t stageStats;
+  PT__resetStats();
+  int instrumented = PT__getStats(&stageStats) == 0;
+  PT__getTimes(pt, results, 2022, 6, 21, 64.1466, -21.9426, 0, 0, 0);
+  PT__formatTimesTo(&format24h, results, formatted);
+  PT__getStats(&stageStats);
+  for (int i = PT_ST_COMPUTE; i <= PT_ST_TUNE; i++)
+    assert(stageStats.calls[i] == (instrumented ? 1 : 0));
+  assert(stageStats.calls[PT_ST_FORMAT] == (instrumented ? 9 : 0));
+  /* no twilight: fajr & isha fall back */
+  assert(instrumented ? stageStats.nanHourAngles > 0 &&
+                          stageStats.highLatFallbacks >= 2
+                      : stageStats.nanHourAngles == 0);
+  PT__resetStats();
+  PT__getStats(&stageStats);
+  assert(stageStats.calls[PT_ST_COMPUTE] == 0);
+
+  /* readers see one configuration snapshot or the other, never a mix, while
+   * the shared instance is reconfigured by setters & published snapshots */
+  PT configured[2] = { PT__new(), PT__new() };
+  PT_Config configs[2];
+  Shared_t shared;
+  shared.pt = PT__new();
+  PT__tune(shared.pt, 0);
+  PT__setMethod(configured[1], PT_M_ISNA);
+  for (int c = 0; c < 2; c++) {
+    PT__tune(configured[c], 0);
+    PT__getTimes(configured[c],
+                 shared.expected[c],
+                 2022,
+                 1,
+                 24,
+                 51.5074,
+                 -0.1278,
+                 11,
+                 0,
+                 0);
+    configs[c] = PT__getConfig(configured[c]);
+  }
+  PT__free(&configured[1]);
+  assert(PT__getMethod(configured[0]) == PT_M_MWL);
+  for (int round = 0; round < 2; round++) {
+    /* the second round through the result cache, which may not mix them
+     * either */
+    if (round == 1)
+      PT__setCache(shared.pt, 1024, 0.005, 1);
+    shared.tolerance = round == 1 ? 1 / 60.0 : 0;
+    shared.stop = 0;
+    shared.reads = 0;
+    pthread_t readers[3];
+    for (int i = 0; i < 3; i++)
+      pthread_create(&readers[i], NULL, readShared, &shared);
+    for (int i = 0; i < 400; i++) {
+      if (i % 2)
+        PT__setConfig(shared.pt, configs[i / 2 % 2]);
+      else
+        PT__setMethod(shared.pt, i / 2 % 2 ? PT_M_ISNA : PT_M_MWL);
+      while (__atomic_load_n(&shared.reads, __ATOMIC_RELAXED) <
+             (unsigned long)i / 4)
+        ;
+    }
+    __atomic_store_n(&shared.stop, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < 3; i++)
+      pthread_join(readers[i], NULL);
+  }
+  /* the shared snapshot outlives the instance that configured it */
+  PT__setConfig(shared.pt, configs[0]);
+  PT__free(&configured[0]);
+  PT__releaseConfig(&configs[0]);
+  assert(configs[0] == NULL);
+  PT__releaseConfig(&configs[1]);
+  PT__getTimes(shared.pt, results, 2022, 1, 24, 51.5074, -0.1278, 11, 0, 0);
+  assert(fabs(results[PT_TN_FAJR] - shared.expected[0][PT_TN_FAJR]) < 1 / 60.0);
+  assert(PT__getCacheStats(shared.pt).hits > 0);
+  PT__free(&shared.pt);
+
+  /* instances in caller storage, with every field initialised: all the times
+   * are those of PT__new, which tune no time by default */
+  PT_Storage_t storage;
+  memset(&storage, 0xff, sizeof(storage));
+  assert(PT__sizeof() <= sizeof(storage));
+  PT embedded = PT__init(&storage);
+  PT defaults = PT__new();
+  PT_PrayerTimes_t embeddedTimes;
+  PT__getTimes(embedded, embeddedTimes, 2022, 1, 24, 3.58, 97.66, 0, 7, 0);
+  PT__getTimes(defaults, results, 2022, 1, 24, 3.58, 97.66, 0, 7, 0);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    assert(!isnan(embeddedTimes[i]) && embeddedTimes[i] == results[i]);
+  assert(PT__getOffset(embedded) == 0);
+  PT_Parameters_t parameters = PT__getParameters(embedded);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    assert(parameters.offsets[i] == 0);
+  /* the initial snapshot outlives the storage */
+  PT_Config initial = PT__getConfig(embedded);
+  PT__setMethod(embedded, PT_M_ISNA);
+  assert(PT__getMethod(embedded) == PT_M_ISNA);
+  PT__deinit(embedded);
+  memset(&storage, 0xff, sizeof(storage));
+  PT__setMethod(defaults, PT_M_ISNA);
+  PT__setConfig(defaults, NULL);
+  assert(PT__getMethod(defaults) == PT_M_ISNA);
+  PT__setConfig(defaults, initial);
+  PT__releaseConfig(&initial);
+  PT__releaseConfig(&initial);
+  PT__getTimes(defaults, embeddedTimes, 2022, 1, 24, 3.58, 97.66, 0, 7, 0);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    assert(embeddedTimes[i] == results[i]);
+  PT__free(&defaults);
+
+  /* all the methods in one pass give the times of each method, in every
+   * precision & with refinement, over latitudes where times do not occur */
+  PT methods = PT__new();
+  PT single = PT__new();
+  PT__tune(methods, 2);
+  PT__setMethod(methods, PT_M_TEHRAN);
+  PT_PrayerTimes_t allMethods[PT_M_INDONESIA + 1];
+  for (int variant = 0; variant < 4; variant++) {
+    if (variant < 3)
+      PT__setPrecision(methods, (PT_Precision_t)variant);
+    else
+      PT__refine(methods, 5, 0.01);
+    for (double lat = -70; lat <= 70; lat += 35) {
+      PT__getTimesMethods(methods, allMethods, 2022, 6, 21, lat, 10, 50, 1, 0);
+      for (int m = PT_M_MWL; m <= PT_M_INDONESIA; m++) {
+        PT_Config config = PT__getConfig(methods);
+        PT__setConfig(single, config);
+        PT__releaseConfig(&config);
+        PT__setMethod(single, m);
+        PT__getTimes(single, results, 2022, 6, 21, lat, 10, 50, 1, 0);
+        for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+          assert(allMethods[m][i] == results[i] ||
+                 (isnan(allMethods[m][i]) && isnan(results[i])));
+      }
+    }
+  }
+  /* arbitrary lists of configurations, sharing what they can */
+  PT_Config list[4];
+  PT__refine(methods, 1, 0);
+  PT__setMethod(methods, PT_M_MAKKAH);
+  list[0] = PT__getConfig(methods);
+  PT__adjust(methods, 10, 18, 1, PT_AJ_HANAFI, 0, 17, PT_MM_STANDARD, 0);
+  list[1] = PT__getConfig(methods);
+  PT__setPrecision(methods, PT_P_EXACT);
+  list[2] = PT__getConfig(methods);
+  PT__setMethod(methods, PT_M_JAFARI);
+  list[3] = PT__getConfig(methods);
+  PT__getTimesConfigs(list, allMethods, 2022, 1, 24, 51.5, -0.1, 11, 0, 0, 4);
+  for (int c = 0; c < 4; c++) {
+    PT__setConfig(single, list[c]);
+    PT__getTimes(single, results, 2022, 1, 24, 51.5, -0.1, 11, 0, 0);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      assert(allMethods[c][i] == results[i]);
+    PT__releaseConfig(&list[c]);
+  }
+  PT__free(&single);
+  PT__free(&methods);
+
   printf("All test assertions passed...\n");
 
   /*
@@ -0,0 +1,425 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <praytimes.h>
+#include <praytimes_ephemeris.h>
+
+/*
+ * Differential accuracy of the alternative compute paths against the
+ * reference PT__getTimes (double precision, libm trig, no cache), over every
+ * method, higher latitudes method & asr juristic, latitudes from pole to
+ * pole and blocks of consecutive days over two centuries. Configurations are
+ * spread over one thread per CPU.
+ */
+
+#define LATS 30       /* -88 to 86 degrees */
+#define YEARS 4       /* years of the blocks */
+#define BLOCKS 2      /* blocks of consecutive days per configuration */
+#define BLOCK_DAYS 36 /* more than a recurrence restart (32 days) */
+#define DAY_STEP 6    /* days of a block compared */
+#define CONFIGS                                                                \
+  ((PT_M_INDONESIA + 1) * (PT_HL_ONE_SEVENTH + 1) * (PT_AJ_HANAFI + 1))
+#define BINS_PER_DECADE 10
+#define BINS (16 * BINS_PER_DECADE) /* 1e-12 to 1e4 seconds */
+
+typedef enum Paths
+{
+  PATH_FAST,      /* PT_P_FAST */
+  PATH_FLOAT,     /* PT_P_FLOAT, within 60 degrees of latitude */
+  PATH_FLOAT48,   /* PT_P_FLOAT, within 48 degrees of latitude */
+  PATH_RANGE,     /* PT__getTimesRange recurrences */
+  PATH_EPHEMERIS, /* PT__setEphemeris table, 24 samples per day */
+  PATH_CACHE,     /* PT__setCache lookups */
+  PATH_GRID,      /* PT__getTimesGrid */
+  PATH_BATCH,     /* PT__getTimesBatch */
+  PATH_MASK,      /* PT__getTimesMask, one time at a time */
+  PATH_METHODS,   /* PT__getTimesMethods */
+  PATH_COUNT,
+} Path_t;
+
+static const char* pathNames[PATH_COUNT] = {
+  "fast", "float60", "float48", "range", "ephemeris",
+  "cache", "grid", "batch", "mask",      "methods",
+};
+
+/* bounds: maximum error (in seconds) & minute changes, -1 for no bound */
+static const double maxBounds[PATH_COUNT] = { 1e-6, 30,   3,    1e-6, 1e-3,
+                                              -1,   1e-7, 1e-7, 1e-7, 1e-7 };
+static const long minuteBounds[PATH_COUNT] = { 0, -1, -1, 0, -1,
+                                               0, 0,  0,  0, 0 };
+
+/**
+ * Error statistics of a path
+ **/
+typedef struct Stats
+{
+  long compared;
+  long nans;    /* times occurring by one path only */
+  long minutes; /* formatted minutes changed */
+  double max;
+  long bins[BINS + 1]; /* log-scale histogram, last bin under 1e-12 s */
+} Stats_t;
+
+typedef struct Worker
+{
+  int first;
+  int step;
+  PTE pte;
+  Stats_t stats[PATH_COUNT];
+  PT_PrayerTimes_t reference[BLOCK_DAYS][LATS];
+  PT_PrayerTimes_t times[BLOCK_DAYS];
+  PT_PrayerTimes_t methods[PT_M_INDONESIA + 1];
+  double batch[PT_TN_MIDNIGHT + 1][LATS];
+} Worker_t;
+
+static const PT_TimeFormatSpec_t* format;
+
+/**
+ * Add the comparison of times to the statistics of a path
+ **/
+static void
+compare(Stats_t* stats, const double* reference, const double* times)
+{
+  char expected[PT_TIME_SIZE], formatted[PT_TIME_SIZE];
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++) {
+    if (isnan(reference[i]) || isnan(times[i])) {
+      stats->nans += isnan(reference[i]) != isnan(times[i]);
+      continue;
+    }
+    double error = fabs(times[i] - reference[i]) * 3600;
+    int bin = error < 1e-12
+                ? BINS
+                : (int)fmin(floor((log10(error) + 12) * BINS_PER_DECADE),
+                            BINS - 1);
+    stats->bins[bin]++;
+    stats->max = error > stats->max ? error : stats->max;
+    stats->compared++;
+    PT__formatTimeTo(format, reference[i], expected, PT_TIME_SIZE);
+    PT__formatTimeTo(format, times[i], formatted, PT_TIME_SIZE);
+    stats->minutes += strcmp(expected, formatted) != 0;
+  }
+}
+
+/**
+ * Percentile of the errors of a path (upper edge of its bin)
+ **/
+static double
+percentile(const Stats_t* stats, const double p)
+{
+  long rank = (long)ceil(p * stats->compared), seen = stats->bins[BINS];
+  if (seen >= rank)
+    return 0;
+  for (int bin = 0; bin < BINS; bin++)
+    if ((seen += stats->bins[bin]) >= rank)
+      return pow(10, (bin + 1.0) / BINS_PER_DECADE - 12);
+  return stats->max;
+}
+
+/**
+ * Compare every path on a configuration
+ **/
+static void
+compareConfig(PT pt, Worker_t* worker, const int config)
+{
+  Stats_t* stats = worker->stats;
+  PT_PrayerTimes_t(*reference)[LATS] = worker->reference;
+  PT_PrayerTimes_t* times = worker->times;
+  const int m = config / ((PT_HL_ONE_SEVENTH + 1) * (PT_AJ_HANAFI + 1));
+  const int h = config / (PT_AJ_HANAFI + 1) % (PT_HL_ONE_SEVENTH + 1);
+  const int a = config % (PT_AJ_HANAFI + 1);
+  PT__setMethod(pt, m);
+  PT_Parameters_t parameters = PT__getParameters(pt);
+  PT__adjust(pt,
+             parameters.imsak,
+             parameters.fajr,
+             parameters.dhuhr,
+             a,
+             parameters.maghrib,
+             parameters.isha,
+             parameters.midnight,
+             h);
+
+  static const int years[YEARS] = { 1905, 1990, 2025, 2095 };
+  double lat[LATS], lng[LATS], elv[LATS];
+  int tmz[LATS], dst[LATS];
+  PT_PrayerTimesBatch_t batch;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    batch[i] = worker->batch[i];
+
+  for (int b = 0; b < BLOCKS; b++) {
+    const int year = years[(config + b) % YEARS];
+    const int start = 1 + (config * 7 + b * 97) % 330;
+    const double blockLng = -179.5 + (config * 53 + b * 131) % 360;
+    const int blockTmz = (int)floor(blockLng / 15 + 0.5);
+    for (int l = 0; l < LATS; l++) {
+      lat[l] = -88 + l * 6 + (b + config % 4) * 0.25;
+      lng[l] = blockLng;
+      elv[l] = b * 300;
+      tmz[l] = blockTmz;
+      dst[l] = 0;
+    }
+
+    for (int d = 0; d < BLOCK_DAYS; d += DAY_STEP)
+      for (int l = 0; l < LATS; l++)
+        PT__getTimes(pt,
+                     reference[d][l],
+                     year,
+                     1,
+                     start + d,
+                     lat[l],
+                     lng[l],
+                     elv[l],
+                     tmz[l],
+                     dst[l]);
+
+    /* PT_P_FAST & PT_P_FLOAT */
+    for (PT_Precision_t p = PT_P_FAST; p <= PT_P_FLOAT; p++) {
+      PT__setPrecision(pt, p);
+      for (int d = 0; d < BLOCK_DAYS; d += DAY_STEP)
+        for (int l = 0; l < LATS; l++) {
+          if (p == PT_P_FLOAT && fabs(lat[l]) > 60)
+            continue;
+          PT__getTimes(pt,
+                       times[0],
+                       year,
+                       1,
+                       start + d,
+                       lat[l],
+                       lng[l],
+                       elv[l],
+                       tmz[l],
+                       dst[l]);
+          compare(&stats[p == PT_P_FAST ? PATH_FAST : PATH_FLOAT],
+                  reference[d][l],
+                  times[0]);
+          if (p == PT_P_FLOAT && fabs(lat[l]) <= 48)
+            compare(&stats[PATH_FLOAT48], reference[d][l], times[0]);
+        }
+    }
+    PT__setPrecision(pt, PT_P_EXACT);
+
+    /* recurrences over the block */
+    for (int l = 0; l < LATS; l++) {
+      PT__getTimesRange(pt,
+                        times,
+                        year,
+                        1,
+                        start,
+                        BLOCK_DAYS,
+                        lat[l],
+                        lng[l],
+                        elv[l],
+                        tmz[l],
+                        dst[l]);
+      for (int d = 0; d < BLOCK_DAYS; d += DAY_STEP)
+        compare(&stats[PATH_RANGE], reference[d][l], times[d]);
+    }
+
+    /* ephemeris table */
+    PT__setEphemeris(pt, worker->pte);
+    for (int d = 0; d < BLOCK_DAYS; d += DAY_STEP)
+      for (int l = 0; l < LATS; l++) {
+        PT__getTimes(pt,
+                     times[0],
+                     year,
+                     1,
+                     start + d,
+                     lat[l],
+                     lng[l],
+                     elv[l],
+                     tmz[l],
+                     dst[l]);
+        compare(&stats[PATH_EPHEMERIS], reference[d][l], times[0]);
+      }
+    PT__setEphemeris(pt, NULL);
+
+    /* grids, batches, masks & methods of the first compared days of the
+     * block */
+    for (int d = 0; d < 2 * DAY_STEP; d += DAY_STEP) {
+      PT__getTimesGrid(
+        pt, batch, year, 1, start + d, lat, LATS, lng, 1, elv[0], tmz[0], 0);
+      for (int l = 0; l < LATS; l++) {
+        for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+          times[0][i] = batch[i][l];
+        compare(&stats[PATH_GRID], reference[d][l], times[0]);
+      }
+      PT__getTimesBatch(
+        pt, batch, year, 1, start + d, lat, lng, elv, tmz, dst, LATS);
+      for (int l = 0; l < LATS; l++) {
+        for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+          times[0][i] = batch[i][l];
+        compare(&stats[PATH_BATCH], reference[d][l], times[0]);
+      }
+      for (int l = 0; l < LATS; l++) {
+        for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++) {
+          PT__getTimesMask(pt,
+                           times[1],
+                           PT_TN_MASK(i),
+                           year,
+                           1,
+                           start + d,
+                           lat[l],
+                           lng[l],
+                           elv[l],
+                           tmz[l],
+                           dst[l]);
+          times[0][i] = times[1][i];
+        }
+        compare(&stats[PATH_MASK], reference[d][l], times[0]);
+      }
+      for (int l = 0; l < LATS; l++) {
+        PT__getTimesMethods(pt,
+                            worker->methods,
+                            year,
+                            1,
+                            start + d,
+                            lat[l],
+                            lng[l],
+                            elv[l],
+                            tmz[l],
+                            dst[l]);
+        compare(&stats[PATH_METHODS], reference[d][l], worker->methods[m]);
+      }
+    }
+
+    /* cache lookups near a warmed up location, against the exact times of
+     * the looked up location */
+    PT__setCache(pt, 1024, 0.005, 1);
+    for (int d = 0; d < 2 * DAY_STEP; d += DAY_STEP)
+      for (int l = 0; l < LATS; l++) {
+        PT__getTimes(pt,
+                     times[0],
+                     year,
+                     1,
+                     start + d,
+                     lat[l],
+                     lng[l],
+                     elv[l],
+                     tmz[l],
+                     dst[l]);
+        const double near = lat[l] + 0.0013, higher = elv[l] + 0.4;
+        PT__getTimes(pt,
+                     times[0],
+                     year,
+                     1,
+                     start + d,
+                     near,
+                     lng[l],
+                     higher,
+                     tmz[l],
+                     dst[l]);
+        PT__getTimesRefined(pt,
+                            times[1],
+                            NULL,
+                            year,
+                            1,
+                            start + d,
+                            near,
+                            lng[l],
+                            higher,
+                            tmz[l],
+                            dst[l]);
+        compare(&stats[PATH_CACHE], times[1], times[0]);
+      }
+    PT__setCache(pt, 0, 0, 0);
+  }
+}
+
+/**
+ * Compare the configurations of a worker
+ **/
+static void*
+work(void* arg)
+{
+  Worker_t* worker = arg;
+  PT pt = PT__new();
+  PT__tune(pt, 0);
+  for (int config = worker->first; config < CONFIGS; config += worker->step)
+    compareConfig(pt, worker, config);
+  PT__free(&pt);
+  return NULL;
+}
+
+int
+main(int argc, char* argv[])
+{
+  char path[] = "/tmp/praytimes-accuracy-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+  assert(PTE__generate(path, 1900, 2100, 24) == 0);
+  PTE pte = PTE__load(path);
+  assert(pte != NULL);
+  const PT_TimeFormatSpec_t spec = PT__compileFormat("24h");
+  format = &spec;
+
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  threads = threads < 1 ? 1 : threads > CONFIGS ? CONFIGS : threads;
+  Worker_t* workers = calloc(threads, sizeof(Worker_t));
+  pthread_t* ids = calloc(threads, sizeof(pthread_t));
+  for (long t = 0; t < threads; t++) {
+    workers[t].first = t;
+    workers[t].step = threads;
+    workers[t].pte = pte;
+    assert(pthread_create(&ids[t], NULL, work, &workers[t]) == 0);
+  }
+
+  Stats_t stats[PATH_COUNT];
+  memset(stats, 0, sizeof(stats));
+  for (long t = 0; t < threads; t++) {
+    pthread_join(ids[t], NULL);
+    for (int p = 0; p < PATH_COUNT; p++) {
+      const Stats_t* s = &workers[t].stats[p];
+      stats[p].compared += s->compared;
+      stats[p].nans += s->nans;
+      stats[p].minutes += s->minutes;
+      stats[p].max = s->max > stats[p].max ? s->max : stats[p].max;
+      for (int bin = 0; bin <= BINS; bin++)
+        stats[p].bins[bin] += s->bins[bin];
+    }
+  }
+
+  printf("%-10s %9s %9s %9s %9s %9s %6s %7s\n",
+         "Path",
+         "Times",
+         "p50 (s)",
+         "p99 (s)",
+         "p99.9 (s)",
+         "Max (s)",
+         "NaN",
+         "Minutes");
+  for (int p = 0; p < PATH_COUNT; p++)
+    printf("%-10s %9ld %9.2e %9.2e %9.2e %9.2e %6ld %7ld\n",
+           pathNames[p],
+           stats[p].compared,
+           percentile(&stats[p], 0.5),
+           percentile(&stats[p], 0.99),
+           percentile(&stats[p], 0.999),
+           stats[p].max,
+           stats[p].nans,
+           stats[p].minutes);
+
+  fflush(stdout);
+
+  for (int p = 0; p < PATH_COUNT; p++) {
+    assert(stats[p].compared > 0);
+    assert(maxBounds[p] < 0 || stats[p].max <= maxBounds[p]);
+    assert(minuteBounds[p] < 0 || stats[p].minutes <= minuteBounds[p]);
+  }
+
+  free(workers);
+  free(ids);
+  PTE__free(&pte);
+  unlink(path);
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}
@@ -0,0 +1,62 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <praytimes.h>
+#include <praytimes_ephemeris.h>
+
+int
+main(int argc, char* argv[])
+{
+  char path[] = "/tmp/praytimes-ephemeris-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  assert(PTE__generate(path, 2020, 2023, 24) == 0);
+  PTE pte = PTE__load(path);
+  assert(pte != NULL);
+
+  double maxDecl = 0, maxEqt = 0;
+  PTM_SunPosition_t position;
+  for (double jd = PTM__julianDay(2020, 1, 1); jd < PTM__julianDay(2024, 1, 1);
+       jd += 0.0137) {
+    PTM_SunPosition_t exact = PTM__sunPosition(jd);
+    assert(PTE__sunPosition(pte, jd, &position));
+    double eqtDiff = fabs(PTM__fixHour(position.equation - exact.equation));
+    maxDecl = fmax(maxDecl, fabs(position.declination - exact.declination));
+    maxEqt = fmax(maxEqt, fmin(eqtDiff, 24.0f - eqtDiff));
+  }
+  assert(maxDecl < 5e-6);
+  assert(maxEqt < 1e-6);
+  assert(!PTE__sunPosition(pte, PTM__julianDay(2019, 6, 1), &position));
+  assert(!PTE__sunPosition(pte, PTM__julianDay(2024, 6, 1), &position));
+
+  PT pt = PT__new();
+  PT_PrayerTimes_t exact, tabled;
+  PT__setMethod(pt, PT_M_ISNA);
+  PT__tune(pt, 0.0f);
+  for (int month = 1; month <= 12; month++) {
+    PT__setEphemeris(pt, NULL);
+    PT__getTimes(pt, exact, 2022, month, 15, 51.5, -0.12, 10, 0, 0);
+    PT__setEphemeris(pt, pte);
+    PT__getTimes(pt, tabled, 2022, month, 15, 51.5, -0.12, 10, 0, 0);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      assert(fabs(exact[i] - tabled[i]) < 1e-6);
+  }
+  PT__free(&pt);
+
+  PTE__free(&pte);
+  assert(pte == NULL);
+  assert(PTE__load("/nonexistent/ephemeris.bin") == NULL);
+  unlink(path);
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}
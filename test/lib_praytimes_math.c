@@ -29,6 +29,9 @@ main(int argc, char* argv[])
   double jDate = PTM__julianDay(2022, 1, 20);
   assert((int)(PTM__sunPositionDeclination(jDate) * 10000000) == -201697033);
   assert((int)(PTM__sunPositionEquation(jDate) * 10000000) == -1810883);
+  PTM_SunPosition_t position = PTM__sunPosition(jDate);
+  assert(areSameF(position.declination, PTM__sunPositionDeclination(jDate)));
+  assert(areSameF(position.equation, PTM__sunPositionEquation(jDate)));
   assert((int)(PTM__midDay(jDate, 0.5f) * 10000000) == 121835385);
   assert((int)(PTM__sunAngleTime(jDate, 10, 5, PTM_SD_CCW, 3.583333f) *
                10000000) == 55799308);
@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <praytimes_simd.h>
+
+#define N 1003
+
+int
+main(int argc, char* argv[])
+{
+  static double a[N], b[N], jDate[N], angle[N], time[N], lat[N];
+  static double decl[N], eqt[N], out[N], reference[N];
+
+  for (int i = 0; i < N; i++) {
+    a[i] = -1000.0 + i * 2.0137;
+    b[i] = -1.0 + i * (2.0 / (N - 1));
+    jDate[i] = PTM__julianDay(2020, 1, 1) + i;
+    angle[i] = i % 2 ? 0.833 : 18.0;
+    time[i] = 5.0 / 24.0;
+    lat[i] = -60.0 + i * (120.0 / N);
+    decl[i] = 23.44 * b[i];
+  }
+  b[N / 2] = 0.0;
+
+  PTV_ISA_t best = PTV__detectISA();
+  assert(PTV__getISA() == best);
+
+  for (int isa = PTV_ISA_SCALAR; isa <= PTV_ISA_AVX512; isa++) {
+    if (isa > (int)best) {
+      assert(PTV__setISA(isa) == -1);
+      continue;
+    }
+    assert(PTV__setISA(isa) == 0);
+    assert(PTV__getISA() == (PTV_ISA_t)isa);
+
+    /* odd sizes exercise the partial vector tails */
+    for (size_t n = 0; n <= N; n += n < 20 ? 1 : 71) {
+      PTV__sin(out, a, n);
+      for (size_t i = 0; i < n; i++)
+        assert(fabs(out[i] - PTM__sin(a[i])) < 4e-16);
+
+      PTV__cos(out, a, n);
+      for (size_t i = 0; i < n; i++)
+        assert(fabs(out[i] - PTM__cos(a[i])) < 4e-16);
+
+      PTV__arccos(out, b, n);
+      for (size_t i = 0; i < n; i++)
+        assert(fabs(out[i] - PTM__arccos(b[i])) < 1e-13);
+
+      PTV__arctan2(out, a, b, n);
+      for (size_t i = 0; i < n; i++)
+        assert(fabs(out[i] - PTM__arctan2(a[i], b[i])) < 1e-13);
+    }
+
+    /* high latitudes have no twilight angle of 18 degrees: NaN */
+    PTV__sunAngleTime(out, jDate, angle, time, PTM_SD_CCW, lat, N);
+    for (int i = 0; i < N; i++) {
+      double exact =
+        PTM__sunAngleTime(jDate[i], angle[i], time[i], PTM_SD_CCW, lat[i]);
+      assert(isnan(out[i]) == isnan(exact));
+      assert(isnan(exact) || fabs(out[i] - exact) < 1e-12);
+    }
+
+    PTV__sunPosition(out, eqt, jDate, N);
+    for (int i = 0; i < N; i++) {
+      PTM_SunPosition_t position = PTM__sunPosition(jDate[i]);
+      assert(fabs(out[i] - position.declination) < 1e-13);
+      assert(fabs(eqt[i] - position.equation) < 1e-14);
+    }
+
+    PTV__sunHourAngle(out, decl, angle, lat, N);
+    for (int i = 0; i < N; i++) {
+      double exact =
+        PTM__sunAngleTimeAt(decl[i], 0, angle[i], PTM_SD_CW, lat[i]);
+      assert(isnan(out[i]) == isnan(exact));
+      assert(isnan(exact) || fabs(out[i] - exact) < 1e-12);
+    }
+
+    /* in-place */
+    for (int i = 0; i < N; i++)
+      out[i] = a[i];
+    PTV__sin(out, out, N);
+    for (int i = 0; i < N; i++)
+      assert(fabs(out[i] - PTM__sin(a[i])) < 4e-16);
+
+    /* vector code paths agree bit for bit */
+    if (isa == PTV_ISA_SSE2)
+      PTV__sunAngleTime(reference, jDate, angle, time, PTM_SD_CW, lat, N);
+    else if (isa > PTV_ISA_SSE2) {
+      PTV__sunAngleTime(out, jDate, angle, time, PTM_SD_CW, lat, N);
+      for (int i = 0; i < N; i++)
+        assert(out[i] == reference[i] ||
+               (isnan(out[i]) && isnan(reference[i])));
+    }
+  }
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <praytimes.h>
+#include <praytimes_zone.h>
+
+/**
+ * UTC offset of the C library, in seconds
+ **/
+static long
+libcOffset(const time_t time)
+{
+  struct tm local;
+  localtime_r(&time, &local);
+  long y = local.tm_year + 1900 - (local.tm_mon < 2);
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long m = local.tm_mon + 1;
+  long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + local.tm_mday - 1;
+  long days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+  return days * 86400 + local.tm_hour * 3600 + local.tm_min * 60 +
+         local.tm_sec - (long)time;
+}
+
+/**
+ * Whether two times are equal up to rounding
+ **/
+static int
+same(const double a, const double b)
+{
+  return fabs(a - b) < 1e-9 || (isnan(a) && isnan(b));
+}
+
+int
+main(int argc, char* argv[])
+{
+  /* the offsets agree with the C library, DST changes included */
+  const char* names[] = { "Europe/London",      "America/New_York",
+                          "America/St_Johns",   "Asia/Kolkata",
+                          "Australia/Lord_Howe", "America/Sao_Paulo" };
+  for (size_t z = 0; z < sizeof(names) / sizeof(names[0]); z++) {
+    PTZ ptz = PTZ__load(names[z]);
+    assert(ptz != NULL);
+    setenv("TZ", names[z], 1);
+    tzset();
+    for (time_t t = 0; t < 2145916800; t += 86400 / 4 + 1234)
+      assert(PTZ__offset(ptz, t) * 3600 == libcOffset(t));
+    PTZ__free(&ptz);
+    assert(ptz == NULL);
+  }
+
+  /* fractional offsets, transitions to the second, rules past the file */
+  PTZ kolkata = PTZ__load("Asia/Kolkata");
+  PTZ newYork = PTZ__load("America/New_York");
+  PTZ stJohns = PTZ__load("America/St_Johns");
+  assert(PTZ__load("Asia/Kolkata") == kolkata);
+  PTZ__free(&(PTZ){ kolkata });
+  assert(PTZ__offset(kolkata, 1650000000) == 5.5);
+  assert(PTZ__offset(stJohns, 1650000000) == -2.5);
+  assert(PTZ__offset(newYork, 1647154799) == -5); /* 2022-03-13 01:59:59 */
+  assert(PTZ__offset(newYork, 1647154800) == -4);
+  assert(PTZ__dayOffset(newYork, 19063) == -5); /* 2022-03-12 */
+  assert(PTZ__dayOffset(newYork, 19064) == -4);
+  assert(PTZ__dayOffset(newYork, 65925) == -4); /* 2150-07-01 */
+  assert(PTZ__dayOffset(newYork, 66109) == -5); /* 2151-01-01 */
+  assert(PTZ__load("Nowhere/Zone") == NULL);
+  assert(PTZ__load("../zoneinfo/UTC") == NULL);
+
+  /* times of the zone offset on the date */
+  PT pt = PT__new();
+  PT_PrayerTimes_t results, expected;
+  PT__getTimesZone(pt, results, 2022, 1, 24, 28.6139, 77.209, 216, kolkata);
+  PT__getTimes(pt, expected, 2022, 1, 24, 28.6139, 77.209, 216, 5, 0);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    assert(same(results[i], expected[i] + 0.5));
+
+  /* ranges across DST changes */
+  PT_PrayerTimes_t range[240];
+  PT__getTimesRangeZone(
+    pt, range, 2022, 1, 1, 240, 40.7128, -74.006, 10, newYork);
+  int year = 2022, month = 1, day = 1;
+  for (int d = 0; d < 240; d++) {
+    int dst = d >= 31 + 28 + 12; /* from 2022-03-13 */
+    PT__getTimes(
+      pt, expected, year, month, day, 40.7128, -74.006, 10, -5, dst);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      assert(same(range[d][i], expected[i]));
+    if (++day > (month == 2 ? 28 : month == 4 || month == 6 ? 30 : 31)) {
+      day = 1;
+      month++;
+    }
+  }
+
+  /* batches of zones */
+  double lat[3] = { 28.6139, 40.7128, 47.5615 };
+  double lng[3] = { 77.209, -74.006, -52.7126 };
+  double elv[3] = { 216, 10, 0 };
+  PTZ ptz[3] = { kolkata, newYork, stJohns };
+  double storage[PT_TN_MIDNIGHT + 1][3];
+  PT_PrayerTimesBatch_t batch;
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+    batch[i] = storage[i];
+  PT__getTimesBatchZone(pt, batch, 2022, 7, 1, lat, lng, elv, ptz, 3);
+  for (int l = 0; l < 3; l++) {
+    PT__getTimesZone(pt, results, 2022, 7, 1, lat[l], lng[l], elv[l], ptz[l]);
+    for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++)
+      assert(same(batch[i][l], results[i]));
+  }
+  PT__free(&pt);
+
+  PTZ__free(&kolkata);
+  PTZ__free(&newYork);
+  PTZ__free(&stJohns);
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}
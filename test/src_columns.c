@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <columns.h>
+#include <praytimes_math.h>
+
+#define DAYS 400
+
+int
+main(int argc, char* argv[])
+{
+  char path[] = "/tmp/praytimes-columns-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  /* the layout is fixed: integers, then doubles from offset 64 */
+  assert(offsetof(ColumnsHeader, lat) == 64);
+  assert(sizeof(ColumnsHeader) == 200);
+
+  PT pt = PT__new();
+  PT__setMethod(pt, PT_M_INDONESIA);
+  PT__tune(pt, 2.0f);
+  PT_TimeFormatSpec_t format = PT__compileFormat("24h");
+  PT_PrayerTimes_t range[DAYS];
+  PT__getTimesRange(pt, range, 2022, 1, 21, DAYS, 64.1466, -21.94, 10, 0, 0);
+
+  assert(columnsWrite(path,
+                      pt,
+                      COLUMNS_MINUTES,
+                      2022,
+                      1,
+                      21,
+                      DAYS,
+                      64.1466,
+                      -21.94,
+                      10,
+                      0,
+                      0) == 0);
+  Columns columns = columnsOpen(path);
+  assert(columns);
+  const ColumnsHeader* header = columnsHeader(columns);
+  assert(header->unit == COLUMNS_MINUTES && header->days == DAYS);
+  assert(header->year == 2022 && header->month == 1 && header->day == 21);
+  assert(header->method == PT_M_INDONESIA && header->fajr == 20.0);
+  assert(header->lat == 64.1466 && header->offsets[PT_TN_ASR] == 2.0);
+
+  /* minutes read back like the formatted times */
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++) {
+    const int16_t* column = columnsColumn(columns, i);
+    for (int d = 0; d < DAYS; d++) {
+      char formatted[PT_TIME_SIZE], expected[PT_TIME_SIZE] = "-----";
+      PT__formatTimeTo(&format, range[d][i], formatted, PT_TIME_SIZE);
+      if (column[d] >= 0)
+        snprintf(expected,
+                 PT_TIME_SIZE,
+                 "%02d:%02d",
+                 column[d] / 60,
+                 column[d] % 60);
+      assert(strcmp(formatted, expected) == 0);
+    }
+  }
+  columnsClose(&columns);
+  assert(columns == NULL);
+
+  assert(columnsWrite(path,
+                      pt,
+                      COLUMNS_HOURS,
+                      2022,
+                      1,
+                      21,
+                      DAYS,
+                      64.1466,
+                      -21.94,
+                      10,
+                      0,
+                      0) == 0);
+  columns = columnsOpen(path);
+  assert(columns && columnsHeader(columns)->unit == COLUMNS_HOURS);
+  for (int i = PT_TN_IMSAK; i <= PT_TN_MIDNIGHT; i++) {
+    const float* column = columnsColumn(columns, i);
+    for (int d = 0; d < DAYS; d++)
+      assert(column[d] == (float)PTM__fixHour(range[d][i]) ||
+             (isnan(column[d]) && isnan(range[d][i])));
+  }
+  columnsClose(&columns);
+
+  /* times past midnight wrap into the day in both units */
+  PT__getTimesRange(pt, range, 2022, 1, 21, DAYS, 21.42, -157.8, 0, 12, 0);
+  for (ColumnsUnit unit = COLUMNS_MINUTES; unit <= COLUMNS_HOURS; unit++) {
+    assert(columnsWrite(path,
+                        pt,
+                        unit,
+                        2022,
+                        1,
+                        21,
+                        DAYS,
+                        21.42,
+                        -157.8,
+                        0,
+                        12,
+                        0) == 0);
+    columns = columnsOpen(path);
+    assert(columns);
+    const int16_t* minutes = columnsColumn(columns, PT_TN_DHUHR);
+    const float* hours = columnsColumn(columns, PT_TN_DHUHR);
+    for (int d = 0; d < DAYS; d++) {
+      assert(range[d][PT_TN_DHUHR] >= 24);
+      if (unit == COLUMNS_MINUTES)
+        assert(minutes[d] >= 0 && minutes[d] < 24 * 60);
+      else
+        assert(hours[d] >= 0 && hours[d] < 24 &&
+               hours[d] == (float)(range[d][PT_TN_DHUHR] - 24));
+    }
+    columnsClose(&columns);
+  }
+
+  /* truncated files are refused */
+  assert(truncate(path, sizeof(ColumnsHeader) + 100) == 0);
+  assert(columnsOpen(path) == NULL);
+  unlink(path);
+  PT__free(&pt);
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <locations.h>
+
+#define N 100000
+
+/**
+ * Write a temporary file
+ **/
+static void
+writeFile(char* path, const void* data, size_t size)
+{
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  assert(write(fd, data, size) == (ssize_t)size);
+  close(fd);
+}
+
+int
+main(int argc, char* argv[])
+{
+  char csvPath[] = "/tmp/praytimes-locations-XXXXXX";
+  const char* csv = "lat,lng,elevation,timezone,dst\n"
+                    "3.583333,97.666667,0,7,0\n"
+                    "\n"
+                    "# comment\n"
+                    "  -33.8688 ; 151.2093 ; 58 ; 10 ; 1\r\n"
+                    "64.1466\t-21.9426\n"
+                    "1e1,-0.000125,1.5E2,-3\n"
+                    "0.1234567890123456789,12345678901234567890\n"
+                    "1,2,x\n"
+                    "1,2,0,5.5\n"
+                    "1,2,0,0,1e300\n"
+                    "5,6";
+  writeFile(csvPath, csv, strlen(csv));
+
+  Locations locations = locationsOpen(csvPath);
+  Location location;
+  assert(locations);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == 3.583333 && location.lng == 97.666667);
+  assert(location.elv == 0 && location.tmz == 7 && location.dst == 0);
+  assert(locationsLine(locations) == 2);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == -33.8688 && location.lng == 151.2093);
+  assert(location.elv == 58 && location.tmz == 10 && location.dst == 1);
+  assert(locationsLine(locations) == 5);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == 64.1466 && location.lng == -21.9426);
+  assert(location.elv == 0 && location.tmz == 0 && location.dst == 0);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == 10 && location.lng == -0.000125);
+  assert(location.elv == 150 && location.tmz == -3);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == strtod("0.1234567890123456789", NULL));
+  assert(location.lng == 12345678901234567890.0);
+  assert(locationsNext(locations, &location) == -1);
+  assert(locationsLine(locations) == 9);
+  assert(locationsNext(locations, &location) == -1);
+  assert(locationsLine(locations) == 10);
+  assert(locationsNext(locations, &location) == -1);
+  assert(locationsLine(locations) == 11);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == 5 && location.lng == 6);
+  assert(locationsNext(locations, &location) == 0);
+  locationsClose(&locations);
+  assert(locations == NULL);
+  unlink(csvPath);
+
+  /* the parser rounds like strtod */
+  static char numbers[N * 24];
+  size_t size = 0;
+  srand(1);
+  for (int i = 0; i < N; i++)
+    size += sprintf(numbers + size,
+                    "%.*f,%.6f\n",
+                    1 + i % 15,
+                    (rand() - RAND_MAX / 2) / (double)RAND_MAX * 180,
+                    (double)rand() / RAND_MAX);
+  char numbersPath[] = "/tmp/praytimes-locations-XXXXXX";
+  writeFile(numbersPath, numbers, size);
+  locations = locationsOpen(numbersPath);
+  const char* p = numbers;
+  for (int i = 0; i < N; i++) {
+    char* end;
+    double lat = strtod(p, &end);
+    double lng = strtod(end + 1, &end);
+    p = end + 1;
+    assert(locationsNext(locations, &location) == 1);
+    assert(location.lat == lat && location.lng == lng);
+  }
+  assert(locationsNext(locations, &location) == 0);
+  locationsClose(&locations);
+  unlink(numbersPath);
+
+  char binaryPath[] = "/tmp/praytimes-locations-XXXXXX";
+  uint8_t binary[8 + 2 * 32];
+  double values[6] = { 21.4225, 39.8262, 277, -6.2088, 106.8456, 8 };
+  int32_t ints[4] = { 3, 0, 7, -1 };
+  memcpy(binary, LOCATIONS_MAGIC, 8);
+  for (int r = 0; r < 2; r++) {
+    for (int i = 0; i < 3; i++) {
+      uint64_t bits;
+      memcpy(&bits, &values[r * 3 + i], 8);
+      for (int j = 0; j < 8; j++)
+        binary[8 + r * 32 + i * 8 + j] = bits >> (8 * j);
+    }
+    for (int i = 0; i < 2; i++)
+      for (int j = 0; j < 4; j++)
+        binary[8 + r * 32 + 24 + i * 4 + j] =
+          (uint32_t)ints[r * 2 + i] >> (8 * j);
+  }
+  writeFile(binaryPath, binary, sizeof(binary));
+  locations = locationsOpen(binaryPath);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == 21.4225 && location.lng == 39.8262);
+  assert(location.elv == 277 && location.tmz == 3 && location.dst == 0);
+  assert(locationsNext(locations, &location) == 1);
+  assert(location.lat == -6.2088 && location.tmz == 7 && location.dst == -1);
+  assert(locationsLine(locations) == 2);
+  assert(locationsNext(locations, &location) == 0);
+  locationsClose(&locations);
+  unlink(binaryPath);
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}
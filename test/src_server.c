@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <server.h>
+
+#define N 5000
+
+static const char* methods[] = {
+  "MWL", "ISNA", "EGYPT", "MAKKAH", "KARACHI", "TEHRAN", "JAFARI", "INDONESIA",
+};
+
+/**
+ * Request of the i-th line
+ **/
+static void
+request(int i, char* line, size_t size, int* month, int* day, double* lat)
+{
+  *month = 1 + i % 12;
+  *day = 1 + i % 28;
+  *lat = -50.0 + (i % 101);
+  snprintf(line,
+           size,
+           "%s 2024-%02d-%02d %.1f 106.8 10 7\n",
+           methods[i % 8],
+           *month,
+           *day,
+           *lat);
+}
+
+/**
+ * Stand-in client: pipeline all requests, then half-close
+ **/
+static void*
+runClient(void* arg)
+{
+  int fd = *(int*)arg, month, day;
+  double lat;
+  char line[128];
+
+  for (int i = 0; i < N; i++) {
+    request(i, line, sizeof(line), &month, &day, &lat);
+    assert(write(fd, line, strlen(line)) == (ssize_t)strlen(line));
+    if (i == N / 2) {
+      const char* bad = "MWL 2024-13-01 0 0\nFOO 2024-01-01 0 0\n"
+                        "MWL 2024-01-01 0\nMWL 2024-01-01 0 0 0 30\n"
+                        "MWL 2024-06-01 28.6 77.2 0 5.5\n"
+                        "MWL 2024-06-01 27.7 85.3 0 5 0.75\nstats\n";
+      assert(write(fd, bad, strlen(bad)) == (ssize_t)strlen(bad));
+    }
+  }
+  shutdown(fd, SHUT_WR);
+  return NULL;
+}
+
+static void*
+runServer(void* arg)
+{
+  Server server = serverNew(4, NULL, PT_P_EXACT, 1024);
+  int fd = *(int*)arg;
+  assert(serverServe(server, fd, fd) == 0);
+  ServerStats stats;
+  serverStats(server, &stats);
+  assert(stats.count == N + 7);
+  assert(stats.p50 <= stats.p90 && stats.p90 <= stats.p99);
+  assert(stats.p99 <= stats.max && stats.max > 0);
+  serverFree(&server);
+  assert(server == NULL);
+  shutdown(fd, SHUT_WR);
+  return NULL;
+}
+
+int
+main(int argc, char* argv[])
+{
+  int fds[2];
+  pthread_t client, server;
+  assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  pthread_create(&server, NULL, runServer, &fds[1]);
+  pthread_create(&client, NULL, runClient, &fds[0]);
+
+  PT pts[8];
+  for (int m = 0; m < 8; m++) {
+    pts[m] = PT__new();
+    PT__setMethod(pts[m], (PT_Method_t)m);
+    PT__tune(pts[m], 2.0f);
+  }
+  PT_TimeFormatSpec_t format = PT__compileFormat("24h");
+
+  /* responses come back in request order */
+  FILE* responses = fdopen(fds[0], "r");
+  char line[256], expected[256];
+  for (int i = 0; i < N; i++) {
+    int month, day;
+    double lat;
+    PT_PrayerTimes_t times;
+    PT_FormattedTimes_t f;
+    request(i, line, sizeof(line), &month, &day, &lat);
+    PT__getTimes(pts[i % 8], times, 2024, month, day, lat, 106.8, 10, 7, 0);
+    PT__formatTimesTo(&format, times, f);
+    snprintf(expected,
+             sizeof(expected),
+             "2024-%02d-%02d %s %s %s %s %s %s %s %s %s\n",
+             month,
+             day,
+             f[PT_TN_IMSAK],
+             f[PT_TN_FAJR],
+             f[PT_TN_SUNRISE],
+             f[PT_TN_DHUHR],
+             f[PT_TN_ASR],
+             f[PT_TN_SUNSET],
+             f[PT_TN_MAGHRIB],
+             f[PT_TN_ISHA],
+             f[PT_TN_MIDNIGHT]);
+
+    assert(fgets(line, sizeof(line), responses));
+    assert(strcmp(line, expected) == 0);
+    if (i == N / 2) {
+      assert(fgets(line, sizeof(line), responses));
+      assert(strcmp(line, "error invalid date\n") == 0);
+      assert(fgets(line, sizeof(line), responses));
+      assert(strcmp(line, "error unknown method\n") == 0);
+      assert(fgets(line, sizeof(line), responses));
+      assert(strcmp(line, "error malformed\n") == 0);
+      assert(fgets(line, sizeof(line), responses));
+      assert(strcmp(line, "error invalid timezone\n") == 0);
+
+      /* fractional offsets are not truncated to whole hours */
+      double zones[2][3] = { { 28.6, 77.2, 5.5 }, { 27.7, 85.3, 5.75 } };
+      for (int z = 0; z < 2; z++) {
+        PT__getTimes(
+          pts[0], times, 2024, 6, 1, zones[z][0], zones[z][1], 0, 0, 0);
+        for (int t = PT_TN_IMSAK; t <= PT_TN_MIDNIGHT; t++)
+          times[t] += zones[z][2];
+        PT__formatTimesTo(&format, times, f);
+        snprintf(expected,
+                 sizeof(expected),
+                 "2024-06-01 %s %s %s %s %s %s %s %s %s\n",
+                 f[PT_TN_IMSAK],
+                 f[PT_TN_FAJR],
+                 f[PT_TN_SUNRISE],
+                 f[PT_TN_DHUHR],
+                 f[PT_TN_ASR],
+                 f[PT_TN_SUNSET],
+                 f[PT_TN_MAGHRIB],
+                 f[PT_TN_ISHA],
+                 f[PT_TN_MIDNIGHT]);
+        assert(fgets(line, sizeof(line), responses));
+        assert(strcmp(line, expected) == 0);
+      }
+      assert(fgets(line, sizeof(line), responses));
+      assert(strncmp(line, "stats ", 6) == 0);
+    }
+  }
+  assert(fgets(line, sizeof(line), responses) == NULL);
+
+  pthread_join(client, NULL);
+  pthread_join(server, NULL);
+  fclose(responses);
+  close(fds[1]);
+  for (int m = 0; m < 8; m++)
+    PT__free(&pts[m]);
+
+  printf("All test assertions passed...\n");
+
+  return 0;
+}